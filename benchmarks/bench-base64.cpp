@@ -0,0 +1,41 @@
+#include <mybase64.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace {
+
+// 32 bytes is a typical SASL PLAIN payload, 300 bytes is the
+// SETFILTER chunk size, and 64 KiB is a whole filter database.
+
+auto BM_Encode(benchmark::State& state) -> void
+{
+    std::string const input(state.range(0), '\xa5');
+    std::string output(mybase64::encoded_size(input.size()) + 1, '\0');
+    for (auto _ : state)
+    {
+        mybase64::encode(input, output.data());
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_Encode)->ArgName("bytes")->Arg(32)->Arg(300)->Arg(65'536);
+
+auto BM_Decode(benchmark::State& state) -> void
+{
+    std::string const raw(state.range(0), '\xa5');
+    std::string input(mybase64::encoded_size(raw.size()) + 1, '\0');
+    mybase64::encode(raw, input.data());
+    input.pop_back();
+
+    std::string output(mybase64::decoded_size(input.size()), '\0');
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(mybase64::decode(input, output.data()));
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_Decode)->ArgName("bytes")->Arg(32)->Arg(300)->Arg(65'536);
+
+} // namespace
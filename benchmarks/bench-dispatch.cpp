@@ -0,0 +1,118 @@
+#include "corpus.hpp"
+#include "irc/lua.hpp"
+#include "safecall.hpp"
+#include "strings.hpp"
+
+#include <ircmsg.hpp>
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+}
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace std::literals::string_view_literals;
+
+// Handler shaped like the applications' on_irc: one function per message,
+// and a batch isolates each message's errors the way the applications do
+char constexpr handler[] = R"(
+local n = 0
+local function handle(irc)
+    if irc.command == 'PRIVMSG' then n = n + 1 end
+end
+return function(event, arg)
+    if event == 'MSGS' then
+        for i = 1, #arg do
+            local success, message = pcall(handle, arg[i])
+            if not success then error(message) end
+        end
+    else
+        handle(arg)
+    end
+end
+)";
+
+/// @brief Lines delivered by a single large read during a bouncer replay
+auto burst() -> std::vector<std::string>
+{
+    std::vector<std::string> lines;
+    while (lines.size() < 1'000)
+    {
+        for (auto&& line : corpus::mixed())
+        {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+auto new_state() -> std::pair<lua_State*, int>
+{
+    auto const L = luaL_newstate();
+    luaL_openlibs(L);
+    luaL_dostring(L, handler);
+    auto const cb = luaL_ref(L, LUA_REGISTRYINDEX);
+    return {L, cb};
+}
+
+auto BM_DispatchPerLine(benchmark::State& state) -> void
+{
+    auto const [L, cb] = new_state();
+    auto const lines = burst();
+    std::string buffer;
+    ircmsg msg;
+
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < lines.size(); i++)
+        {
+            buffer = lines[i];
+            parse_irc_message(buffer.data(), msg);
+
+            lua_rawgeti(L, LUA_REGISTRYINDEX, cb);
+            push_string(L, "MSG"sv);
+            pushircmsg(L, msg);
+            lua_pushboolean(L, i + 1 == lines.size());
+            safecall(L, "irc message", 3);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * lines.size());
+    lua_close(L);
+}
+BENCHMARK(BM_DispatchPerLine);
+
+auto BM_DispatchBatch(benchmark::State& state) -> void
+{
+    auto const [L, cb] = new_state();
+    auto const lines = burst();
+    std::string buffer;
+    ircmsg msg;
+
+    for (auto _ : state)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, cb);
+        push_string(L, "MSGS"sv);
+        lua_newtable(L);
+        lua_Integer n = 0;
+        for (auto&& line : lines)
+        {
+            buffer = line;
+            parse_irc_message(buffer.data(), msg);
+            pushircmsg(L, msg);
+            lua_rawseti(L, -2, ++n);
+        }
+        safecall(L, "irc messages", 2);
+    }
+    state.SetItemsProcessed(state.iterations() * lines.size());
+    lua_close(L);
+}
+BENCHMARK(BM_DispatchBatch);
+
+} // namespace
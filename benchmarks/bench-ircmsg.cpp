@@ -0,0 +1,135 @@
+#include "corpus.hpp"
+
+#include <ircmsg.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> allocations;
+
+char constexpr sample[] = "@time=2023-08-22T12:34:56.789Z;account=glguy;msgid=abc\\s123 "
+                          ":nick!user@host.example PRIVMSG #snowcone :hello, world";
+
+/// @brief Report allocations per iteration since the last reset
+auto report_allocations(benchmark::State& state, std::size_t const start) -> void
+{
+    state.counters["allocs/msg"] = benchmark::Counter(
+        static_cast<double>(allocations - start),
+        benchmark::Counter::kAvgIterations
+    );
+}
+
+auto BM_ParseByValue(benchmark::State& state) -> void
+{
+    std::string buffer;
+    auto const start = allocations.load();
+    for (auto _ : state)
+    {
+        buffer.assign(sample, sizeof sample);
+        auto const msg = parse_irc_message(buffer.data());
+        benchmark::DoNotOptimize(msg);
+    }
+    report_allocations(state, start);
+}
+BENCHMARK(BM_ParseByValue);
+
+auto BM_ParseReuse(benchmark::State& state) -> void
+{
+    std::string buffer;
+    ircmsg msg;
+    auto const start = allocations.load();
+    for (auto _ : state)
+    {
+        buffer.assign(sample, sizeof sample);
+        parse_irc_message(buffer.data(), msg);
+        benchmark::DoNotOptimize(msg);
+    }
+    report_allocations(state, start);
+}
+BENCHMARK(BM_ParseReuse);
+
+auto BM_ParseCorpus(benchmark::State& state, std::vector<std::string> const& lines) -> void
+{
+    std::string buffer;
+    ircmsg msg;
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        for (auto&& line : lines)
+        {
+            buffer = line;
+            parse_irc_message(buffer.data(), msg);
+            benchmark::DoNotOptimize(msg);
+            bytes += line.size();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * lines.size());
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK_CAPTURE(BM_ParseCorpus, snote, corpus::snote());
+BENCHMARK_CAPTURE(BM_ParseCorpus, tags, corpus::tags());
+BENCHMARK_CAPTURE(BM_ParseCorpus, trailing, corpus::trailing());
+
+auto BM_ParseScanner(benchmark::State& state) -> void
+{
+    auto const scanner = static_cast<irc_scanner>(state.range(0));
+    auto const previous = get_irc_scanner();
+    if (not set_irc_scanner(scanner))
+    {
+        state.SkipWithError("scanner not supported");
+        return;
+    }
+
+    auto const lines = corpus::mixed();
+    std::string buffer;
+    ircmsg msg;
+    for (auto _ : state)
+    {
+        for (auto&& line : lines)
+        {
+            buffer = line;
+            parse_irc_message(buffer.data(), msg);
+            benchmark::DoNotOptimize(msg);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * lines.size());
+    set_irc_scanner(previous);
+}
+BENCHMARK(BM_ParseScanner)
+    ->ArgName("scanner")
+    ->Arg(static_cast<int>(irc_scanner::scalar))
+    ->Arg(static_cast<int>(irc_scanner::sse2))
+    ->Arg(static_cast<int>(irc_scanner::avx2));
+
+} // namespace
+
+// Count every allocation made by the process so each benchmark
+// can report how many happened per parsed message.
+
+auto operator new(std::size_t const n) -> void*
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto const p = std::malloc(n ? n : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+auto operator delete(void* const p) noexcept -> void
+{
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::size_t) noexcept -> void
+{
+    std::free(p);
+}
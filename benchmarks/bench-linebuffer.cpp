@@ -0,0 +1,52 @@
+#include "corpus.hpp"
+#include "linebuffer.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+
+auto BM_NextLine(benchmark::State& state) -> void
+{
+    auto const chunk_size = static_cast<std::size_t>(state.range(0));
+
+    // Build a stream large enough to wrap the buffer several times
+    std::string stream;
+    std::size_t lines_per_stream = 0;
+    while (stream.size() < 1'000'000)
+    {
+        for (auto&& line : corpus::mixed())
+        {
+            stream += line;
+            stream += "\r\n";
+            lines_per_stream++;
+        }
+    }
+
+    for (auto _ : state)
+    {
+        LineBuffer buff{131'072};
+        std::size_t offset = 0;
+        while (offset < stream.size())
+        {
+            auto const target = buff.get_buffer();
+            auto const n = std::min({chunk_size, target.size(), stream.size() - offset});
+            std::memcpy(target.data(), stream.data() + offset, n);
+            buff.add_bytes(n);
+            offset += n;
+
+            while (auto const line = buff.next_line())
+            {
+                benchmark::DoNotOptimize(line);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * lines_per_stream);
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_NextLine)->ArgName("chunk")->Arg(64)->Arg(1'500)->Arg(16'384)->Arg(131'072);
+
+} // namespace
@@ -0,0 +1,146 @@
+#include "corpus.hpp"
+#include "irc/lua.hpp"
+#include "strings.hpp"
+
+#include <ircmsg.hpp>
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+}
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// @brief Parse the corpus once up front so only the push is measured
+struct Parsed
+{
+    std::vector<std::string> buffers;
+    std::vector<ircmsg> msgs;
+
+    Parsed()
+        : buffers{corpus::mixed()}
+    {
+        msgs.reserve(buffers.size());
+        for (auto& buffer : buffers)
+        {
+            msgs.push_back(parse_irc_message(buffer.data()));
+        }
+    }
+};
+
+auto BM_PushIrcMsg(benchmark::State& state) -> void
+{
+    Parsed const parsed;
+    auto const L = luaL_newstate();
+
+    for (auto _ : state)
+    {
+        for (auto&& msg : parsed.msgs)
+        {
+            pushircmsg(L, msg);
+            lua_pop(L, 1);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * parsed.msgs.size());
+    lua_close(L);
+}
+BENCHMARK(BM_PushIrcMsg);
+
+// The dashboard's MSG handler: every message has its time tag read, gets
+// time and timestamp assigned, and is kept in the message history; server
+// notices and private messages then have their arguments and source read.
+char constexpr dashboard_handler[] = R"(
+local history, n = {}, 0
+return function(irc)
+    local time
+    if irc.tags.time then
+        time = string.match(irc.tags.time, 'T(%d%d:%d%d:%d%d)')
+    end
+    irc.time = time or '00:00:00'
+    irc.timestamp = 0
+    n = n % 1000 + 1
+    history[n] = irc
+
+    local command = irc.command
+    if command == 'NOTICE' then
+        if irc[1] == '*' and not string.match(irc.source, '@') then
+            string.match(irc[2], '^%*%*%* Notice %-%- (.*)$')
+        end
+    elseif command == 'PRIVMSG' then
+        local _, message = irc[1], irc[2]
+        string.match(message, '^\x01(%S+) ?([^\x01]*)\x01?$')
+    end
+end
+)";
+
+/// @brief Lua allocator that counts allocations
+auto counting_alloc(void* const ud, void* const ptr, std::size_t const osize, std::size_t const nsize) -> void*
+{
+    if (0 == nsize)
+    {
+        std::free(ptr);
+        return nullptr;
+    }
+    if (nullptr == ptr)
+    {
+        ++*static_cast<std::size_t*>(ud);
+    }
+    return std::realloc(ptr, nsize);
+}
+
+template <bool lazy>
+auto BM_Dashboard(benchmark::State& state) -> void
+{
+    auto const lines = corpus::mixed();
+    std::size_t allocations = 0;
+    auto const L = lua_newstate(counting_alloc, &allocations);
+    luaL_openlibs(L);
+    luaL_dostring(L, dashboard_handler);
+    auto const cb = luaL_ref(L, LUA_REGISTRYINDEX);
+    std::string buffer;
+    ircmsg msg;
+
+    // Fill the history so that steady state includes collecting old messages
+    auto const run = [&]() {
+        for (auto&& line : lines)
+        {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, cb);
+            if constexpr (lazy)
+            {
+                push_lazy_ircmsg(L, line);
+            }
+            else
+            {
+                buffer = line;
+                parse_irc_message(buffer.data(), msg);
+                pushircmsg(L, msg);
+            }
+            lua_call(L, 1, 0);
+        }
+    };
+    for (int i = 0; i < 100; i++)
+    {
+        run();
+    }
+
+    allocations = 0;
+    for (auto _ : state)
+    {
+        run();
+    }
+    auto const messages = state.iterations() * lines.size();
+    state.SetItemsProcessed(messages);
+    state.counters["lua_allocs_per_msg"] = static_cast<double>(allocations) / messages;
+    lua_close(L);
+}
+BENCHMARK(BM_Dashboard<false>)->Name("BM_DashboardEager");
+BENCHMARK(BM_Dashboard<true>)->Name("BM_DashboardLazy");
+
+} // namespace
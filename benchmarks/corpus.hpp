@@ -0,0 +1,59 @@
+#pragma once
+/**
+ * @file corpus.hpp
+ * @brief Representative IRC traffic for the benchmarks
+ *
+ */
+
+#include <string>
+#include <vector>
+
+namespace corpus {
+
+/// @brief Server notices as seen by an opered dashboard during a connection flood
+inline auto snote() -> std::vector<std::string>
+{
+    return {
+        ":calcium.libera.chat NOTICE * :*** Notice -- Client connecting: guest41 (~guest@198.51.100.23) [198.51.100.23] {users} <*> [Guest user]",
+        ":calcium.libera.chat NOTICE * :*** Notice -- Client exiting: guest41 (~guest@198.51.100.23) [Quit: Leaving] [198.51.100.23]",
+        ":copper.libera.chat NOTICE * :*** Notice -- Client connecting: alice (alice@2001:db8::1234) [2001:db8::1234] {users} <alice> [Alice Example]",
+        ":copper.libera.chat NOTICE * :*** Notice -- Client exiting: alice (alice@2001:db8::1234) [Ping timeout: 240 seconds] [2001:db8::1234]",
+        ":lithium.libera.chat NOTICE * :*** Notice -- Nick change: From bob to bob_ [bob@user/bob]",
+        ":lithium.libera.chat NOTICE * :*** Notice -- oper!oper@staff/oper{oper} added global 1440 min. K-Line for [*@203.0.113.0/24] [spam]",
+    };
+}
+
+/// @brief Messages from a server with the full set of IRCv3 tags enabled
+inline auto tags() -> std::vector<std::string>
+{
+    return {
+        "@time=2023-08-22T12:34:56.789Z;account=alice;msgid=Z2xndXkgd2FzIGhlcmU;batch=abc123 :alice!alice@user/alice PRIVMSG #snowcone :hi",
+        "@time=2023-08-22T12:34:57.001Z;msgid=ZGlkIHlvdSByZWFkIHRoaXM;+draft/reply=Z2xndXk;+typing=done :bob!bob@user/bob TAGMSG #snowcone",
+        "@time=2023-08-22T12:34:58.123Z;account=carol;msgid=bm90aGluZyB0byBzZWU;label=42;+custom=a\\sb\\:c\\\\d :carol!carol@user/carol NOTICE #snowcone :ok",
+        "@batch=abc123;time=2023-08-22T12:34:59.999Z;account=*;msgid=aGVsbG8 :dave!~dave@198.51.100.7 JOIN #snowcone * :Dave",
+    };
+}
+
+/// @brief Messages dominated by a long trailing argument
+inline auto trailing() -> std::vector<std::string>
+{
+    auto const text = std::string(400, 'x');
+    return {
+        ":alice!alice@user/alice PRIVMSG #snowcone :" + text,
+        ":irc.example 372 snowcone :- " + text,
+        ":bob!bob@user/bob NOTICE snowcone :" + text + " " + text.substr(0, 40),
+    };
+}
+
+/// @brief Concatenation of all of the above
+inline auto mixed() -> std::vector<std::string>
+{
+    std::vector<std::string> result;
+    for (auto&& part : {snote(), tags(), trailing()})
+    {
+        result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+}
+
+} // namespace corpus
@@ -2,6 +2,7 @@
 
 #include "applib.hpp"
 #include "bracketed_paste.hpp"
+#include "metrics.hpp"
 #include "myncurses.h"
 #include "safecall.hpp"
 #include "strings.hpp"
@@ -13,17 +14,31 @@ extern "C" {
 
 #include <ncurses.h>
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
+
+#include <signal.h>
 #include <unistd.h>
 
 static char const app_key = '\0';
 
 App::App(char const* const filename)
     : io_context{}
+    , worker_pool{2}
     , stdin_poll{io_context, STDIN_FILENO}
     , signals{io_context, SIGWINCH, SIGHUP}
     , main_source{filename}
+    , dns_resolver{io_context}
+    , redraw_timer{io_context}
+    , frame_interval{std::chrono::milliseconds{33}}
+    , last_redraw{}
+    , redraw_pending{false}
 {
+    // Writes to a child or peer that has gone away must fail with EPIPE
+    // rather than kill the client
+    ::signal(SIGPIPE, SIG_IGN);
+
     L = luaL_newstate();
     lua_pushlightuserdata(L, this);
     lua_rawsetp(L, LUA_REGISTRYINDEX, &app_key);
@@ -31,6 +46,9 @@ App::App(char const* const filename)
 
 App::~App()
 {
+    // Jobs still running refer to the Lua state through their callbacks
+    worker_pool.join();
+    dns_resolver.shutdown();
     lua_close(L);
 }
 
@@ -79,6 +97,15 @@ auto App::signal_thread() -> boost::asio::awaitable<void>
         switch (sig)
         {
         case SIGHUP:
+            try
+            {
+                // Pick up a replaced ASN database even if the Lua reload fails
+                asn_db.reload();
+            }
+            catch (std::exception const&)
+            {
+                // Keep using the loaded database; reopening from Lua reports the error
+            }
             reload();
             break;
         case SIGWINCH:
@@ -97,11 +124,16 @@ auto App::stdin_thread() -> boost::asio::awaitable<void>
     bool in_paste = false;
     mbstate_t mbstate{};
 
+    auto& keys = metrics::counter("snowcone_input_keys_total", "Terminal input characters read");
+    auto& latency = metrics::histogram("snowcone_input_seconds", "Time spent handling each batch of terminal input");
+
     for (;;)
     {
         co_await stdin_poll.async_wait(stdin_poll.wait_read, boost::asio::use_awaitable);
+        metrics::Stopwatch const stopwatch{latency};
         for (int key; key = getch(), ERR != key;)
         {
+            keys.add();
             if (in_paste)
             {
                 if (BracketedPaste::end_paste == key)
@@ -160,6 +192,12 @@ auto App::stdin_thread() -> boost::asio::awaitable<void>
                 }
             }
         }
+
+        // Echo input without waiting for the next frame
+        if (redraw_pending)
+        {
+            redraw_now();
+        }
     }
 }
 
@@ -174,6 +212,47 @@ auto App::shutdown() -> void
 {
     stdin_poll.close();
     signals.cancel();
+    redraw_timer.cancel();
+}
+
+auto App::request_redraw() -> void
+{
+    static auto& coalesced = metrics::counter("snowcone_redraw_coalesced_total", "Redraw requests merged into an already scheduled render");
+
+    if (redraw_pending)
+    {
+        coalesced.add();
+        return;
+    }
+
+    redraw_pending = true;
+    redraw_timer.expires_at(std::max(std::chrono::steady_clock::now(), last_redraw + frame_interval));
+    redraw_timer.async_wait([this](boost::system::error_code const error) {
+        // A render may have happened after this wait completed but before it ran
+        if (not error && redraw_pending)
+        {
+            redraw();
+        }
+    });
+}
+
+auto App::redraw_now() -> void
+{
+    if (redraw_pending)
+    {
+        redraw_timer.cancel();
+    }
+    redraw();
+}
+
+auto App::redraw() -> void
+{
+    static auto& redraws = metrics::counter("snowcone_redraws_total", "Screen renders performed");
+
+    redraw_pending = false;
+    last_redraw = std::chrono::steady_clock::now();
+    redraws.add();
+    lua_callback(L, "on_redraw", 0);
 }
 
 auto App::reload() -> bool
@@ -6,8 +6,13 @@
  *
  */
 
+#include "mmdb.hpp"
+#include "net/dns_resolver.hpp"
+#include "net/tls_cache.hpp"
+
 #include <boost/asio.hpp>
 
+#include <chrono>
 #include <string_view>
 
 struct lua_State;
@@ -15,10 +20,21 @@ struct lua_State;
 class App
 {
     boost::asio::io_context io_context;
+    // Runs expensive computations such as key derivation off the event loop
+    boost::asio::thread_pool worker_pool;
     boost::asio::posix::stream_descriptor stdin_poll;
     boost::asio::signal_set signals;
     lua_State* L;
     char const* main_source;
+    TlsCache tls_cache;
+    DnsResolver dns_resolver;
+    AsnDatabase asn_db;
+
+    // Redraws are coalesced to at most one per frame interval
+    boost::asio::steady_timer redraw_timer;
+    std::chrono::steady_clock::duration frame_interval;
+    std::chrono::steady_clock::time_point last_redraw;
+    bool redraw_pending;
 
 public:
     App(char const*);
@@ -34,12 +50,53 @@ public:
         return io_context;
     }
 
+    auto get_worker_pool() -> boost::asio::thread_pool&
+    {
+        return worker_pool;
+    }
+
+    auto get_tls_cache() -> TlsCache&
+    {
+        return tls_cache;
+    }
+
+    auto get_dns_resolver() -> DnsResolver&
+    {
+        return dns_resolver;
+    }
+
+    auto get_asn_db() -> AsnDatabase&
+    {
+        return asn_db;
+    }
+
     auto get_lua() const -> lua_State*
     {
         return L;
     }
 
+    /**
+     * @brief Schedule a render at the next frame boundary
+     *
+     * Requests made while a render is already scheduled are merged into it.
+     */
+    auto request_redraw() -> void;
+
+    /**
+     * @brief Render now, satisfying any scheduled render
+     */
+    auto redraw_now() -> void;
+
+    /**
+     * @brief Set the minimum time between scheduled renders
+     */
+    auto set_frame_interval(std::chrono::steady_clock::duration interval) -> void
+    {
+        frame_interval = interval;
+    }
+
 private:
+    auto redraw() -> void;
     auto signal_thread() -> boost::asio::awaitable<void>;
     auto stdin_thread() -> boost::asio::awaitable<void>;
 };
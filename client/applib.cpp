@@ -1,10 +1,17 @@
 #include "applib.hpp"
 
 #include "app.hpp"
+#include "asnlookup.hpp"
 #include "config.hpp"
+#include "crypto_worker.hpp"
 #include "dnslookup.hpp"
 #include "irc/lua.hpp"
+#include "irccase.hpp"
+#include "metrics.hpp"
+#include "ordered_map.hpp"
+#include "prefix_trie.hpp"
 #include "safecall.hpp"
+#include "snote.hpp"
 #include "strings.hpp"
 #include "timer.hpp"
 
@@ -33,6 +40,10 @@ extern "C" {
 #include "myarchive.h"
 #endif
 
+#ifdef PCRE2_FOUND
+#include "regex_cache.hpp"
+#endif
+
 #include "process.hpp"
 
 #include <algorithm>
@@ -43,6 +54,7 @@ extern "C" {
 #include <iostream>
 #include <iterator>
 #include <locale>
+#include <system_error>
 
 namespace { // lua support for app
 
@@ -166,37 +178,11 @@ auto l_isalnum(lua_State* const L) -> int
 
 auto l_irccase(lua_State* const L) -> int
 {
-    char const* const charmap = "\x00\x01\x02\x03\x04\x05\x06\x07"
-                                "\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
-                                "\x10\x11\x12\x13\x14\x15\x16\x17"
-                                "\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f"
-                                " !\"#$%&'()*+,-./0123456789:;<=>?"
-                                "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_"
-                                "`ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^\x7f"
-                                "\x80\x81\x82\x83\x84\x85\x86\x87"
-                                "\x88\x89\x8a\x8b\x8c\x8d\x8e\x8f"
-                                "\x90\x91\x92\x93\x94\x95\x96\x97"
-                                "\x98\x99\x9a\x9b\x9c\x9d\x9e\x9f"
-                                "\xa0\xa1\xa2\xa3\xa4\xa5\xa6\xa7"
-                                "\xa8\xa9\xaa\xab\xac\xad\xae\xaf"
-                                "\xb0\xb1\xb2\xb3\xb4\xb5\xb6\xb7"
-                                "\xb8\xb9\xba\xbb\xbc\xbd\xbe\xbf"
-                                "\xc0\xc1\xc2\xc3\xc4\xc5\xc6\xc7"
-                                "\xc8\xc9\xca\xcb\xcc\xcd\xce\xcf"
-                                "\xd0\xd1\xd2\xd3\xd4\xd5\xd6\xd7"
-                                "\xd8\xd9\xda\xdb\xdc\xdd\xde\xdf"
-                                "\xe0\xe1\xe2\xe3\xe4\xe5\xe6\xe7"
-                                "\xe8\xe9\xea\xeb\xec\xed\xee\xef"
-                                "\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7"
-                                "\xf8\xf9\xfa\xfb\xfc\xfd\xfe\xff";
-
     auto const str = check_string_view(L, 1);
 
     luaL_Buffer B;
     auto const output = luaL_buffinitsize(L, &B, str.size());
-    std::transform(std::begin(str), std::end(str), output, [charmap](char c) {
-        return charmap[uint8_t(c)];
-    });
+    std::transform(std::begin(str), std::end(str), output, irccase);
     luaL_pushresultsize(&B, str.size());
     return 1;
 }
@@ -207,6 +193,37 @@ auto l_shutdown(lua_State* const L) -> int
     return 0;
 }
 
+auto l_request_redraw(lua_State* const L) -> int
+{
+    App::from_lua(L)->request_redraw();
+    return 0;
+}
+
+auto l_set_frame_interval(lua_State* const L) -> int
+{
+    auto const ms = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, ms >= 0, 1, "interval must be non-negative");
+    App::from_lua(L)->set_frame_interval(std::chrono::milliseconds{ms});
+    return 0;
+}
+
+auto l_set_tls_session_file(lua_State* const L) -> int
+{
+    auto const path = check_string_view(L, 1);
+    try
+    {
+        App::from_lua(L)->get_tls_cache().set_session_file(std::string{path});
+    }
+    catch (std::system_error const& e)
+    {
+        luaL_pushfail(L);
+        push_string(L, e.what());
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
 auto l_time(lua_State* const L) -> int
 {
     timespec now;
@@ -253,22 +270,41 @@ auto l_parse_irc(lua_State* const L) -> int
 }
 
 luaL_Reg const applib_module[] = {
+    {"asn_lookup", l_asn_lookup},
     {"connect", l_start_irc},
+    {"dns_stats", l_dns_stats},
+    {"dnsbatch", l_dnsbatch},
     {"dnslookup", l_dnslookup},
+    {"dnsreverse", l_dnsreverse},
     {"from_base64", l_from_base64},
     {"irccase", l_irccase},
     {"isalnum", l_isalnum},
+    {"measure", l_measure},
+    {"metrics", l_metrics},
+    {"new_ordered_map", l_new_ordered_map},
+    {"new_prefix_trie", l_new_prefix_trie},
     {"newtimer", l_new_timer},
+    {"open_asn_db", l_open_asn_db},
     {"parse_irc_tags", l_parse_irc_tags},
     {"parse_irc", l_parse_irc},
+    {"parse_snote", l_parse_snote},
+    {"pbkdf2", l_pbkdf2},
+    {"pkey_decrypt", l_pkey_decrypt},
+    {"pkey_sign", l_pkey_sign},
     {"pton", l_pton},
     {"raise", l_raise},
+    {"request_redraw", l_request_redraw},
+    {"serve_metrics", l_serve_metrics},
+    {"set_dns_options", l_set_dns_options},
+    {"set_frame_interval", l_set_frame_interval},
+    {"set_tls_session_file", l_set_tls_session_file},
     {"setmodule", l_setmodule},
     {"shutdown", l_shutdown},
     {"time", l_time},
     {"to_base64", l_to_base64},
     {"xor_strings", l_xor_strings},
     {"execute", l_execute},
+    {"spawn", l_spawn},
     {}
 };
 
@@ -339,6 +375,11 @@ auto prepare_globals(lua_State* const L, int const argc, char const* const* cons
     lua_pop(L, 1);
 #endif
 
+#ifdef PCRE2_FOUND
+    luaL_requiref(L, "mypcre2", luaopen_mypcre2, 1);
+    lua_pop(L, 1);
+#endif
+
     luaL_newlib(L, applib_module);
     lua_pushinteger(L, SIGINT);
     lua_setfield(L, -2, "SIGINT");
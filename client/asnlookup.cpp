@@ -0,0 +1,52 @@
+#include "asnlookup.hpp"
+
+#include "app.hpp"
+#include "strings.hpp"
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+#include <exception>
+#include <string>
+
+auto l_open_asn_db(lua_State* const L) -> int
+{
+    std::string path{check_string_view(L, 1)};
+    try
+    {
+        App::from_lua(L)->get_asn_db().open(std::move(path));
+    }
+    catch (std::exception const& e)
+    {
+        luaL_pushfail(L);
+        push_string(L, e.what());
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+auto l_asn_lookup(lua_State* const L) -> int
+{
+    auto const address = check_string_view(L, 1);
+    luaL_argcheck(L, 4 == address.size() || 16 == address.size(), 1, "packed address expected");
+
+    try
+    {
+        if (auto const asn = App::from_lua(L)->get_asn_db().lookup(address))
+        {
+            push_string(L, asn->organization);
+            lua_pushinteger(L, asn->number);
+            return 2;
+        }
+    }
+    catch (std::exception const& e)
+    {
+        luaL_pushfail(L);
+        push_string(L, e.what());
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+/**
+ * @file asnlookup.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Autonomous system lookups from Lua
+ *
+ */
+
+struct lua_State;
+
+/**
+ * @brief Load a MaxMind ASN database
+ *
+ * Takes the path to the .mmdb file. Opening the loaded file again only
+ * reloads it when it has been replaced.
+ *
+ * @param L Lua state
+ * @return 1 - true, or fail and an error message
+ */
+auto l_open_asn_db(lua_State* L) -> int;
+
+/**
+ * @brief Find the autonomous system of an address
+ *
+ * Takes an address packed by pton.
+ *
+ * @param L Lua state
+ * @return 2 - organization and number, 0 when not found, or fail and an error message
+ */
+auto l_asn_lookup(lua_State* L) -> int;
@@ -0,0 +1,213 @@
+#include "child_process.hpp"
+
+#include "linebuffer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include <signal.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace std::literals::string_view_literals;
+
+std::size_t constexpr read_size = 4'096;
+
+} // namespace
+
+ChildProcess::ChildProcess(boost::asio::io_context& io_context, Handlers handlers, Options const& options)
+    : handlers_{std::move(handlers)}
+    , options_{options}
+    , stdin_{io_context}
+    , stdout_{io_context}
+    , stderr_{io_context}
+    , timer_{io_context}
+    , writing_{false}
+    , write_blocked_{false}
+    , close_requested_{false}
+    , running_{3}
+    , exited_{false}
+    , exit_code_{-1}
+    , timed_out_{false}
+{
+}
+
+auto ChildProcess::read_stream(boost::process::async_pipe& pipe, std::string_view const stream) -> boost::asio::awaitable<void>
+{
+    auto const self = shared_from_this();
+    LineBuffer buff{std::min(read_size, options_.max_line), options_.max_line};
+
+    for (;;)
+    {
+        auto const target = buff.get_buffer();
+        if (target.size() == 0)
+        {
+            handlers_.output(stream, buff.take_partial(), true);
+            continue;
+        }
+
+        boost::system::error_code error;
+        auto const n = co_await pipe.async_read_some(target, boost::asio::redirect_error(boost::asio::use_awaitable, error));
+        if (error)
+        {
+            break;
+        }
+        buff.add_bytes(n);
+
+        if (options_.chunks)
+        {
+            handlers_.output(stream, buff.take_partial(), false);
+        }
+        else
+        {
+            while (auto const line = buff.next_line())
+            {
+                handlers_.output(stream, line, false);
+            }
+        }
+    }
+
+    // Final line without a newline
+    if (auto const rest = buff.take_partial(); not rest.empty())
+    {
+        handlers_.output(stream, rest, false);
+    }
+    finished();
+}
+
+auto ChildProcess::write_actual() -> void
+{
+    writing_ = true;
+    std::swap(write_queue_, write_inflight_);
+    boost::asio::async_write(
+        stdin_,
+        boost::asio::buffer(write_inflight_),
+        [self = shared_from_this()](boost::system::error_code const& error, std::size_t) {
+            self->write_inflight_.clear();
+            self->writing_ = false;
+
+            if (error)
+            {
+                // The child stopped reading; nothing more can be sent
+                self->write_queue_.clear();
+                self->close_requested_ = true;
+            }
+
+            if (not self->write_queue_.empty())
+            {
+                self->write_actual();
+            }
+            else if (self->close_requested_)
+            {
+                boost::system::error_code ignored;
+                self->stdin_.close(ignored);
+            }
+
+            if (self->write_blocked_ && self->pending() <= self->options_.write_high_water / 4)
+            {
+                self->write_blocked_ = false;
+                if (self->handlers_.drain)
+                {
+                    self->handlers_.drain();
+                }
+            }
+        }
+    );
+}
+
+auto ChildProcess::finished() -> void
+{
+    if (0 < --running_)
+    {
+        return;
+    }
+
+    timer_.cancel();
+    close_requested_ = true;
+    boost::system::error_code ignored;
+    stdin_.close(ignored);
+
+    auto const exit = std::move(handlers_.exit);
+    handlers_ = {};
+    if (exit)
+    {
+        exit(exit_code_, timed_out_);
+    }
+}
+
+auto ChildProcess::start(boost::asio::io_context& io_context, boost::filesystem::path const& file, std::vector<std::string> args) -> void
+{
+    child_ = boost::process::child{
+        file,
+        boost::process::args += std::move(args),
+        boost::process::std_in < stdin_,
+        boost::process::std_out > stdout_,
+        boost::process::std_err > stderr_,
+        io_context,
+        restore_sigpipe(),
+        // Own process group so a timeout reaches anything it started
+        boost::process::extend::on_exec_setup([](auto&) { ::setpgid(0, 0); }),
+        boost::process::on_exit([self = shared_from_this()](int const exit_code, std::error_code const&) {
+            self->exited_ = true;
+            self->exit_code_ = exit_code;
+            self->finished();
+        }),
+    };
+
+    if (not options_.input)
+    {
+        close_stdin();
+    }
+
+    boost::asio::co_spawn(io_context, read_stream(stdout_, "stdout"sv), boost::asio::detached);
+    boost::asio::co_spawn(io_context, read_stream(stderr_, "stderr"sv), boost::asio::detached);
+
+    if (options_.timeout.count() > 0)
+    {
+        timer_.expires_after(options_.timeout);
+        timer_.async_wait([weak = weak_from_this()](boost::system::error_code const& error) {
+            if (not error)
+            {
+                if (auto const self = weak.lock())
+                {
+                    // Children left holding stdout or stderr would keep
+                    // the streams, and so the exit event, open forever
+                    self->timed_out_ = true;
+                    ::kill(-self->child_.id(), SIGKILL);
+                }
+            }
+        });
+    }
+}
+
+auto ChildProcess::write(std::string_view const data) -> bool
+{
+    write_queue_.append(data);
+    if (not writing_)
+    {
+        write_actual();
+    }
+
+    auto const ok = pending() <= options_.write_high_water;
+    if (not ok)
+    {
+        write_blocked_ = true;
+    }
+    return ok;
+}
+
+auto ChildProcess::close_stdin() -> void
+{
+    close_requested_ = true;
+    if (not writing_)
+    {
+        boost::system::error_code ignored;
+        stdin_.close(ignored);
+    }
+}
+
+auto ChildProcess::kill(int const signal) -> bool
+{
+    return not exited_ && 0 == ::kill(child_.id(), signal);
+}
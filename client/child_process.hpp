@@ -0,0 +1,135 @@
+#pragma once
+/**
+ * @file child_process.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Child processes with streamed output and buffered input
+ *
+ */
+
+#include <boost/asio.hpp>
+#include <boost/process.hpp>
+#include <boost/process/extend.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <signal.h>
+
+/**
+ * @brief Launch initializer that restores SIGPIPE's default in the child
+ *
+ * App ignores SIGPIPE, and ignored signals stay ignored across exec.
+ */
+inline auto restore_sigpipe()
+{
+    return boost::process::extend::on_exec_setup([](auto&) {
+        ::signal(SIGPIPE, SIG_DFL);
+    });
+}
+
+/**
+ * @brief Child process whose output is streamed to handlers
+ *
+ * Output is read through a LineBuffer so memory use is bounded by the
+ * longest line allowed, and lines longer than that are passed on in
+ * pieces. The exit handler runs once the process has exited and both
+ * output streams are closed; the handlers are released after it. The
+ * child leads its own process group, which the timeout kills whole.
+ */
+class ChildProcess final : public std::enable_shared_from_this<ChildProcess>
+{
+public:
+    struct Options
+    {
+        // Deliver output as it arrives instead of by line
+        bool chunks;
+        // Keep stdin open for write until close
+        bool input;
+        // Longest line buffered before it's delivered in pieces
+        std::size_t max_line;
+        // Bytes of stdin queued before write reports backpressure
+        std::size_t write_high_water;
+        // Kill the process group after this long; zero for no limit
+        std::chrono::milliseconds timeout;
+    };
+
+    struct Handlers
+    {
+        // "stdout" or "stderr", the text, and whether it's a piece of a longer line
+        std::function<void(std::string_view, std::string_view, bool)> output;
+        // Queued input fell back below the high-water mark
+        std::function<void()> drain;
+        // Exit code and whether the timeout killed the process
+        std::function<void(int, bool)> exit;
+    };
+
+private:
+    Handlers handlers_;
+    Options options_;
+
+    boost::process::async_pipe stdin_;
+    boost::process::async_pipe stdout_;
+    boost::process::async_pipe stderr_;
+    boost::process::child child_;
+    boost::asio::steady_timer timer_;
+
+    std::string write_queue_;
+    std::string write_inflight_;
+    bool writing_;
+    bool write_blocked_;
+    bool close_requested_;
+
+    // stdout, stderr, and the process itself
+    int running_;
+    bool exited_;
+    int exit_code_;
+    bool timed_out_;
+
+    auto read_stream(boost::process::async_pipe& pipe, std::string_view stream) -> boost::asio::awaitable<void>;
+    auto write_actual() -> void;
+    auto finished() -> void;
+
+public:
+    ChildProcess(boost::asio::io_context& io_context, Handlers handlers, Options const& options);
+
+    /**
+     * @brief Launch the child and start streaming its output
+     *
+     * @throws boost::process::process_error when the child can't be started
+     */
+    auto start(boost::asio::io_context& io_context, boost::filesystem::path const& file, std::vector<std::string> args) -> void;
+
+    /**
+     * @brief Queue bytes for the child's stdin
+     *
+     * @return true while the queue is at or below the high-water mark
+     */
+    auto write(std::string_view data) -> bool;
+
+    auto can_write() const -> bool
+    {
+        return not close_requested_;
+    }
+
+    /**
+     * @brief Close stdin once everything queued has been written
+     */
+    auto close_stdin() -> void;
+
+    auto pending() const -> std::size_t
+    {
+        return write_queue_.size() + write_inflight_.size();
+    }
+
+    auto kill(int signal) -> bool;
+
+    auto pid() const -> int
+    {
+        return child_.id();
+    }
+};
@@ -0,0 +1,222 @@
+#include "crypto_worker.hpp"
+
+#include "app.hpp"
+#include "metrics.hpp"
+#include "safecall.hpp"
+#include "strings.hpp"
+
+#include <digest.hpp>
+#include <pkey.hpp>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace {
+
+/**
+ * @brief Output bytes of a successful job or the error message of a failed one
+ */
+struct Outcome
+{
+    bool success;
+    std::string text;
+};
+
+// OpenSSL error queues are per thread so they are drained on the worker
+auto failure(char const* const func) -> Outcome
+{
+    std::string message = "OpenSSL error in ";
+    message += func;
+    ERR_print_errors_cb([](char const* const str, std::size_t const len, void* const u) {
+        auto& message = *static_cast<std::string*>(u);
+        message += '\n';
+        message.append(str, len);
+        return 1;
+    }, &message);
+    return {false, std::move(message)};
+}
+
+using PkeyPtr = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+using CtxPtr = std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)>;
+
+// Keep the key alive while a worker uses it even if Lua closes it
+auto share_pkey(EVP_PKEY* const pkey) -> PkeyPtr
+{
+    EVP_PKEY_up_ref(pkey);
+    return {pkey, EVP_PKEY_free};
+}
+
+auto derive(EVP_MD const* const digest, std::string const& password, std::string const& salt, int const iterations, int const keylen) -> Outcome
+{
+    std::string key(keylen, '\0');
+    if (0 == PKCS5_PBKDF2_HMAC(
+                 password.data(), password.size(),
+                 reinterpret_cast<unsigned char const*>(salt.data()), salt.size(),
+                 iterations, digest, keylen,
+                 reinterpret_cast<unsigned char*>(key.data())))
+    {
+        return failure("PKCS5_PBKDF2_HMAC");
+    }
+    return {true, std::move(key)};
+}
+
+auto sign(EVP_PKEY* const pkey, std::string const& data) -> Outcome
+{
+    CtxPtr const ctx{EVP_PKEY_CTX_new(pkey, nullptr), EVP_PKEY_CTX_free};
+    if (nullptr == ctx)
+    {
+        return failure("EVP_PKEY_CTX_new");
+    }
+    if (0 >= EVP_PKEY_sign_init(ctx.get()))
+    {
+        return failure("EVP_PKEY_sign_init");
+    }
+
+    auto const in = reinterpret_cast<unsigned char const*>(data.data());
+    std::size_t len;
+    if (0 >= EVP_PKEY_sign(ctx.get(), nullptr, &len, in, data.size()))
+    {
+        return failure("EVP_PKEY_sign");
+    }
+    std::string sig(len, '\0');
+    if (0 >= EVP_PKEY_sign(ctx.get(), reinterpret_cast<unsigned char*>(sig.data()), &len, in, data.size()))
+    {
+        return failure("EVP_PKEY_sign");
+    }
+    sig.resize(len);
+    return {true, std::move(sig)};
+}
+
+auto decrypt(EVP_PKEY* const pkey, std::string const& data, bool const oaep) -> Outcome
+{
+    CtxPtr const ctx{EVP_PKEY_CTX_new(pkey, nullptr), EVP_PKEY_CTX_free};
+    if (nullptr == ctx)
+    {
+        return failure("EVP_PKEY_CTX_new");
+    }
+    if (0 >= EVP_PKEY_decrypt_init(ctx.get()))
+    {
+        return failure("EVP_PKEY_decrypt_init");
+    }
+    if (oaep && 0 >= EVP_PKEY_CTX_set_rsa_padding(ctx.get(), RSA_PKCS1_OAEP_PADDING))
+    {
+        return failure("EVP_PKEY_CTX_set_rsa_padding");
+    }
+
+    auto const in = reinterpret_cast<unsigned char const*>(data.data());
+    std::size_t len;
+    if (0 >= EVP_PKEY_decrypt(ctx.get(), nullptr, &len, in, data.size()))
+    {
+        return failure("EVP_PKEY_decrypt");
+    }
+    std::string out(len, '\0');
+    if (0 >= EVP_PKEY_decrypt(ctx.get(), reinterpret_cast<unsigned char*>(out.data()), &len, in, data.size()))
+    {
+        return failure("EVP_PKEY_decrypt");
+    }
+    out.resize(len);
+    return {true, std::move(out)};
+}
+
+/**
+ * @brief Run a job on the worker pool and report its outcome to a callback
+ *
+ * The event loop is kept running until the callback has been called.
+ * Arguments are checked before calling this so no Lua error can skip
+ * the destructors of the job's captures.
+ *
+ * @param L Lua state
+ * @param callback Stack index of the callback function
+ * @param job Function returning an Outcome, run on a worker thread
+ */
+template <typename Job>
+auto submit(lua_State* const L, int const callback, Job job) -> void
+{
+    lua_pushvalue(L, callback);
+    auto const cb = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    auto const app = App::from_lua(L);
+    boost::asio::post(
+        app->get_worker_pool(),
+        [L = app->get_lua(), cb, job = std::move(job), work = boost::asio::make_work_guard(app->get_executor()), start = metrics::clock::now()]() mutable {
+            auto outcome = job();
+            boost::asio::post(work.get_executor(), [L, cb, outcome = std::move(outcome), start]() {
+                static auto& latency = metrics::histogram("snowcone_crypto_job_seconds", "Time to complete jobs on the crypto worker pool");
+                static auto& failures = metrics::counter("snowcone_crypto_job_errors_total", "Crypto worker jobs that failed");
+                latency.observe(metrics::clock::now() - start);
+
+                lua_rawgeti(L, LUA_REGISTRYINDEX, cb);
+                luaL_unref(L, LUA_REGISTRYINDEX, cb);
+
+                if (outcome.success)
+                {
+                    push_string(L, outcome.text);
+                    safecall(L, "crypto worker callback", 1);
+                }
+                else
+                {
+                    failures.add();
+                    luaL_pushfail(L);
+                    push_string(L, outcome.text);
+                    safecall(L, "crypto worker callback", 2);
+                }
+            });
+        }
+    );
+}
+
+} // namespace
+
+auto l_pbkdf2(lua_State* const L) -> int
+{
+    auto const digest = myopenssl::check_digest(L, 1);
+    auto const password = check_string_view(L, 2);
+    auto const salt = check_string_view(L, 3);
+    auto const iterations = luaL_checkinteger(L, 4);
+    auto const keylen = luaL_checkinteger(L, 5);
+    luaL_checkany(L, 6);
+    luaL_argcheck(L, 1 <= iterations && iterations <= INT_MAX, 4, "out of range");
+    luaL_argcheck(L, 0 <= keylen && keylen <= 1024, 5, "out of range");
+
+    submit(L, 6, [digest, password = std::string{password}, salt = std::string{salt}, iterations, keylen]() {
+        return derive(digest, password, salt, iterations, keylen);
+    });
+    return 0;
+}
+
+auto l_pkey_sign(lua_State* const L) -> int
+{
+    auto const pkey = myopenssl::check_pkey(L, 1);
+    auto const data = check_string_view(L, 2);
+    luaL_checkany(L, 3);
+
+    submit(L, 3, [pkey = share_pkey(pkey), data = std::string{data}]() {
+        return sign(pkey.get(), data);
+    });
+    return 0;
+}
+
+auto l_pkey_decrypt(lua_State* const L) -> int
+{
+    auto const pkey = myopenssl::check_pkey(L, 1);
+    auto const data = check_string_view(L, 2);
+    auto const oaep = 0 == std::strcmp("oaep", luaL_optstring(L, 3, ""));
+    luaL_checkany(L, 4);
+
+    submit(L, 4, [pkey = share_pkey(pkey), data = std::string{data}, oaep]() {
+        return decrypt(pkey.get(), data, oaep);
+    });
+    return 0;
+}
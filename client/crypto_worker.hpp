@@ -0,0 +1,42 @@
+#pragma once
+/**
+ * @file crypto_worker.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Expensive cryptographic operations run off the event loop
+ *
+ * Each function copies its inputs, runs on the application's worker
+ * thread pool, and calls its callback from the event loop with the
+ * result or nil and an error message.
+ */
+
+struct lua_State;
+
+/**
+ * @brief Derive a key with PBKDF2
+ *
+ * Lua arguments: digest, password, salt, iterations, key length, callback
+ *
+ * @param L Lua state
+ * @return 0
+ */
+auto l_pbkdf2(lua_State* L) -> int;
+
+/**
+ * @brief Sign data with a private key
+ *
+ * Lua arguments: pkey, data, callback
+ *
+ * @param L Lua state
+ * @return 0
+ */
+auto l_pkey_sign(lua_State* L) -> int;
+
+/**
+ * @brief Decrypt data with a private key
+ *
+ * Lua arguments: pkey, data, format ("oaep" or ""), callback
+ *
+ * @param L Lua state
+ * @return 0
+ */
+auto l_pkey_decrypt(lua_State* L) -> int;
@@ -10,21 +10,56 @@ extern "C" {
 #include <lua.h>
 }
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
-using Resolver = boost::asio::ip::tcp::resolver;
+namespace {
+
+/**
+ * @brief Lookups started by one Lua call
+ *
+ * The registry maps the address of the query to its callback, or for a
+ * batch to a table of the callback and the result tables being filled.
+ */
+struct Query
+{
+    DnsResolver* resolver;
+    std::vector<std::uint64_t> ids;
+    std::size_t remaining;
+
+    auto cancel(lua_State* const L) -> void
+    {
+        for (auto const id : ids)
+        {
+            resolver->cancel(id);
+        }
+        ids.clear();
+        lua_pushnil(L);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, this);
+    }
+};
+
+} // namespace
 
 template <>
-char const* udata_name<Resolver> = "dnslookup";
+char const* udata_name<Query> = "dnslookup";
 
 namespace {
 
 auto l_gc(lua_State* const L) -> int
 {
-    auto const resolver = check_udata<Resolver>(L, 1);
-    lua_pushnil(L);
-    lua_rawsetp(L, LUA_REGISTRYINDEX, resolver);
-    std::destroy_at(resolver);
+    auto const query = check_udata<Query>(L, 1);
+    query->cancel(L);
+    std::destroy_at(query);
+    return 0;
+}
+
+auto l_cancel(lua_State* const L) -> int
+{
+    check_udata<Query>(L, 1)->cancel(L);
     return 0;
 }
 
@@ -34,72 +69,230 @@ luaL_Reg const MT[] = {
 };
 
 luaL_Reg const Methods[] = {
-    {"cancel", [](auto const L) {
-         auto const resolver = check_udata<Resolver>(L, 1);
-         lua_pushnil(L);
-         lua_rawsetp(L, LUA_REGISTRYINDEX, resolver);
-         resolver->cancel();
-         return 0;
-     }},
+    {"cancel", l_cancel},
     {}
 };
 
-} // namespace
-
-auto l_dnslookup(lua_State* const L) -> int
+auto new_query(lua_State* const L, DnsResolver& resolver) -> Query*
 {
-    auto const hostname = check_string_view(L, 1);
-    luaL_checkany(L, 2); // callback
-    lua_settop(L, 2);
-    auto const app = App::from_lua(L);
-
-    auto const resolver = new_udata<Resolver>(L, 0, [L]() {
+    auto const query = new_udata<Query>(L, 0, [L]() {
         // Build metatable the first time
         luaL_setfuncs(L, MT, 0);
         luaL_newlibtable(L, Methods);
         luaL_setfuncs(L, Methods, 0);
         lua_setfield(L, -2, "__index");
     });
-    std::construct_at(resolver, app->get_executor());
+    std::construct_at(query, Query{&resolver, {}, 0});
+    return query;
+}
 
-    lua_rotate(L, -2, 1); // swap the callback and the udata
+auto push_names(lua_State* const L, std::vector<std::string> const& names) -> void
+{
+    lua_createtable(L, names.size(), 0);
+    lua_Integer i = 1;
+    for (auto const& name : names)
+    {
+        push_string(L, name);
+        lua_rawseti(L, -2, i++);
+    }
+}
 
-    // Store the callback
-    lua_rawsetp(L, LUA_REGISTRYINDEX, resolver);
+/**
+ * @brief Shared implementation of the single lookups
+ *
+ * Lua arguments: name, callback
+ */
+auto single(lua_State* const L, DnsResolver::Kind const kind) -> int
+{
+    auto const name = check_string_view(L, 1);
+    luaL_checkany(L, 2); // callback
+    lua_settop(L, 2);
+    auto const app = App::from_lua(L);
+    auto& resolver = app->get_dns_resolver();
 
-    resolver->async_resolve(hostname, "", [L = app->get_lua(), resolver](boost::system::error_code const error, Resolver::results_type const results) {
-        // on abort the callback has already been cleaned up
-        if (boost::asio::error::operation_aborted == error)
-            return;
+    auto const query = new_query(L, resolver);
+    lua_rotate(L, -2, 1); // swap the callback and the udata
+    lua_rawsetp(L, LUA_REGISTRYINDEX, query);
 
+    query->ids.push_back(resolver.lookup(kind, std::string{name}, [L = app->get_lua(), query](DnsResolver::Result const& result) {
         // get the callback
-        lua_rawgetp(L, LUA_REGISTRYINDEX, resolver);
+        lua_rawgetp(L, LUA_REGISTRYINDEX, query);
 
         // forget the callback
         lua_pushnil(L);
-        lua_rawsetp(L, LUA_REGISTRYINDEX, resolver);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, query);
+        query->ids.clear();
 
         int returns;
-
-        if (error)
+        if (result.error)
         {
             returns = 2;
             luaL_pushfail(L);
-            push_string(L, error.message());
+            push_string(L, result.error.message());
         }
         else
         {
             returns = 1;
-            lua_createtable(L, results.size(), 0);
-            lua_Integer i = 1;
-            for (auto&& result : results)
-            {
-                push_string(L, result.endpoint().address().to_string());
-                lua_rawseti(L, -2, i++);
-            }
+            push_names(L, result.names);
         }
         safecall(L, "dnslookup callback", returns);
-    });
+    }));
+
+    return 1;
+}
+
+} // namespace
+
+auto l_dnslookup(lua_State* const L) -> int
+{
+    return single(L, DnsResolver::Kind::forward);
+}
+
+auto l_dnsreverse(lua_State* const L) -> int
+{
+    return single(L, DnsResolver::Kind::reverse);
+}
+
+auto l_dnsbatch(lua_State* const L) -> int
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    luaL_checkany(L, 2); // callback
+    auto const reverse = lua_toboolean(L, 3);
+    lua_settop(L, 2);
+
+    auto const n = luaL_len(L, 1);
+    luaL_argcheck(L, n > 0, 1, "empty batch");
+
+    // Check every entry before building anything that needs destruction
+    for (lua_Integer i = 1; i <= n; i++)
+    {
+        luaL_argcheck(L, LUA_TSTRING == lua_geti(L, 1, i), 1, "batch entries must be strings");
+        lua_pop(L, 1);
+    }
+
+    std::vector<std::string> names;
+    names.reserve(n);
+    for (lua_Integer i = 1; i <= n; i++)
+    {
+        lua_geti(L, 1, i);
+        names.emplace_back(check_string_view(L, -1));
+        lua_pop(L, 1);
+    }
+
+    auto const app = App::from_lua(L);
+    auto& resolver = app->get_dns_resolver();
+
+    auto const query = new_query(L, resolver);
+    query->remaining = names.size();
+
+    // { callback, results, errors }
+    lua_createtable(L, 3, 0);
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, -2, 1);
+    lua_newtable(L);
+    lua_rawseti(L, -2, 2);
+    lua_newtable(L);
+    lua_rawseti(L, -2, 3);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, query);
+
+    auto const kind = reverse ? DnsResolver::Kind::reverse : DnsResolver::Kind::forward;
+    for (auto& name : names)
+    {
+        query->ids.push_back(resolver.lookup(kind, name, [L = app->get_lua(), query, name](DnsResolver::Result const& result) {
+            lua_rawgetp(L, LUA_REGISTRYINDEX, query);
+            auto const state = lua_absindex(L, -1);
+
+            if (result.error)
+            {
+                lua_rawgeti(L, state, 3);
+                push_string(L, name);
+                push_string(L, result.error.message());
+            }
+            else
+            {
+                lua_rawgeti(L, state, 2);
+                push_string(L, name);
+                push_names(L, result.names);
+            }
+            lua_rawset(L, -3);
+            lua_pop(L, 1);
 
+            if (0 == --query->remaining)
+            {
+                lua_rawgeti(L, state, 1);
+                lua_rawgeti(L, state, 2);
+                lua_rawgeti(L, state, 3);
+                lua_remove(L, state);
+
+                lua_pushnil(L);
+                lua_rawsetp(L, LUA_REGISTRYINDEX, query);
+                query->ids.clear();
+
+                safecall(L, "dnsbatch callback", 2);
+            }
+            else
+            {
+                lua_pop(L, 1);
+            }
+        }));
+    }
+
+    return 1;
+}
+
+auto l_dns_stats(lua_State* const L) -> int
+{
+    auto const stats = App::from_lua(L)->get_dns_resolver().stats();
+    lua_createtable(L, 0, 6);
+    lua_pushinteger(L, stats.hits);
+    lua_setfield(L, -2, "hits");
+    lua_pushinteger(L, stats.misses);
+    lua_setfield(L, -2, "misses");
+    lua_pushinteger(L, stats.evictions);
+    lua_setfield(L, -2, "evictions");
+    lua_pushinteger(L, stats.entries);
+    lua_setfield(L, -2, "entries");
+    lua_pushinteger(L, stats.queued);
+    lua_setfield(L, -2, "queued");
+    lua_pushinteger(L, stats.running);
+    lua_setfield(L, -2, "running");
     return 1;
 }
+
+auto l_set_dns_options(lua_State* const L) -> int
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    auto& resolver = App::from_lua(L)->get_dns_resolver();
+    auto options = resolver.get_options();
+
+    auto const field = [L](char const* const key, lua_Integer const current) {
+        lua_getfield(L, 1, key);
+        int isnum;
+        auto const value = lua_tointegerx(L, -1, &isnum);
+        auto const present = not lua_isnil(L, -1);
+        lua_pop(L, 1);
+        if (present && not isnum)
+        {
+            luaL_error(L, "%s must be an integer", key);
+        }
+        return present ? value : current;
+    };
+
+    using std::chrono::duration_cast;
+    using std::chrono::seconds;
+    auto const concurrency = field("concurrency", options.concurrency);
+    auto const ttl = field("ttl", duration_cast<seconds>(options.ttl).count());
+    auto const negative_ttl = field("negative_ttl", duration_cast<seconds>(options.negative_ttl).count());
+    auto const capacity = field("capacity", options.capacity);
+
+    luaL_argcheck(L, 1 <= concurrency && concurrency <= lua_Integer{DnsResolver::max_concurrency}, 1, "concurrency out of range");
+    luaL_argcheck(L, 0 <= ttl && 0 <= negative_ttl, 1, "ttl must be non-negative");
+    luaL_argcheck(L, 1 <= capacity, 1, "capacity must be positive");
+
+    options.concurrency = concurrency;
+    options.ttl = seconds{ttl};
+    options.negative_ttl = seconds{negative_ttl};
+    options.capacity = capacity;
+    resolver.set_options(options);
+    return 0;
+}
@@ -15,6 +15,50 @@ struct lua_State;
  * or nil and an error message
  *
  * @param L Lua state
- * @return 0
+ * @return 1 - handle with a cancel method
  */
 auto l_dnslookup(lua_State* L) -> int;
+
+/**
+ * @brief Perform a reverse (PTR) dns lookup
+ *
+ * Lua arguments: address, callback. The callback gets the list of
+ * host names or nil and an error message.
+ *
+ * @param L Lua state
+ * @return 1 - handle with a cancel method
+ */
+auto l_dnsreverse(lua_State* L) -> int;
+
+/**
+ * @brief Look up many names with one callback
+ *
+ * Lua arguments: list of names, callback, reverse flag. The callback
+ * gets a table mapping each name that resolved to its list of results
+ * and a table mapping each name that failed to an error message.
+ *
+ * @param L Lua state
+ * @return 1 - handle with a cancel method
+ */
+auto l_dnsbatch(lua_State* L) -> int;
+
+/**
+ * @brief Get resolver cache statistics
+ *
+ * Returns a table with hits, misses, evictions, entries, queued, and running.
+ *
+ * @param L Lua state
+ * @return 1
+ */
+auto l_dns_stats(lua_State* L) -> int;
+
+/**
+ * @brief Configure the resolver
+ *
+ * Takes a table with any of concurrency, ttl and negative_ttl in
+ * seconds, and capacity.
+ *
+ * @param L Lua state
+ * @return 0
+ */
+auto l_set_dns_options(lua_State* L) -> int;
@@ -1,5 +1,7 @@
 #include "irc_connection.hpp"
 
+#include "../metrics.hpp"
+
 #include <socks5.hpp>
 
 extern "C" {
@@ -9,8 +11,10 @@ extern "C" {
 
 #include <boost/io/ios_state.hpp>
 
+#include <algorithm>
 #include <array>
 #include <iomanip>
+#include <utility>
 #include <vector>
 
 irc_connection::irc_connection(
@@ -20,45 +24,84 @@ irc_connection::irc_connection(
 )
     : stream_{boost::asio::ip::tcp::socket{io_context}}
     , resolver_{io_context}
+    , connector_{io_context.get_executor()}
     , L{L}
+    , write_inflight_{0}
     , writing_{false}
+    , write_high_water_{write_high_water}
+    , write_low_water_{write_low_water}
+    , write_blocked_{false}
+    , flood_queued_{0}
+    , flood_burst_{0}
+    , flood_interval_{}
+    , flood_tokens_{}
+    , flood_refilled_{}
+    , flood_timer_{io_context}
+    , flood_timer_armed_{false}
 {
 }
 
-irc_connection::~irc_connection()
+irc_connection::~irc_connection() = default;
+
+auto irc_connection::enqueue(std::string_view const bytes) -> void
 {
-    for (auto const ref : write_refs)
+    write_queue_.insert(write_queue_.end(), bytes.begin(), bytes.end());
+    if (not writing_)
     {
-        luaL_unref(L, LUA_REGISTRYINDEX, ref);
+        writing_ = true;
+        write_actual();
     }
 }
 
-auto irc_connection::write(std::string_view const cmd, int const ref) -> void
+auto irc_connection::write(std::string_view const cmd, send_priority const priority) -> bool
 {
-    write_buffers.emplace_back(cmd.data(), cmd.size());
-    write_refs.emplace_back(ref);
-    if (not writing_)
+    if (0 == flood_burst_)
     {
-        writing_ = true;
-        write_actual();
+        enqueue(cmd);
+    }
+    else
+    {
+        flood_queues_[static_cast<std::size_t>(priority)].data.append(cmd);
+        flood_queued_ += cmd.size();
+        flood_release();
     }
+
+    auto const ok = pending() <= write_high_water_;
+    if (not ok)
+    {
+        write_blocked_ = true;
+    }
+    return ok;
 }
 
 auto irc_connection::write_actual() -> void
 {
+    // The in-flight buffer moves into the completion handler so that it
+    // outlives this object. Moving a vector keeps its data pointer.
+    auto buffer = std::exchange(write_queue_, std::move(write_spare_));
+    write_queue_.clear();
+    write_inflight_ = buffer.size();
+
+    static auto& writes = metrics::counter("snowcone_irc_writes_total", "Writes issued to IRC connections");
+    writes.add();
+
+    auto const data = boost::asio::buffer(buffer);
     boost::asio::async_write(
         stream_,
-        write_buffers,
-        [weak = weak_from_this(), L = L, refs = std::move(write_refs)](boost::system::error_code const& error, std::size_t) {
-            for (auto const ref : refs)
-            {
-                luaL_unref(L, LUA_REGISTRYINDEX, ref);
-            }
+        data,
+        [weak = weak_from_this(), buffer = std::move(buffer)](boost::system::error_code const& error, std::size_t const n) mutable {
+            static auto& bytes_written = metrics::counter("snowcone_irc_bytes_written_total", "Bytes written to IRC connections");
+            bytes_written.add(n);
+
             if (not error)
             {
                 if (auto const self = weak.lock())
                 {
-                    if (self->write_buffers.empty())
+                    buffer.clear();
+                    self->write_spare_ = std::move(buffer);
+                    self->write_inflight_ = 0;
+
+                    if (self->write_queue_.empty())
                     {
                         self->writing_ = false;
                     }
@@ -66,17 +109,89 @@ auto irc_connection::write_actual() -> void
                     {
                         self->write_actual();
                     }
+
+                    if (self->write_blocked_ && self->pending() <= self->write_low_water_)
+                    {
+                        self->write_blocked_ = false;
+                        if (self->on_drain_)
+                        {
+                            self->on_drain_();
+                        }
+                    }
                 }
             }
         }
     );
-    write_buffers.clear();
-    write_refs.clear();
+}
+
+auto irc_connection::set_flood_limits(std::size_t const burst, std::chrono::steady_clock::duration const interval) -> void
+{
+    flood_burst_ = burst;
+    flood_interval_ = interval;
+    flood_tokens_ = flood_capacity(); // start with a full bucket
+    flood_refilled_ = std::chrono::steady_clock::now();
+
+    // Lines held under the old limits are sent under the new ones
+    flood_release();
+}
+
+auto irc_connection::flood_release() -> void
+{
+    auto const now = std::chrono::steady_clock::now();
+    flood_tokens_ = std::min(flood_tokens_ + (now - flood_refilled_), flood_capacity());
+    flood_refilled_ = now;
+
+    for (auto& queue : flood_queues_)
+    {
+        while (queue.start < queue.data.size() && (0 == flood_burst_ || flood_tokens_ >= flood_interval_))
+        {
+            auto const nl = queue.data.find('\n', queue.start);
+            auto const end = nl == std::string::npos ? queue.data.size() : nl + 1;
+            auto const line = std::string_view{queue.data}.substr(queue.start, end - queue.start);
+
+            enqueue(line);
+            flood_queued_ -= line.size();
+            flood_tokens_ -= flood_interval_;
+            queue.start = end;
+        }
+
+        if (queue.start == queue.data.size())
+        {
+            queue.data.clear();
+            queue.start = 0;
+        }
+        else
+        {
+            break; // lower classes wait behind this one
+        }
+    }
+
+    if (0 == flood_burst_)
+    {
+        flood_tokens_ = {};
+    }
+    else if (0 < flood_queued_ && not flood_timer_armed_)
+    {
+        flood_timer_armed_ = true;
+        flood_timer_.expires_after(flood_interval_ - flood_tokens_);
+        flood_timer_.async_wait([weak = weak_from_this()](boost::system::error_code const& error) {
+            if (not error)
+            {
+                if (auto const self = weak.lock())
+                {
+                    self->flood_timer_armed_ = false;
+                    self->flood_release();
+                }
+            }
+        });
+    }
 }
 
 auto irc_connection::close() -> void
 {
+    flood_timer_.cancel();
     resolver_.cancel();
+    connector_.cancel();
     stream_.close();
 }
 
@@ -167,32 +282,6 @@ auto set_alpn(tls_type& stream) -> void
     SSL_set_alpn_protos(stream.native_handle(), protos.data(), protos.size());
 }
 
-auto build_ssl_context(
-    X509* client_cert,
-    EVP_PKEY* client_key
-) -> boost::asio::ssl::context
-{
-    boost::system::error_code error;
-    boost::asio::ssl::context ssl_context{boost::asio::ssl::context::method::tls_client};
-    ssl_context.set_default_verify_paths();
-
-    if (nullptr != client_cert)
-    {
-        if (1 != SSL_CTX_use_certificate(ssl_context.native_handle(), client_cert))
-        {
-            throw std::runtime_error{"certificate file"};
-        }
-    }
-    if (nullptr != client_key)
-    {
-        if (1 != SSL_CTX_use_PrivateKey(ssl_context.native_handle(), client_key))
-        {
-            throw std::runtime_error{"private key"};
-        }
-    }
-    return ssl_context;
-}
-
 } // namespace
 
 auto irc_connection::connect(
@@ -201,6 +290,10 @@ auto irc_connection::connect(
 {
     std::ostringstream os;
 
+    // TLS sessions are remembered for the IRC server, not the SOCKS proxy
+    std::ostringstream peer;
+    peer << settings.host << ' ' << settings.port << ' ' << settings.sni << ' ' << settings.verify;
+
     // replace previous socket and ensure it's a tcp socket
     auto& socket = stream_.emplace<tcp_type>(stream_.get_executor());
 
@@ -217,7 +310,25 @@ auto irc_connection::connect(
     {
         auto const entries = co_await resolver_.async_resolve(settings.host, std::to_string(settings.port), boost::asio::use_awaitable);
 
-        os << "tcp=" << co_await boost::asio::async_connect(socket, entries, boost::asio::use_awaitable);
+        std::vector<HappyEyeballs::endpoint_type> endpoints;
+        for (auto const& entry : entries)
+        {
+            endpoints.push_back(entry.endpoint());
+        }
+
+        socket = co_await connector_.connect(std::move(endpoints));
+        os << "tcp=" << socket.remote_endpoint() << " attempts=" << connector_.attempts();
+
+        static auto& latency4 = metrics::histogram("snowcone_tcp_connect_seconds", "Time to complete TCP connection attempts", metrics::label("family", "ipv4"));
+        static auto& latency6 = metrics::histogram("snowcone_tcp_connect_seconds", "Time to complete TCP connection attempts", metrics::label("family", "ipv6"));
+        for (auto const& attempt : connector_.attempts())
+        {
+            // Abandoned attempts say more about the winner than about themselves
+            if (attempt.error != boost::asio::error::operation_aborted)
+            {
+                (attempt.endpoint.address().is_v6() ? latency6 : latency4).observe(attempt.elapsed);
+            }
+        }
 
         socket.set_option(boost::asio::ip::tcp::no_delay(true));
         set_buffer_size(socket, settings.buffer_size);
@@ -241,10 +352,11 @@ auto irc_connection::connect(
     // Optionally negotiate TLS session
     if (settings.tls)
     {
-        auto cxt = build_ssl_context(settings.client_cert, settings.client_key);
+        auto const context = settings.tls_cache->context(settings.client_cert, settings.client_key);
 
         // Upgrade stream_ to use TLS and invalidate socket
-        auto& stream = stream_.emplace<tls_type>(tls_type{std::move(socket), cxt});
+        auto& stream = stream_.emplace<tls_type>(tls_type{std::move(socket), context->ssl_context});
+        settings.tls_cache->prepare(stream.native_handle(), *context, peer.str());
 
         set_buffer_size(stream, settings.buffer_size);
         set_alpn(stream);
@@ -263,6 +375,14 @@ auto irc_connection::connect(
         co_await stream.async_handshake(stream.client, boost::asio::use_awaitable);
 
         peer_fingerprint(os << " tls=", stream.native_handle());
+
+        static auto& resumed = metrics::counter("snowcone_tls_sessions_resumed_total", "TLS handshakes that resumed a previous session");
+        auto const reused = SSL_session_reused(stream.native_handle());
+        if (reused)
+        {
+            resumed.add();
+        }
+        os << " resumed=" << (reused ? "yes" : "no");
     }
 
     co_return os.str();
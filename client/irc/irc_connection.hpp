@@ -1,19 +1,37 @@
 #pragma once
 
+#include "../net/happy_eyeballs.hpp"
 #include "../net/stream.hpp"
+#include "../net/tls_cache.hpp"
 
 #include <boost/asio.hpp>
 
 #include <openssl/evp.h>
 #include <openssl/x509.h>
 
+#include <array>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 struct lua_State;
 
+/**
+ * @brief Scheduling class of an outgoing message under flood control
+ *
+ * Queued lines of a higher class are always sent before lines of a
+ * lower class. Lines within a class keep their order.
+ */
+enum class send_priority
+{
+    high,   // PONG and anything the server must see promptly
+    normal, // interactive commands
+    bulk,   // large uploads and periodic polling
+};
+
 struct Settings
 {
     bool tls;
@@ -22,6 +40,8 @@ struct Settings
 
     X509* client_cert;
     EVP_PKEY* client_key;
+    // Shared contexts and resumable sessions
+    TlsCache* tls_cache;
     std::string verify;
     std::string sni;
 
@@ -31,6 +51,13 @@ struct Settings
     std::string socks_pass;
 
     std::size_t buffer_size;
+    std::size_t buffer_limit;
+
+    // Deliver all messages from one read as a single MSGS event
+    bool batch;
+
+    // Deliver messages as lazily materialized userdata instead of tables
+    bool lazy;
 };
 
 class irc_connection final : public std::enable_shared_from_this<irc_connection>
@@ -38,15 +65,46 @@ class irc_connection final : public std::enable_shared_from_this<irc_connection>
 public:
     using stream_type = CommonStream;
     static std::size_t const irc_buffer_size = 131'072;
+    static std::size_t const write_high_water = 131'072;
+    static std::size_t const write_low_water = 32'768;
 
 private:
     stream_type stream_;
     boost::asio::ip::tcp::resolver resolver_;
-    std::vector<int> write_refs;
-    std::vector<boost::asio::const_buffer> write_buffers;
+    HappyEyeballs connector_;
     lua_State* L;
+
+    // Outgoing bytes not yet handed to the stream
+    std::vector<char> write_queue_;
+    // Empty buffer retained from the last completed write for reuse
+    std::vector<char> write_spare_;
+    // Bytes handed to the stream that haven't completed
+    std::size_t write_inflight_;
     bool writing_;
 
+    std::size_t write_high_water_;
+    std::size_t write_low_water_;
+    // Set when the queue crossed the high-water mark, cleared by drain
+    bool write_blocked_;
+    std::function<void()> on_drain_;
+
+    // Flood control: a token bucket holding up to flood_burst_ lines,
+    // refilled by one line every flood_interval_. Disabled when the
+    // burst is zero.
+    struct FloodQueue
+    {
+        std::string data;
+        std::size_t start = 0; // bytes of data already released
+    };
+    std::array<FloodQueue, 3> flood_queues_;
+    std::size_t flood_queued_;
+    std::size_t flood_burst_;
+    std::chrono::steady_clock::duration flood_interval_;
+    std::chrono::steady_clock::duration flood_tokens_; // credit measured in time
+    std::chrono::steady_clock::time_point flood_refilled_;
+    boost::asio::steady_timer flood_timer_;
+    bool flood_timer_armed_;
+
     struct Private
     {
     };
@@ -80,14 +138,59 @@ public:
         return L;
     }
 
-    // Queue messages for writing
     /**
      * @brief Write a message to the output stream
      *
+     * Messages are copied into a contiguous queue so that everything
+     * queued while a write is in flight goes out in the next write.
+     *
+     * With flood control enabled each line waits in the queue of its
+     * priority class until the token bucket releases it.
+     *
      * @param msg The string to write including any needed line-terminators
-     * @param ref A reference generated by luaL_ref keeping this string valid
+     * @param priority Scheduling class used by flood control
+     * @return true while the queue is at or below the high-water mark
+     */
+    auto write(std::string_view msg, send_priority priority = send_priority::normal) -> bool;
+
+    /**
+     * @brief Number of bytes queued, held by flood control, or being written
+     */
+    auto pending() const -> std::size_t
+    {
+        return write_queue_.size() + write_inflight_ + flood_queued_;
+    }
+
+    /**
+     * @brief Configure the flood control token bucket
+     *
+     * @param burst Lines that can be sent back-to-back; 0 disables flood control
+     * @param interval Time to earn credit for one more line
+     */
+    auto set_flood_limits(std::size_t burst, std::chrono::steady_clock::duration interval) -> void;
+
+    /**
+     * @brief Configure write queue backpressure
+     *
+     * Once the queue grows past the high-water mark the drain handler
+     * runs the next time it falls to the low-water mark.
+     *
+     * @param high Bytes pending before writes report backpressure
+     * @param low Bytes pending at which the drain handler runs
      */
-    auto write(std::string_view msg, int ref) -> void;
+    auto set_write_limits(std::size_t high, std::size_t low) -> void
+    {
+        write_high_water_ = high;
+        write_low_water_ = low;
+    }
+
+    /**
+     * @brief Set the function to run when a full write queue drains
+     */
+    auto set_drain_handler(std::function<void()> handler) -> void
+    {
+        on_drain_ = std::move(handler);
+    }
 
     auto close() -> void;
 
@@ -96,4 +199,17 @@ public:
 private:
     // There's data now, actually write it
     auto write_actual() -> void;
+
+    // Append bytes to the write queue and start writing if idle
+    auto enqueue(std::string_view bytes) -> void;
+
+    // Credit of a full token bucket
+    auto flood_capacity() const -> std::chrono::steady_clock::duration
+    {
+        return static_cast<std::chrono::steady_clock::duration::rep>(flood_burst_) * flood_interval_;
+    }
+
+    // Release as many flood-controlled lines as the bucket allows and
+    // arm the timer for the rest
+    auto flood_release() -> void;
 };
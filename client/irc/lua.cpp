@@ -1,6 +1,7 @@
 #include "lua.hpp"
 #include "../app.hpp"
 #include "../linebuffer.hpp"
+#include "../metrics.hpp"
 #include "../safecall.hpp"
 #include "../strings.hpp"
 #include "../userdata.hpp"
@@ -16,7 +17,6 @@ extern "C" {
 #include <lua.h>
 }
 
-#include <charconv> // from_chars
 #include <fcntl.h>
 #include <memory>
 #include <string>
@@ -57,11 +57,11 @@ auto l_send_irc(lua_State* const L) -> int
         // Wait until after luaL_error to start putting things on the
         // stack that have destructors
         auto const cmd = check_string_view(L, 2);
-        lua_settop(L, 2);
-        auto const ref = luaL_ref(L, LUA_REGISTRYINDEX);
-        irc->write(cmd, ref);
+        char const* const priorities[] = {"high", "normal", "bulk", nullptr};
+        auto const priority = static_cast<send_priority>(luaL_checkoption(L, 3, "normal", priorities));
 
-        lua_pushboolean(L, 1);
+        // false reports backpressure, the message is still queued
+        lua_pushboolean(L, irc->write(cmd, priority));
         return 1;
     }
     else
@@ -72,6 +72,23 @@ auto l_send_irc(lua_State* const L) -> int
     }
 }
 
+auto l_pending_irc(lua_State* const L) -> int
+{
+    auto const w = check_udata<std::weak_ptr<irc_connection>>(L, 1);
+
+    if (auto const irc = w->lock())
+    {
+        lua_pushinteger(L, irc->pending());
+        return 1;
+    }
+    else
+    {
+        luaL_pushfail(L);
+        push_string(L, "irc handle destructed"sv);
+        return 2;
+    }
+}
+
 auto pushirc(lua_State* const L, std::weak_ptr<irc_connection> const irc) -> void
 {
     auto const w = new_udata<std::weak_ptr<irc_connection>>(L, 1, [L]() {
@@ -91,6 +108,7 @@ auto pushirc(lua_State* const L, std::weak_ptr<irc_connection> const irc) -> voi
         luaL_Reg const Methods[]{
             {"send", l_send_irc},
             {"close", l_close_irc},
+            {"pending", l_pending_irc},
             {}
         };
         luaL_newlibtable(L, Methods);
@@ -118,6 +136,93 @@ auto get_nonempty_line(LineBuffer& buff) -> char*
     return line;
 }
 
+/**
+ * @brief Parse a line and push it in the connection's message representation
+ *
+ * @throw irc_parse_error on failure leaving the stack unchanged
+ */
+auto push_message(lua_State* const L, char* const line, ircmsg& msg, bool const lazy) -> void
+{
+    static auto& messages = metrics::counter("snowcone_irc_messages_total", "IRC messages received");
+    static auto& failures = metrics::counter("snowcone_irc_parse_errors_total", "IRC messages that failed to parse");
+
+    try
+    {
+        if (lazy)
+        {
+            push_lazy_ircmsg(L, line);
+        }
+        else
+        {
+            parse_irc_message(line, msg);
+            pushircmsg(L, msg);
+        }
+    }
+    catch (irc_parse_error const&)
+    {
+        failures.add();
+        throw;
+    }
+    messages.add();
+}
+
+/**
+ * @brief Deliver each complete line in the buffer as its own MSG event
+ *
+ * The final message of the batch is flagged so that Lua knows to draw.
+ */
+auto dispatch_lines(lua_State* const L, int const irc_cb, LineBuffer& buff, ircmsg& msg, bool const lazy) -> void
+{
+    for (auto line = get_nonempty_line(buff); nullptr != line; /* empty */)
+    {
+        push_message(L, line, msg, lazy); // might throw
+        line = get_nonempty_line(buff); // pre-load next line
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, irc_cb);
+        push_string(L, "MSG"sv);
+        lua_rotate(L, -3, 2); // move the message after the callback and event
+        lua_pushboolean(L, nullptr == line); // draw on last line
+        safecall(L, "irc message", 3);
+    }
+}
+
+/**
+ * @brief Deliver all complete lines in the buffer as one MSGS event
+ *
+ * The messages are collected in order into a single array so the
+ * whole read costs one protected call. Lua draws after the batch.
+ */
+auto dispatch_batch(lua_State* const L, int const irc_cb, LineBuffer& buff, ircmsg& msg, bool const lazy) -> void
+{
+    auto line = get_nonempty_line(buff);
+    if (nullptr == line)
+    {
+        return;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, irc_cb);
+    push_string(L, "MSGS"sv);
+    lua_newtable(L);
+
+    try
+    {
+        lua_Integer n = 0;
+        for (; nullptr != line; line = get_nonempty_line(buff))
+        {
+            push_message(L, line, msg, lazy); // might throw
+            lua_rawseti(L, -2, ++n);
+        }
+    }
+    catch (...)
+    {
+        // deliver the messages preceding the bad line as the unbatched mode would
+        safecall(L, "irc messages", 2);
+        throw;
+    }
+
+    safecall(L, "irc messages", 2);
+}
+
 auto session_thread(
     boost::asio::io_context& io_context,
     int const irc_cb,
@@ -126,6 +231,10 @@ auto session_thread(
 ) -> boost::asio::awaitable<void>
 {
     auto const L = irc->get_lua();
+    auto const buffer_size = settings.buffer_size;
+    auto const buffer_limit = settings.buffer_limit;
+    auto const batch = settings.batch;
+    auto const lazy = settings.lazy;
 
     {
         auto const fingerprint = co_await irc->connect(std::move(settings));
@@ -136,7 +245,12 @@ auto session_thread(
         safecall(L, "successful connect", 2);
     }
 
-    for (LineBuffer buff{irc_connection::irc_buffer_size};;)
+    // Reused across lines so that steady-state parsing doesn't allocate
+    ircmsg msg;
+
+    static auto& bytes_read = metrics::counter("snowcone_irc_bytes_read_total", "Bytes read from IRC connections");
+
+    for (LineBuffer buff{buffer_size, buffer_limit};;)
     {
         auto const target = buff.get_buffer();
         if (target.size() == 0)
@@ -144,17 +258,16 @@ auto session_thread(
             throw std::runtime_error{"line buffer full"};
         }
 
-        buff.add_bytes(co_await irc->get_stream().async_read_some(target, boost::asio::use_awaitable));
-        for (auto line = get_nonempty_line(buff); nullptr != line; /* empty */)
+        auto const n = co_await irc->get_stream().async_read_some(target, boost::asio::use_awaitable);
+        bytes_read.add(n);
+        buff.add_bytes(n);
+        if (batch)
         {
-            auto const msg = parse_irc_message(line); // might throw
-            line = get_nonempty_line(buff); // pre-load next line
-
-            lua_rawgeti(L, LUA_REGISTRYINDEX, irc_cb);
-            push_string(L, "MSG"sv);
-            pushircmsg(L, msg);
-            lua_pushboolean(L, nullptr == line); // draw on last line
-            safecall(L, "irc message", 3);
+            dispatch_batch(L, irc_cb, buff, msg, lazy);
+        }
+        else
+        {
+            dispatch_lines(L, irc_cb, buff, msg, lazy);
         }
     }
 }
@@ -175,18 +288,32 @@ auto l_start_irc(lua_State* const L) -> int
     auto const socks_user = luaL_optlstring(L, 10, "", nullptr);
     auto const socks_pass = luaL_optlstring(L, 11, "", nullptr);
     luaL_checkany(L, 12); // callback
+    auto const buffer_limit = opt_integer_field(L, 13, "buffer_limit", irc_connection::irc_buffer_size);
+    auto const batch = opt_boolean_field(L, 13, "batch");
+    auto const lazy = opt_boolean_field(L, 13, "lazy");
+    auto const high_water = opt_integer_field(L, 13, "write_high_water", irc_connection::write_high_water);
+    auto const low_water = opt_integer_field(L, 13, "write_low_water", irc_connection::write_low_water);
+    auto const flood_burst = opt_integer_field(L, 13, "flood_burst", 0);
+    auto const flood_interval = opt_integer_field(L, 13, "flood_interval", 2'000);
     lua_settop(L, 12);
     luaL_argcheck(L, 1 <= port && port <= 0xffff, 3, "port out of range");
     luaL_argcheck(L, 0 <= socks_port && socks_port <= 0xffff, 9, "port out of range");
+    luaL_argcheck(L, 0 <= buffer_limit, 13, "buffer_limit out of range");
+    luaL_argcheck(L, 0 <= low_water && low_water <= high_water, 13, "write water marks out of range");
+    luaL_argcheck(L, 0 <= flood_burst, 13, "flood_burst out of range");
+    luaL_argcheck(L, 0 < flood_interval, 13, "flood_interval out of range");
 
     auto const irc_cb = luaL_ref(L, LUA_REGISTRYINDEX);
 
+    auto& a = *App::from_lua(L);
+
     Settings settings = {
         .tls = static_cast<bool>(tls),
         .host = host,
         .port = static_cast<std::uint16_t>(port),
         .client_cert = client_cert,
         .client_key = client_key,
+        .tls_cache = &a.get_tls_cache(),
         .verify = verify,
         .sni = sni,
         .socks_host = socks_host,
@@ -194,18 +321,28 @@ auto l_start_irc(lua_State* const L) -> int
         .socks_user = socks_user,
         .socks_pass = socks_pass,
         .buffer_size = irc_connection::irc_buffer_size,
+        .buffer_limit = static_cast<std::size_t>(buffer_limit),
+        .batch = batch,
+        .lazy = lazy,
     };
 
-    auto& a = *App::from_lua(L);
     auto& io_context = a.get_executor();
     auto const LMain = a.get_lua();
 
     auto const irc = irc_connection::create(io_context, LMain);
+    irc->set_write_limits(high_water, low_water);
+    irc->set_flood_limits(flood_burst, std::chrono::milliseconds{flood_interval});
+    irc->set_drain_handler([L = LMain, irc_cb]() {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, irc_cb);
+        push_string(L, "DRAIN"sv);
+        safecall(L, "write queue drained", 1);
+    });
     pushirc(L, irc);
 
     boost::asio::co_spawn(
         io_context, session_thread(io_context, irc_cb, irc, std::move(settings)),
-        [L = LMain, irc_cb](std::exception_ptr const e) {
+        [L = LMain, irc_cb, irc](std::exception_ptr const e) {
+            irc->set_drain_handler({}); // irc_cb is released below
             lua_rawgeti(L, LUA_REGISTRYINDEX, irc_cb);
             luaL_unref(L, LUA_REGISTRYINDEX, irc_cb);
             push_string(L, "END"sv);
@@ -230,48 +367,5 @@ auto l_start_irc(lua_State* const L) -> int
     return 1;
 }
 
-auto pushircmsg(lua_State* const L, ircmsg const& msg) -> void
-{
-    lua_createtable(L, msg.args.size(), 3);
-    pushtags(L, msg.tags);
-    lua_setfield(L, -2, "tags");
-
-    if (not msg.source.empty())
-    {
-        push_string(L, msg.source);
-        lua_setfield(L, -2, "source");
-    }
-
-    lua_Integer code;
-    auto const [last, ec] = std::from_chars(msg.command.begin(), msg.command.end(), code);
-    if (ec == std::errc{} && last == msg.command.end())
-    {
-        lua_pushinteger(L, code);
-    }
-    else
-    {
-        push_string(L, msg.command);
-    }
-    lua_setfield(L, -2, "command");
-
-    int argix = 1;
-    for (auto const arg : msg.args)
-    {
-        push_string(L, arg);
-        lua_rawseti(L, -2, argix++);
-    }
-}
-
-auto pushtags(lua_State* const L, std::vector<irctag> const& tags) -> void
-{
-    lua_createtable(L, 0, tags.size());
-    for (auto&& tag : tags)
-    {
-        push_string(L, tag.key);
-        push_string(L, tag.val);
-        lua_settable(L, -3);
-    }
-}
-
 template <>
 char const* udata_name<std::weak_ptr<irc_connection>> = "irc_connection";
@@ -6,6 +6,7 @@
  *
  */
 
+#include <string_view>
 #include <vector>
 
 struct lua_State;
@@ -19,3 +20,17 @@ auto l_start_irc(lua_State* L) -> int;
 
 auto pushtags(lua_State* L, std::vector<irctag> const& tags) -> void;
 auto pushircmsg(lua_State* const L, ircmsg const& msg) -> void;
+
+/**
+ * @brief Parse a line and push it as a lazily materialized message object
+ *
+ * The object copies the line and behaves like the table built by
+ * pushircmsg, but only creates Lua values for the command, source,
+ * tags and arguments when they are accessed. Fields assigned from
+ * Lua are kept on the object. Method totable returns a plain table.
+ *
+ * @param L Lua state
+ * @param line raw IRC message
+ * @throw irc_parse_error on failure leaving the stack unchanged
+ */
+auto push_lazy_ircmsg(lua_State* L, std::string_view line) -> void;
@@ -0,0 +1,241 @@
+#include "lua.hpp"
+#include "../strings.hpp"
+#include "../userdata.hpp"
+
+#include <ircmsg.hpp>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+#include <charconv> // from_chars
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace {
+
+using namespace std::literals::string_view_literals;
+
+/**
+ * @brief Push a command, converting numerics to integers
+ */
+auto push_command(lua_State* const L, std::string_view const command) -> void
+{
+    lua_Integer code;
+    auto const [last, ec] = std::from_chars(command.begin(), command.end(), code);
+    if (ec == std::errc{} && last == command.end())
+    {
+        lua_pushinteger(L, code);
+    }
+    else
+    {
+        push_string(L, command);
+    }
+}
+
+} // namespace
+
+auto pushtags(lua_State* const L, std::vector<irctag> const& tags) -> void
+{
+    lua_createtable(L, 0, tags.size());
+    for (auto&& tag : tags)
+    {
+        push_string(L, tag.key);
+        push_string(L, tag.val);
+        lua_rawset(L, -3);
+    }
+}
+
+auto pushircmsg(lua_State* const L, ircmsg const& msg) -> void
+{
+    lua_createtable(L, msg.args.size(), 3);
+    pushtags(L, msg.tags);
+    lua_setfield(L, -2, "tags");
+
+    if (not msg.source.empty())
+    {
+        push_string(L, msg.source);
+        lua_setfield(L, -2, "source");
+    }
+
+    push_command(L, msg.command);
+    lua_setfield(L, -2, "command");
+
+    int argix = 1;
+    for (auto const arg : msg.args)
+    {
+        push_string(L, arg);
+        lua_rawseti(L, -2, argix++);
+    }
+}
+
+/**
+ * @brief IRC message object that builds its Lua fields on demand
+ *
+ * The object owns a copy of the raw line and the parsed views into it.
+ */
+struct LazyIrcMsg
+{
+    std::string line;
+    ircmsg msg;
+};
+
+template <>
+char const* udata_name<LazyIrcMsg> = "ircmsg";
+
+namespace {
+
+/**
+ * @brief Push the field cache of a message object, creating it if needed
+ *
+ * Fields are materialized into this table on first access. Fields
+ * assigned from Lua are stored here too.
+ */
+auto push_field_cache(lua_State* const L, int const obj) -> void
+{
+    if (LUA_TTABLE != lua_getiuservalue(L, obj, 1))
+    {
+        lua_pop(L, 1);
+        lua_createtable(L, 0, 2);
+        lua_pushvalue(L, -1);
+        lua_setiuservalue(L, obj, 1);
+    }
+}
+
+auto l_totable(lua_State* const L) -> int
+{
+    auto const obj = check_udata<LazyIrcMsg>(L, 1);
+    lua_settop(L, 1);
+    pushircmsg(L, obj->msg);
+
+    // Preserve fields assigned from Lua and any materialized tags table
+    if (LUA_TTABLE == lua_getiuservalue(L, 1, 1))
+    {
+        lua_pushnil(L);
+        while (lua_next(L, 3))
+        {
+            lua_pushvalue(L, -2);
+            lua_insert(L, -2);
+            lua_rawset(L, 2);
+        }
+    }
+    lua_pop(L, 1);
+    return 1;
+}
+
+auto l_index(lua_State* const L) -> int
+{
+    auto const obj = check_udata<LazyIrcMsg>(L, 1);
+    auto const& msg = obj->msg;
+    lua_settop(L, 2);
+    push_field_cache(L, 1); // 3
+
+    lua_pushvalue(L, 2);
+    if (LUA_TNIL != lua_rawget(L, 3))
+    {
+        return 1;
+    }
+    lua_pop(L, 1);
+
+    if (lua_isinteger(L, 2))
+    {
+        auto const i = lua_tointeger(L, 2);
+        if (1 <= i && i <= static_cast<lua_Integer>(msg.args.size()))
+        {
+            push_string(L, msg.args[i - 1]);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (LUA_TSTRING != lua_type(L, 2))
+    {
+        return 0;
+    }
+    else if (auto const key = lua_tostring(L, 2); key == "command"sv)
+    {
+        push_command(L, msg.command);
+    }
+    else if (key == "source"sv)
+    {
+        if (msg.source.empty())
+        {
+            return 0;
+        }
+        push_string(L, msg.source);
+    }
+    else if (key == "tags"sv)
+    {
+        pushtags(L, msg.tags);
+    }
+    else if (key == "totable"sv)
+    {
+        lua_pushcfunction(L, l_totable);
+        return 1;
+    }
+    else
+    {
+        return 0;
+    }
+
+    // remember the materialized value for the next access
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, 3);
+    return 1;
+}
+
+auto l_newindex(lua_State* const L) -> int
+{
+    check_udata<LazyIrcMsg>(L, 1);
+    lua_settop(L, 3);
+    push_field_cache(L, 1);
+    lua_insert(L, 2);
+    lua_rawset(L, 2);
+    return 0;
+}
+
+auto l_len(lua_State* const L) -> int
+{
+    auto const obj = check_udata<LazyIrcMsg>(L, 1);
+    lua_pushinteger(L, obj->msg.args.size());
+    return 1;
+}
+
+auto l_gc(lua_State* const L) -> int
+{
+    auto const obj = check_udata<LazyIrcMsg>(L, 1);
+    std::destroy_at(obj);
+    return 0;
+}
+
+} // namespace
+
+auto push_lazy_ircmsg(lua_State* const L, std::string_view const line) -> void
+{
+    auto const obj = new_udata<LazyIrcMsg>(L, 1, [L]() {
+        luaL_Reg const MT[]{
+            {"__index", l_index},
+            {"__newindex", l_newindex},
+            {"__len", l_len},
+            {"__gc", l_gc},
+            {},
+        };
+        luaL_setfuncs(L, MT, 0);
+    });
+    std::construct_at(obj, std::string{line});
+
+    try
+    {
+        parse_irc_message(obj->line.data(), obj->msg);
+    }
+    catch (...)
+    {
+        lua_pop(L, 1);
+        throw;
+    }
+}
@@ -1,25 +1,55 @@
 #include "linebuffer.hpp"
 
-auto LineBuffer::next_line() -> char*
+#include <cstring>
+
+auto LineBuffer::relocate() -> void
+{
+    auto const first = std::begin(buffer);
+    std::move(first + start_, first + end_, first);
+    search_ -= start_;
+    end_ -= start_;
+    start_ = 0;
+}
+
+auto LineBuffer::get_buffer() -> boost::asio::mutable_buffer
 {
-    auto const nl = std::find(search_, end_, '\n');
-    if (nl == end_) // no newline found, line incomplete
+    if (start_ == end_) // nothing buffered, start over for free
     {
-        auto const first = std::begin(buffer);
-        if (start_ != first) // relocate incomplete line to front of buffer
+        start_ = search_ = end_ = 0;
+        if (buffer.size() != initial_size_) // release burst growth
         {
-            end_ = std::move(start_, end_, first);
-            start_ = first;
+            buffer.resize(initial_size_);
+            buffer.shrink_to_fit();
         }
+    }
+    else if (start_ != 0 && buffer.size() - end_ < max_line_length)
+    {
+        relocate();
+    }
+
+    if (end_ == buffer.size() && buffer.size() < limit_)
+    {
+        buffer.resize(std::min(2 * buffer.size(), limit_));
+    }
+
+    return boost::asio::buffer(buffer.data() + end_, buffer.size() - end_);
+}
+
+auto LineBuffer::next_line() -> char*
+{
+    auto const base = buffer.data();
+    auto const nl = static_cast<char*>(std::memchr(base + search_, '\n', end_ - search_));
+    if (nullptr == nl) // no newline found, line incomplete
+    {
         search_ = end_;
         return nullptr;
     }
 
     // Null-terminate the line. Support both \n and \r\n
-    *(start_ < nl && *std::prev(nl) == '\r' ? std::prev(nl) : nl) = '\0';
+    auto const line = base + start_;
+    *(line < nl && nl[-1] == '\r' ? nl - 1 : nl) = '\0';
 
-    auto const result = start_;
-    start_ = search_ = std::next(nl);
+    start_ = search_ = nl - base + 1;
 
-    return &*result;
+    return line;
 }
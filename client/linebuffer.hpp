@@ -14,37 +14,56 @@
 
 #include <algorithm>
 #include <concepts>
+#include <string_view>
 #include <vector>
 
 /**
- * @brief Fixed-size buffer with line-oriented dispatch
+ * @brief Growable buffer with line-oriented dispatch
  *
  */
 class LineBuffer
 {
     std::vector<char> buffer;
 
-    // [std::begin(buffer), end_) contains buffered data
-    // [end_, std::end(buffer)) is available buffer space
-    std::vector<char>::iterator start_;
-    std::vector<char>::iterator search_;
-    std::vector<char>::iterator end_;
+    // Size the buffer is allocated at and returns to once drained
+    std::size_t initial_size_;
+
+    // Size the buffer is allowed to grow to while holding a partial line
+    std::size_t limit_;
+
+    // [0, start_) contains already-dispatched lines
+    // [start_, end_) contains buffered data
+    // [search_, end_) has not been searched for a newline yet
+    // [end_, buffer.size()) is available buffer space
+    std::size_t start_;
+    std::size_t search_;
+    std::size_t end_;
 
 public:
+    /**
+     * @brief Longest IRC line including the tags section
+     *
+     * Partial lines are only relocated to the front of the buffer
+     * once less than this much space remains after them.
+     */
+    static std::size_t constexpr max_line_length = 8'704;
+
     /**
      * @brief Construct a new Line Buffer object
      *
      * @param n Buffer size
+     * @param limit Largest size the buffer can grow to (no growth when less than n)
      */
-    LineBuffer(std::size_t n)
+    LineBuffer(std::size_t n, std::size_t limit = 0)
         : buffer(n)
-        , start_{buffer.begin()}
-        , search_{buffer.begin()}
-        , end_{buffer.begin()}
+        , initial_size_{n}
+        , limit_{std::max(n, limit)}
+        , start_{0}
+        , search_{0}
+        , end_{0}
     {
     }
 
-    // can't copy the iterator member safely
     LineBuffer(LineBuffer const&) = delete;
     LineBuffer(LineBuffer&&) = delete;
     auto operator=(LineBuffer const&) -> LineBuffer& = delete;
@@ -53,12 +72,17 @@ public:
     /**
      * @brief Get the available buffer space
      *
+     * This is where the buffer is compacted. The partial line is only
+     * relocated to the front of the buffer when there isn't room for
+     * a full line after it. A full buffer grows up to its limit. An
+     * empty buffer is only returned when a single line fills the
+     * buffer and it can't grow.
+     *
+     * Lines returned by next_line are invalidated by this call.
+     *
      * @return boost::asio::mutable_buffer
      */
-    auto get_buffer() -> boost::asio::mutable_buffer
-    {
-        return boost::asio::buffer(&*end_, std::distance(end_, buffer.end()));
-    }
+    auto get_buffer() -> boost::asio::mutable_buffer;
 
     /**
      * @brief Commit new buffer bytes and dispatch line callback
@@ -74,17 +98,37 @@ public:
      */
     auto add_bytes(std::size_t const n) -> void
     {
-        std::advance(end_, n);
+        end_ += n;
     }
 
     /**
      * @brief Return the next null-terminated line in the buffer
      *
      * This function should be repeatedly called until it returns
-     * nullptr at which point it will clean up the buffer relocating
-     * the partial line to the front of the buffer.
+     * nullptr. It never moves buffered bytes, so every line returned
+     * stays valid until the next call to get_buffer.
      *
      * @return null-terminated line or nullptr if no line is ready
      */
     auto next_line() -> char*;
+
+    /**
+     * @brief Remove and return the buffered partial line
+     *
+     * For passing on a line too long for the buffer or the end of a
+     * stream that has no final newline. Call after next_line returns
+     * nullptr. The result stays valid until the next call to get_buffer.
+     *
+     * @return bytes after the last complete line
+     */
+    auto take_partial() -> std::string_view
+    {
+        std::string_view const result{buffer.data() + start_, end_ - start_};
+        start_ = search_ = end_;
+        return result;
+    }
+
+private:
+    // Move the partial line to the front of the buffer
+    auto relocate() -> void;
 };
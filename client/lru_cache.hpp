@@ -0,0 +1,169 @@
+#pragma once
+/**
+ * @file lru_cache.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Bounded map that evicts the least recently used entry
+ *
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @brief Bounded key-value cache with least-recently-used eviction
+ *
+ * Entries are kept in a list ordered from most to least recently used
+ * and indexed by a hash table of list positions. Lookups that find an
+ * entry move it to the front. The cache counts its own hits, misses,
+ * and evictions.
+ *
+ * @tparam Key Key type
+ * @tparam Value Cached value type
+ * @tparam Hash Hash function for keys
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache
+{
+    using Entries = std::list<std::pair<Key, Value>>;
+
+    Entries entries_;
+    std::unordered_map<Key, typename Entries::iterator, Hash> index_;
+    std::size_t capacity_;
+
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+    std::uint64_t evictions_ = 0;
+
+    auto trim(std::size_t const limit) -> void
+    {
+        while (entries_.size() > limit)
+        {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+            evictions_++;
+        }
+    }
+
+public:
+    /**
+     * @param capacity Maximum number of entries, at least 1
+     */
+    explicit LruCache(std::size_t const capacity)
+        : capacity_{std::max<std::size_t>(1, capacity)}
+    {
+    }
+
+    /**
+     * @brief Find an entry and mark it most recently used
+     *
+     * @return Pointer to the cached value or nullptr on a miss
+     */
+    auto find(Key const& key) -> Value*
+    {
+        auto const it = index_.find(key);
+        if (it == index_.end())
+        {
+            misses_++;
+            return nullptr;
+        }
+        hits_++;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+
+    /**
+     * @brief Add or replace an entry as the most recently used
+     *
+     * The least recently used entry is evicted when the cache is full.
+     *
+     * @return Reference to the stored value
+     */
+    auto insert(Key key, Value value) -> Value&
+    {
+        if (auto const it = index_.find(key); it != index_.end())
+        {
+            it->second->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->second;
+        }
+
+        trim(capacity_ - 1);
+        entries_.emplace_front(key, std::move(value));
+        index_.emplace(std::move(key), entries_.begin());
+        return entries_.front().second;
+    }
+
+    /**
+     * @brief Remove an entry
+     * @return true when the key was present
+     */
+    auto erase(Key const& key) -> bool
+    {
+        auto const it = index_.find(key);
+        if (it == index_.end())
+        {
+            return false;
+        }
+        entries_.erase(it->second);
+        index_.erase(it);
+        return true;
+    }
+
+    auto clear() -> void
+    {
+        entries_.clear();
+        index_.clear();
+    }
+
+    /**
+     * @brief Change the maximum size, evicting entries as needed
+     */
+    auto set_capacity(std::size_t const capacity) -> void
+    {
+        capacity_ = std::max<std::size_t>(1, capacity);
+        trim(capacity_);
+    }
+
+    /**
+     * @brief Iterate over key-value pairs from most to least recently used
+     */
+    auto begin() const
+    {
+        return entries_.cbegin();
+    }
+
+    auto end() const
+    {
+        return entries_.cend();
+    }
+
+    auto size() const -> std::size_t
+    {
+        return entries_.size();
+    }
+
+    auto capacity() const -> std::size_t
+    {
+        return capacity_;
+    }
+
+    auto hits() const -> std::uint64_t
+    {
+        return hits_;
+    }
+
+    auto misses() const -> std::uint64_t
+    {
+        return misses_;
+    }
+
+    auto evictions() const -> std::uint64_t
+    {
+        return evictions_;
+    }
+};
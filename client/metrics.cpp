@@ -0,0 +1,222 @@
+#include "metrics.hpp"
+
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace metrics {
+
+namespace {
+
+using Key = std::pair<std::string, std::string>; // name, labels
+
+struct Family
+{
+    std::string help;
+    std::string_view type;
+};
+
+struct Registry
+{
+    std::map<std::string, Family, std::less<>> families;
+    std::map<Key, Counter> counters;
+    std::map<Key, Gauge> gauges;
+    std::map<Key, Histogram> histograms;
+};
+
+auto registry() -> Registry&
+{
+    static Registry r;
+    return r;
+}
+
+template <typename T>
+auto lookup(
+    std::map<Key, T>& series,
+    std::string_view const type,
+    std::string_view const name,
+    std::string_view const help,
+    std::string_view const labels
+) -> T&
+{
+    auto& families = registry().families;
+    auto family = families.find(name);
+    if (family == families.end())
+    {
+        families.emplace(name, Family{std::string{help}, type});
+    }
+    else if (family->second.type != type)
+    {
+        throw std::logic_error{"metric registered with two types: " + std::string{name}};
+    }
+
+    return series[Key{name, labels}];
+}
+
+// Write name{labels,extra} followed by a space
+auto write_series(std::ostream& out, std::string_view const name, std::string_view const suffix, std::string_view const labels, std::string_view const extra = {}) -> void
+{
+    out << name << suffix;
+    if (not labels.empty() || not extra.empty())
+    {
+        out << '{' << labels;
+        if (not labels.empty() && not extra.empty())
+        {
+            out << ',';
+        }
+        out << extra << '}';
+    }
+    out << ' ';
+}
+
+auto seconds(clock::duration const d) -> double
+{
+    return std::chrono::duration<double>{d}.count();
+}
+
+// Range of the series of one metric family
+template <typename T>
+auto series_of(std::map<Key, T> const& series, std::string const& name)
+{
+    auto const first = series.lower_bound(Key{name, {}});
+    auto last = first;
+    while (last != series.end() && last->first.first == name)
+    {
+        ++last;
+    }
+    return std::make_pair(first, last);
+}
+
+} // namespace
+
+auto Histogram::observe(clock::duration const d) -> void
+{
+    std::size_t i = 0;
+    while (i < bounds.size() && bounds[i] < d)
+    {
+        i++;
+    }
+    buckets_[i]++;
+    sum_ += d;
+    count_++;
+}
+
+auto counter(std::string_view const name, std::string_view const help, std::string_view const labels) -> Counter&
+{
+    return lookup(registry().counters, "counter", name, help, labels);
+}
+
+auto gauge(std::string_view const name, std::string_view const help, std::string_view const labels) -> Gauge&
+{
+    return lookup(registry().gauges, "gauge", name, help, labels);
+}
+
+auto histogram(std::string_view const name, std::string_view const help, std::string_view const labels) -> Histogram&
+{
+    return lookup(registry().histograms, "histogram", name, help, labels);
+}
+
+auto label(std::string_view const key, std::string_view const value) -> std::string
+{
+    std::string result{key};
+    result += "=\"";
+    for (auto const c : value)
+    {
+        switch (c)
+        {
+        case '\\':
+            result += "\\\\";
+            break;
+        case '"':
+            result += "\\\"";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        default:
+            result += c;
+        }
+    }
+    result += '"';
+    return result;
+}
+
+auto for_each_series(std::function<void(std::string_view, std::string_view, Series)> const& f) -> void
+{
+    auto const& r = registry();
+    for (auto const& [name, family] : r.families)
+    {
+        auto const visit = [&](auto const& series) {
+            auto const [first, last] = series_of(series, name);
+            for (auto it = first; it != last; ++it)
+            {
+                f(name, it->first.second, &it->second);
+            }
+        };
+
+        if ("counter" == family.type)
+        {
+            visit(r.counters);
+        }
+        else if ("gauge" == family.type)
+        {
+            visit(r.gauges);
+        }
+        else
+        {
+            visit(r.histograms);
+        }
+    }
+}
+
+auto render_prometheus() -> std::string
+{
+    auto const& families = registry().families;
+    std::ostringstream out;
+    std::string_view current;
+
+    for_each_series([&](std::string_view const name, std::string_view const labels, Series const series) {
+        if (current != name)
+        {
+            current = name;
+            auto const& family = families.find(name)->second;
+            out << "# HELP " << name << ' ' << family.help << '\n';
+            out << "# TYPE " << name << ' ' << family.type << '\n';
+        }
+
+        if (auto const c = std::get_if<Counter const*>(&series))
+        {
+            write_series(out, name, "", labels);
+            out << (*c)->value() << '\n';
+        }
+        else if (auto const g = std::get_if<Gauge const*>(&series))
+        {
+            write_series(out, name, "", labels);
+            out << (*g)->value() << '\n';
+        }
+        else
+        {
+            auto const& h = *std::get<Histogram const*>(series);
+            std::uint64_t cumulative = 0;
+            for (std::size_t i = 0; i < Histogram::bounds.size(); i++)
+            {
+                cumulative += h.bucket(i);
+                std::ostringstream le;
+                le << "le=\"" << seconds(Histogram::bounds[i]) << '"';
+                write_series(out, name, "_bucket", labels, le.str());
+                out << cumulative << '\n';
+            }
+            write_series(out, name, "_bucket", labels, "le=\"+Inf\"");
+            out << h.count() << '\n';
+            write_series(out, name, "_sum", labels);
+            out << seconds(h.sum()) << '\n';
+            write_series(out, name, "_count", labels);
+            out << h.count() << '\n';
+        }
+    });
+
+    return out.str();
+}
+
+} // namespace metrics
@@ -0,0 +1,230 @@
+#pragma once
+/**
+ * @file metrics.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Process-wide counters, gauges, and latency histograms
+ *
+ * Metrics are registered once by name and updated through a stable
+ * reference, so the hot path is a plain integer update. The client
+ * runs a single-threaded event loop, so no synchronization is used.
+ *
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+struct lua_State;
+
+namespace metrics {
+
+using clock = std::chrono::steady_clock;
+
+/**
+ * @brief Monotonically increasing count
+ */
+class Counter
+{
+    std::uint64_t value_ = 0;
+
+public:
+    auto add(std::uint64_t const n = 1) -> void
+    {
+        value_ += n;
+    }
+
+    auto value() const -> std::uint64_t
+    {
+        return value_;
+    }
+};
+
+/**
+ * @brief Value that can go up and down
+ */
+class Gauge
+{
+    std::int64_t value_ = 0;
+
+public:
+    auto set(std::int64_t const v) -> void
+    {
+        value_ = v;
+    }
+
+    auto add(std::int64_t const n) -> void
+    {
+        value_ += n;
+    }
+
+    auto value() const -> std::int64_t
+    {
+        return value_;
+    }
+};
+
+/**
+ * @brief Latency distribution over fixed buckets
+ *
+ * Bucket counts are stored individually and made cumulative when read.
+ */
+class Histogram
+{
+public:
+    /// Inclusive upper bounds of the finite buckets
+    static constexpr std::array<clock::duration, 11> bounds{
+        std::chrono::microseconds{10},
+        std::chrono::microseconds{50},
+        std::chrono::microseconds{100},
+        std::chrono::microseconds{500},
+        std::chrono::milliseconds{1},
+        std::chrono::milliseconds{5},
+        std::chrono::milliseconds{10},
+        std::chrono::milliseconds{50},
+        std::chrono::milliseconds{100},
+        std::chrono::milliseconds{500},
+        std::chrono::seconds{1},
+    };
+
+private:
+    // the last bucket counts observations above every bound
+    std::array<std::uint64_t, bounds.size() + 1> buckets_{};
+    clock::duration sum_{};
+    std::uint64_t count_ = 0;
+
+public:
+    auto observe(clock::duration d) -> void;
+
+    /// Number of observations in bucket i, not cumulative
+    auto bucket(std::size_t const i) const -> std::uint64_t
+    {
+        return buckets_[i];
+    }
+
+    auto sum() const -> clock::duration
+    {
+        return sum_;
+    }
+
+    auto count() const -> std::uint64_t
+    {
+        return count_;
+    }
+};
+
+/**
+ * @brief Record the lifetime of this object into a histogram
+ */
+class Stopwatch
+{
+    Histogram& histogram_;
+    clock::time_point start_;
+
+public:
+    explicit Stopwatch(Histogram& histogram)
+        : histogram_{histogram}
+        , start_{clock::now()}
+    {
+    }
+
+    Stopwatch(Stopwatch const&) = delete;
+    Stopwatch(Stopwatch&&) = delete;
+    auto operator=(Stopwatch const&) -> Stopwatch& = delete;
+    auto operator=(Stopwatch&&) -> Stopwatch& = delete;
+
+    ~Stopwatch()
+    {
+        histogram_.observe(clock::now() - start_);
+    }
+};
+
+/**
+ * @brief Find or register a counter
+ *
+ * Repeated calls with the same name and labels return the same object.
+ * References stay valid for the life of the process.
+ *
+ * @param name Metric family name
+ * @param help Description used the first time the family is registered
+ * @param labels Prometheus label list without braces, e.g. key="value"
+ * @return Counter reference
+ */
+auto counter(std::string_view name, std::string_view help, std::string_view labels = {}) -> Counter&;
+
+/**
+ * @brief Find or register a gauge
+ * @see counter
+ */
+auto gauge(std::string_view name, std::string_view help, std::string_view labels = {}) -> Gauge&;
+
+/**
+ * @brief Find or register a histogram
+ * @see counter
+ */
+auto histogram(std::string_view name, std::string_view help, std::string_view labels = {}) -> Histogram&;
+
+/**
+ * @brief Build a single Prometheus label escaping the value
+ *
+ * @param key Label name
+ * @param value Label value
+ * @return key="value"
+ */
+auto label(std::string_view key, std::string_view value) -> std::string;
+
+using Series = std::variant<Counter const*, Gauge const*, Histogram const*>;
+
+/**
+ * @brief Visit every registered series ordered by name and labels
+ *
+ * @param f Called with the metric name, labels, and metric
+ */
+auto for_each_series(std::function<void(std::string_view, std::string_view, Series)> const& f) -> void;
+
+/**
+ * @brief Render every registered metric in the Prometheus text format
+ */
+auto render_prometheus() -> std::string;
+
+} // namespace metrics
+
+/**
+ * @brief Snapshot all metrics into a table
+ *
+ * Keys are metric names with labels in braces when present. Counters
+ * and gauges map to integers. Histograms map to tables with fields
+ * count, sum (seconds), and buckets, an array of {le, count} pairs
+ * with cumulative counts.
+ *
+ * @param L Lua state
+ * @return 1
+ */
+auto l_metrics(lua_State* L) -> int;
+
+/**
+ * @brief Call a function and record its duration
+ *
+ * Arguments: section name, function, function arguments...
+ * Results of the function are returned. The duration is recorded in
+ * snowcone_lua_section_seconds labeled by the section name.
+ *
+ * @param L Lua state
+ * @return number of function results
+ */
+auto l_measure(lua_State* L) -> int;
+
+/**
+ * @brief Serve the Prometheus text dump on a Unix socket
+ *
+ * Arguments: socket path. A stale socket at that path is replaced.
+ * Each accepted connection receives a dump and is closed. The server
+ * runs until the returned object is closed or collected.
+ *
+ * @param L Lua state
+ * @return server object or fail and an error message
+ */
+auto l_serve_metrics(lua_State* L) -> int;
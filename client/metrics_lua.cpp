@@ -0,0 +1,197 @@
+#include "metrics.hpp"
+
+#include "app.hpp"
+#include "strings.hpp"
+#include "userdata.hpp"
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+#include <boost/asio.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+using Acceptor = boost::asio::local::stream_protocol::acceptor;
+
+struct MetricsServer
+{
+    std::shared_ptr<Acceptor> acceptor;
+};
+
+template <>
+char const* udata_name<MetricsServer> = "metrics_server";
+
+namespace {
+
+auto push_histogram(lua_State* const L, metrics::Histogram const& h) -> void
+{
+    lua_createtable(L, 0, 3);
+
+    lua_pushinteger(L, h.count());
+    lua_setfield(L, -2, "count");
+
+    lua_pushnumber(L, std::chrono::duration<double>{h.sum()}.count());
+    lua_setfield(L, -2, "sum");
+
+    lua_createtable(L, metrics::Histogram::bounds.size() + 1, 0);
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i <= metrics::Histogram::bounds.size(); i++)
+    {
+        cumulative += h.bucket(i);
+        lua_createtable(L, 2, 0);
+        lua_pushnumber(L,
+            i < metrics::Histogram::bounds.size()
+                ? std::chrono::duration<double>{metrics::Histogram::bounds[i]}.count()
+                : HUGE_VAL);
+        lua_rawseti(L, -2, 1);
+        lua_pushinteger(L, cumulative);
+        lua_rawseti(L, -2, 2);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "buckets");
+}
+
+auto serve_connection(boost::asio::local::stream_protocol::socket socket) -> boost::asio::awaitable<void>
+{
+    auto const text = metrics::render_prometheus();
+    co_await boost::asio::async_write(socket, boost::asio::buffer(text), boost::asio::use_awaitable);
+}
+
+auto serve(std::shared_ptr<Acceptor> const acceptor) -> boost::asio::awaitable<void>
+{
+    for (;;)
+    {
+        auto socket = co_await acceptor->async_accept(boost::asio::use_awaitable);
+        boost::asio::co_spawn(acceptor->get_executor(), serve_connection(std::move(socket)), boost::asio::detached);
+    }
+}
+
+auto l_close(lua_State* const L) -> int
+{
+    auto const server = check_udata<MetricsServer>(L, 1);
+    boost::system::error_code error;
+    server->acceptor->close(error);
+    return 0;
+}
+
+auto l_gc(lua_State* const L) -> int
+{
+    auto const server = check_udata<MetricsServer>(L, 1);
+    boost::system::error_code error;
+    server->acceptor->close(error);
+    std::destroy_at(server);
+    return 0;
+}
+
+luaL_Reg const MT[]{
+    {"__gc", l_gc},
+    {}
+};
+
+luaL_Reg const Methods[]{
+    {"close", l_close},
+    {}
+};
+
+} // namespace
+
+auto l_metrics(lua_State* const L) -> int
+{
+    lua_newtable(L);
+    metrics::for_each_series([L](std::string_view const name, std::string_view const labels, metrics::Series const series) {
+        if (labels.empty())
+        {
+            push_string(L, name);
+        }
+        else
+        {
+            push_string(L, std::string{name} + '{' + std::string{labels} + '}');
+        }
+
+        if (auto const c = std::get_if<metrics::Counter const*>(&series))
+        {
+            lua_pushinteger(L, (*c)->value());
+        }
+        else if (auto const g = std::get_if<metrics::Gauge const*>(&series))
+        {
+            lua_pushinteger(L, (*g)->value());
+        }
+        else
+        {
+            push_histogram(L, *std::get<metrics::Histogram const*>(series));
+        }
+
+        lua_rawset(L, -3);
+    });
+    return 1;
+}
+
+auto l_measure(lua_State* const L) -> int
+{
+    auto const section = check_string_view(L, 1);
+    luaL_checkany(L, 2);
+
+    // no objects with destructors may be live across lua_call
+    auto& histogram = metrics::histogram(
+        "snowcone_lua_section_seconds",
+        "Time spent in measured sections of Lua code",
+        metrics::label("section", section)
+    );
+
+    auto const start = metrics::clock::now();
+    lua_call(L, lua_gettop(L) - 2, LUA_MULTRET);
+    histogram.observe(metrics::clock::now() - start);
+
+    return lua_gettop(L) - 1;
+}
+
+auto l_serve_metrics(lua_State* const L) -> int
+{
+    auto const path = luaL_checkstring(L, 1);
+
+    // Replace a socket left behind by a previous run, but nothing else
+    struct stat st;
+    if (0 == lstat(path, &st) && S_ISSOCK(st.st_mode))
+    {
+        unlink(path);
+    }
+
+    auto const app = App::from_lua(L);
+    auto acceptor = std::make_shared<Acceptor>(app->get_executor());
+
+    boost::system::error_code error;
+    boost::asio::local::stream_protocol::endpoint const endpoint{path};
+    acceptor->open(endpoint.protocol(), error);
+    if (not error)
+    {
+        acceptor->bind(endpoint, error);
+    }
+    if (not error)
+    {
+        acceptor->listen(boost::asio::socket_base::max_listen_connections, error);
+    }
+    if (error)
+    {
+        luaL_pushfail(L);
+        push_string(L, error.message());
+        return 2;
+    }
+
+    boost::asio::co_spawn(app->get_executor(), serve(acceptor), boost::asio::detached);
+
+    auto const server = new_udata<MetricsServer>(L, 0, [L]() {
+        luaL_setfuncs(L, MT, 0);
+        luaL_newlibtable(L, Methods);
+        luaL_setfuncs(L, Methods, 0);
+        lua_setfield(L, -2, "__index");
+    });
+    std::construct_at(server, std::move(acceptor));
+    return 1;
+}
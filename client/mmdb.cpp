@@ -0,0 +1,530 @@
+#include "mmdb.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace std::literals::string_view_literals;
+
+// The metadata map follows the last occurrence of this marker
+auto constexpr metadata_marker = "\xAB\xCD\xEFMaxMind.com"sv;
+// and the marker is always within this many bytes of the end
+std::size_t constexpr metadata_window = 128 * 1024;
+// Zero bytes between the search tree and the data section
+std::size_t constexpr data_separator = 16;
+// Deepest nesting of maps and arrays accepted while skipping values
+int constexpr max_depth = 32;
+
+enum class Type
+{
+    extended,
+    pointer,
+    utf8,
+    double_,
+    bytes,
+    uint16,
+    uint32,
+    map,
+    int32,
+    uint64,
+    uint128,
+    array,
+    container,
+    end_marker,
+    boolean,
+    float_,
+};
+
+[[noreturn]] auto corrupt(char const* const what) -> void
+{
+    throw std::runtime_error{std::string{"mmdb: "} + what};
+}
+
+/**
+ * @brief Reader for the MaxMind DB data encoding
+ *
+ * Offsets are relative to the start of the section being decoded, which
+ * is also where pointers are relative to.
+ */
+class Decoder
+{
+    unsigned char const* section_;
+    std::size_t size_;
+
+    auto need(std::size_t const pos, std::size_t const n) const -> void
+    {
+        if (pos > size_ || n > size_ - pos)
+        {
+            corrupt("value runs past the end of the section");
+        }
+    }
+
+    auto big_endian(std::size_t const pos, std::size_t const n) const -> std::uint64_t
+    {
+        need(pos, n);
+        std::uint64_t result = 0;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            result = result << 8 | section_[pos + i];
+        }
+        return result;
+    }
+
+public:
+    struct Field
+    {
+        Type type;
+        // Payload bytes, entries of a map or array, or value of a boolean
+        std::size_t size;
+        // Start of the payload, or the target of a pointer
+        std::size_t offset;
+    };
+
+    Decoder(unsigned char const* const section, std::size_t const size)
+        : section_{section}
+        , size_{size}
+    {
+    }
+
+    /**
+     * @brief Decode the control bytes of the value at pos
+     *
+     * Leaves pos at the start of the payload, or after the pointer.
+     */
+    auto header(std::size_t& pos) const -> Field
+    {
+        need(pos, 1);
+        auto const control = section_[pos++];
+        auto type = static_cast<Type>(control >> 5);
+
+        if (Type::pointer == type)
+        {
+            auto const n = ((control >> 3) & 3) + 1;
+            auto const high = std::uint64_t{control & 7u};
+            auto const low = big_endian(pos, n);
+            pos += n;
+
+            std::uint64_t target;
+            switch (n)
+            {
+            case 1:
+                target = high << 8 | low;
+                break;
+            case 2:
+                target = (high << 16 | low) + 2048;
+                break;
+            case 3:
+                target = (high << 24 | low) + 526'336;
+                break;
+            default:
+                target = low;
+                break;
+            }
+            return {Type::pointer, 0, static_cast<std::size_t>(target)};
+        }
+
+        if (Type::extended == type)
+        {
+            need(pos, 1);
+            auto const extended = 7 + section_[pos++];
+            if (extended > static_cast<int>(Type::float_))
+            {
+                corrupt("unknown data type");
+            }
+            type = static_cast<Type>(extended);
+        }
+
+        std::size_t size = control & 0x1f;
+        if (size >= 29)
+        {
+            auto const n = size - 28;
+            auto const extra = big_endian(pos, n);
+            pos += n;
+            size = (29 == size ? 29 : 30 == size ? 285 : 65'821) + extra;
+        }
+        return {type, size, pos};
+    }
+
+    /**
+     * @brief Move pos past the value at pos
+     */
+    auto skip(std::size_t& pos, int const depth = 0) const -> void
+    {
+        if (depth > max_depth)
+        {
+            corrupt("values nested too deeply");
+        }
+
+        auto const field = header(pos);
+        switch (field.type)
+        {
+        case Type::pointer:
+        case Type::boolean:
+        case Type::end_marker:
+            break;
+        case Type::map:
+            for (std::size_t i = 0; i < 2 * field.size; i++)
+            {
+                skip(pos, depth + 1);
+            }
+            break;
+        case Type::array:
+            for (std::size_t i = 0; i < field.size; i++)
+            {
+                skip(pos, depth + 1);
+            }
+            break;
+        default:
+            need(pos, field.size);
+            pos += field.size;
+            break;
+        }
+    }
+
+    /**
+     * @brief Decode the value at pos, following a pointer
+     *
+     * Leaves pos after the value.
+     */
+    auto value(std::size_t& pos) const -> Field
+    {
+        auto const start = pos;
+        auto const field = header(pos);
+        if (Type::pointer == field.type)
+        {
+            auto target = field.offset;
+            auto const result = header(target);
+            if (Type::pointer == result.type)
+            {
+                corrupt("pointer to a pointer");
+            }
+            return result;
+        }
+
+        pos = start;
+        skip(pos);
+        return field;
+    }
+
+    auto string(Field const& field) const -> std::string_view
+    {
+        if (Type::utf8 != field.type)
+        {
+            corrupt("string expected");
+        }
+        need(field.offset, field.size);
+        return {reinterpret_cast<char const*>(section_ + field.offset), field.size};
+    }
+
+    auto unsigned_integer(Field const& field) const -> std::uint64_t
+    {
+        if (Type::uint16 != field.type && Type::uint32 != field.type && Type::uint64 != field.type)
+        {
+            corrupt("unsigned integer expected");
+        }
+        if (field.size > 8)
+        {
+            corrupt("integer too wide");
+        }
+        return big_endian(field.offset, field.size);
+    }
+};
+
+} // namespace
+
+Mmdb::Mmdb(char const* const path)
+{
+    auto const fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::system_error{errno, std::generic_category(), path};
+    }
+
+    struct stat st;
+    if (0 != fstat(fd, &st))
+    {
+        auto const e = errno;
+        ::close(fd);
+        throw std::system_error{e, std::generic_category(), path};
+    }
+
+    size_ = st.st_size;
+    if (0 == size_)
+    {
+        ::close(fd);
+        corrupt("empty file");
+    }
+
+    auto const map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    auto const e = errno;
+    ::close(fd);
+    if (MAP_FAILED == map)
+    {
+        throw std::system_error{e, std::generic_category(), path};
+    }
+    data_ = static_cast<unsigned char const*>(map);
+
+    try
+    {
+        std::string_view const file{reinterpret_cast<char const*>(data_), size_};
+        auto const window = size_ - std::min(size_, metadata_window);
+        auto const found = file.substr(window).rfind(metadata_marker);
+        if (std::string_view::npos == found)
+        {
+            corrupt("metadata not found");
+        }
+        auto const marker = window + found;
+
+        auto const metadata_start = marker + metadata_marker.size();
+        Decoder const metadata{data_ + metadata_start, size_ - metadata_start};
+
+        std::size_t pos = 0;
+        auto const map_field = metadata.value(pos);
+        if (Type::map != map_field.type)
+        {
+            corrupt("metadata is not a map");
+        }
+
+        std::uint64_t node_count = 0;
+        std::uint64_t record_size = 0;
+        std::uint64_t ip_version = 0;
+        pos = map_field.offset;
+        for (std::size_t i = 0; i < map_field.size; i++)
+        {
+            auto const key = metadata.string(metadata.value(pos));
+            auto const val = metadata.value(pos);
+            if ("node_count" == key)
+            {
+                node_count = metadata.unsigned_integer(val);
+            }
+            else if ("record_size" == key)
+            {
+                record_size = metadata.unsigned_integer(val);
+            }
+            else if ("ip_version" == key)
+            {
+                ip_version = metadata.unsigned_integer(val);
+            }
+        }
+
+        if (24 != record_size && 28 != record_size && 32 != record_size)
+        {
+            corrupt("unsupported record size");
+        }
+        if (4 != ip_version && 6 != ip_version)
+        {
+            corrupt("unsupported ip version");
+        }
+        if (0 == node_count || node_count > (std::uint64_t{1} << record_size) - data_separator)
+        {
+            corrupt("bad node count");
+        }
+
+        node_count_ = node_count;
+        record_size_ = record_size;
+        ip_version_ = ip_version;
+        if (search_tree_size() + data_separator > marker)
+        {
+            corrupt("search tree runs past the metadata");
+        }
+
+        ipv4_start_ = 0;
+        ipv4_start_depth_ = 0;
+        if (6 == ip_version_)
+        {
+            while (ipv4_start_depth_ < 96 && ipv4_start_ < node_count_)
+            {
+                ipv4_start_ = record(ipv4_start_, false);
+                ipv4_start_depth_++;
+            }
+        }
+    }
+    catch (...)
+    {
+        munmap(const_cast<unsigned char*>(data_), size_);
+        throw;
+    }
+}
+
+Mmdb::~Mmdb()
+{
+    munmap(const_cast<unsigned char*>(data_), size_);
+}
+
+auto Mmdb::search_tree_size() const -> std::size_t
+{
+    return std::size_t{node_count_} * record_size_ / 4;
+}
+
+auto Mmdb::record(std::uint32_t const node, bool const right) const -> std::uint32_t
+{
+    auto const p = data_ + std::size_t{node} * record_size_ / 4;
+    auto const be24 = [](unsigned char const* const q) -> std::uint32_t {
+        return std::uint32_t{q[0]} << 16 | std::uint32_t{q[1]} << 8 | q[2];
+    };
+
+    switch (record_size_)
+    {
+    case 24:
+        return be24(p + (right ? 3 : 0));
+    case 28:
+        // The middle byte holds the high nibble of each record
+        return right ? (std::uint32_t{p[3] & 0x0fu} << 24 | be24(p + 4))
+                     : (std::uint32_t{p[3] & 0xf0u} << 20 | be24(p));
+    default:
+        return std::uint32_t{p[right ? 4 : 0]} << 24 | be24(p + (right ? 5 : 1));
+    }
+}
+
+auto Mmdb::lookup(std::string_view const address) const -> Result
+{
+    auto const bits = 8 * address.size();
+    std::uint32_t node;
+    if (4 == address.size())
+    {
+        // The IPv4 subtree is the start of the IPv4-mapped range
+        node = ipv4_start_;
+    }
+    else if (16 == address.size() && 6 == ip_version_)
+    {
+        node = 0;
+    }
+    else
+    {
+        return {{}, 0};
+    }
+
+    unsigned depth = 0;
+    for (; depth < bits && node < node_count_; depth++)
+    {
+        auto const byte = static_cast<unsigned char>(address[depth / 8]);
+        node = record(node, byte >> (7 - depth % 8) & 1);
+    }
+
+    if (node <= node_count_)
+    {
+        return {{}, depth};
+    }
+
+    auto const data_start = search_tree_size() + data_separator;
+    Decoder const data{data_ + data_start, size_ - data_start};
+    std::size_t pos = node - node_count_ - data_separator;
+
+    auto const map_field = data.value(pos);
+    if (Type::map != map_field.type)
+    {
+        corrupt("record is not a map");
+    }
+
+    Mmdb::Asn asn{};
+    bool found = false;
+    pos = map_field.offset;
+    for (std::size_t i = 0; i < map_field.size; i++)
+    {
+        auto const key = data.string(data.value(pos));
+        auto const val = data.value(pos);
+        if ("autonomous_system_number" == key)
+        {
+            asn.number = data.unsigned_integer(val);
+            found = true;
+        }
+        else if ("autonomous_system_organization" == key)
+        {
+            asn.organization = data.string(val);
+            found = true;
+        }
+    }
+
+    if (found)
+    {
+        return {std::move(asn), depth};
+    }
+    return {{}, depth};
+}
+
+auto AsnDatabase::identify(std::string const& path) -> FileIdentity
+{
+    struct stat st;
+    if (0 != ::stat(path.c_str(), &st))
+    {
+        throw std::system_error{errno, std::generic_category(), path};
+    }
+    return {st.st_dev, st.st_ino, std::int64_t{st.st_mtim.tv_sec} * 1'000'000'000 + st.st_mtim.tv_nsec};
+}
+
+AsnDatabase::AsnDatabase(std::size_t const capacity)
+    : identity_{}
+    , cache_{capacity}
+{
+}
+
+auto AsnDatabase::replace(std::shared_ptr<Mmdb const> db, FileIdentity const identity) -> void
+{
+    db_ = std::move(db);
+    identity_ = identity;
+    cache_.clear();
+}
+
+auto AsnDatabase::open(std::string path) -> void
+{
+    if (db_ && path == path_)
+    {
+        reload();
+        return;
+    }
+
+    // Everything that can fail happens before anything changes
+    auto const id = identify(path);
+    auto db = std::make_shared<Mmdb const>(path.c_str());
+    path_ = std::move(path);
+    replace(std::move(db), id);
+}
+
+auto AsnDatabase::reload() -> bool
+{
+    if (not db_)
+    {
+        return false;
+    }
+
+    auto const id = identify(path_);
+    if (id == identity_)
+    {
+        return false;
+    }
+
+    replace(std::make_shared<Mmdb const>(path_.c_str()), id);
+    return true;
+}
+
+auto AsnDatabase::lookup(std::string_view const address) -> std::optional<Mmdb::Asn>
+{
+    if (not db_ || (4 != address.size() && 16 != address.size()))
+    {
+        return {};
+    }
+
+    // /24 or /48
+    auto const prefix_bytes = 4 == address.size() ? 3 : 6;
+    std::string key{address.substr(0, prefix_bytes)};
+    if (auto const hit = cache_.find(key))
+    {
+        return *hit;
+    }
+
+    auto result = db_->lookup(address);
+    if (result.prefix_length <= 8u * prefix_bytes)
+    {
+        cache_.insert(std::move(key), result.asn);
+    }
+    return std::move(result.asn);
+}
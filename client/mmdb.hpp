@@ -0,0 +1,159 @@
+#pragma once
+/**
+ * @file mmdb.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Autonomous system lookups in MaxMind DB files
+ *
+ */
+
+#include "lru_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+/**
+ * @brief Read-only memory mapped MaxMind DB file
+ *
+ * Only the search tree and the fields of ASN databases are understood;
+ * lookups walk the tree straight from the packed address bytes and
+ * decode nothing but the autonomous system number and organization.
+ */
+class Mmdb
+{
+public:
+    struct Asn
+    {
+        std::uint32_t number;
+        std::string organization;
+    };
+
+    struct Result
+    {
+        // Empty when the address isn't in the database
+        std::optional<Asn> asn;
+        // Number of leading address bits that share this result
+        unsigned prefix_length;
+    };
+
+private:
+    unsigned char const* data_;
+    std::size_t size_;
+    std::uint32_t node_count_;
+    unsigned record_size_;
+    unsigned ip_version_;
+    // Node reached after the 96 zero bits of an IPv4-mapped address
+    std::uint32_t ipv4_start_;
+    unsigned ipv4_start_depth_;
+
+    auto record(std::uint32_t node, bool right) const -> std::uint32_t;
+    auto search_tree_size() const -> std::size_t;
+
+public:
+    /**
+     * @brief Map a database file and check its metadata
+     *
+     * @throws std::system_error when the file can't be opened or mapped
+     * @throws std::runtime_error when the file isn't a usable database
+     */
+    explicit Mmdb(char const* path);
+    ~Mmdb();
+
+    Mmdb(Mmdb const&) = delete;
+    auto operator=(Mmdb const&) -> Mmdb& = delete;
+
+    /**
+     * @brief Find the record for an address
+     *
+     * @param address 4 or 16 bytes in network order
+     * @throws std::runtime_error on a malformed database
+     */
+    auto lookup(std::string_view address) const -> Result;
+
+    auto ip_version() const -> unsigned
+    {
+        return ip_version_;
+    }
+};
+
+/**
+ * @brief ASN lookups with a cache and reloading
+ *
+ * Answers are cached by /24 for IPv4 and /48 for IPv6 whenever the
+ * database says the whole prefix shares the answer. Reloading maps the
+ * replacement file completely before it's used, so lookups never see a
+ * half-written database and a bad replacement leaves the old one in use.
+ */
+class AsnDatabase
+{
+public:
+    struct Stats
+    {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::size_t entries;
+    };
+
+private:
+    // Tells a replaced file from the one that is mapped
+    struct FileIdentity
+    {
+        dev_t dev;
+        ino_t ino;
+        std::int64_t mtime;
+
+        auto operator==(FileIdentity const&) const -> bool = default;
+    };
+
+    std::string path_;
+    std::shared_ptr<Mmdb const> db_;
+    FileIdentity identity_;
+
+    LruCache<std::string, std::optional<Mmdb::Asn>> cache_;
+
+    static auto identify(std::string const& path) -> FileIdentity;
+    auto replace(std::shared_ptr<Mmdb const> db, FileIdentity identity) -> void;
+
+public:
+    explicit AsnDatabase(std::size_t capacity = 4096);
+
+    /**
+     * @brief Use the database at path
+     *
+     * Opening the file that is already loaded keeps the loaded copy and
+     * its cache.
+     *
+     * @throws std::system_error or std::runtime_error and keeps the current database
+     */
+    auto open(std::string path) -> void;
+
+    /**
+     * @brief Load the file again if it has been replaced
+     *
+     * @return true when a new database is now in use
+     * @throws std::system_error or std::runtime_error and keeps the current database
+     */
+    auto reload() -> bool;
+
+    /**
+     * @brief Find the autonomous system of an address
+     *
+     * @param address 4 or 16 bytes in network order
+     * @return empty when no database is loaded or the address isn't in it
+     */
+    auto lookup(std::string_view address) -> std::optional<Mmdb::Asn>;
+
+    auto is_open() const -> bool
+    {
+        return nullptr != db_;
+    }
+
+    auto stats() const -> Stats
+    {
+        return {cache_.hits(), cache_.misses(), cache_.size()};
+    }
+};
@@ -0,0 +1,244 @@
+#include "dns_resolver.hpp"
+
+#include "../metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+namespace {
+
+auto addrinfo_error(int const code) -> boost::system::error_code
+{
+    switch (code)
+    {
+    case EAI_NONAME:
+#if defined(EAI_NODATA) && EAI_NODATA != EAI_NONAME
+    case EAI_NODATA:
+#endif
+        return boost::asio::error::host_not_found;
+    case EAI_AGAIN:
+        return boost::asio::error::host_not_found_try_again;
+    case EAI_FAMILY:
+        return boost::asio::error::address_family_not_supported;
+    case EAI_MEMORY:
+        return boost::asio::error::no_memory;
+    case EAI_SYSTEM:
+        return {errno, boost::system::system_category()};
+    default:
+        return boost::asio::error::no_recovery;
+    }
+}
+
+// Only answers that the name doesn't exist are worth remembering
+auto cacheable_failure(boost::system::error_code const& error) -> bool
+{
+    return error == boost::asio::error::host_not_found || error == boost::asio::error::no_data;
+}
+
+auto forward(std::string const& name) -> DnsResolver::Result
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM; // one entry per address
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    addrinfo* res = nullptr;
+    if (auto const code = getaddrinfo(name.c_str(), nullptr, &hints, &res))
+    {
+        return {addrinfo_error(code), {}};
+    }
+
+    DnsResolver::Result result;
+    for (auto ai = res; ai; ai = ai->ai_next)
+    {
+        char host[NI_MAXHOST];
+        if (0 == getnameinfo(ai->ai_addr, ai->ai_addrlen, host, sizeof host, nullptr, 0, NI_NUMERICHOST))
+        {
+            if (std::find(result.names.begin(), result.names.end(), host) == result.names.end())
+            {
+                result.names.emplace_back(host);
+            }
+        }
+    }
+    freeaddrinfo(res);
+    return result;
+}
+
+auto reverse(std::string const& name) -> DnsResolver::Result
+{
+    boost::system::error_code error;
+    auto const address = boost::asio::ip::make_address(name, error);
+    if (error)
+    {
+        return {boost::asio::error::invalid_argument, {}};
+    }
+
+    boost::asio::ip::tcp::endpoint const endpoint{address, 0};
+    char host[NI_MAXHOST];
+    if (auto const code = getnameinfo(endpoint.data(), endpoint.size(), host, sizeof host, nullptr, 0, NI_NAMEREQD))
+    {
+        return {addrinfo_error(code), {}};
+    }
+    return {{}, {host}};
+}
+
+} // namespace
+
+DnsResolver::DnsResolver(boost::asio::io_context& io_context, Backend backend)
+    : io_context_{io_context}
+    , pool_{max_concurrency}
+    , backend_{std::move(backend)}
+    , options_{}
+    , cache_{options_.capacity}
+    , running_{0}
+    , next_id_{0}
+    , hits_{0}
+    , misses_{0}
+{
+}
+
+auto DnsResolver::system_backend(Kind const kind, std::string const& name) -> Result
+{
+    return Kind::forward == kind ? forward(name) : reverse(name);
+}
+
+auto DnsResolver::lookup(Kind const kind, std::string const& name, Handler handler) -> std::uint64_t
+{
+    auto const id = ++next_id_;
+    waiters_.emplace(id, std::move(handler));
+
+    std::string key;
+    key += Kind::forward == kind ? 'f' : 'r';
+    key += name;
+
+    if (auto const entry = cache_.find(key))
+    {
+        if (clock::now() < entry->expires)
+        {
+            hits_++;
+            boost::asio::post(io_context_, [this, id, result = entry->result]() {
+                deliver(id, result);
+            });
+            return id;
+        }
+        cache_.erase(key);
+    }
+    misses_++;
+
+    // Join a lookup of the same name that is already queued or running
+    auto& ids = pending_[key];
+    ids.push_back(id);
+    if (1 == ids.size())
+    {
+        queue_.push_back(std::move(key));
+        pump();
+    }
+    return id;
+}
+
+auto DnsResolver::cancel(std::uint64_t const id) -> void
+{
+    waiters_.erase(id);
+}
+
+auto DnsResolver::pump() -> void
+{
+    while (running_ < std::min(options_.concurrency, max_concurrency) && not queue_.empty())
+    {
+        auto key = std::move(queue_.front());
+        queue_.pop_front();
+
+        // Skip lookups that every requester has cancelled
+        auto const it = pending_.find(key);
+        if (std::none_of(it->second.begin(), it->second.end(), [this](auto const id) { return waiters_.contains(id); }))
+        {
+            pending_.erase(it);
+            continue;
+        }
+
+        running_++;
+        boost::asio::post(
+            pool_,
+            [this, key = std::move(key), backend = backend_, work = boost::asio::make_work_guard(io_context_), start = clock::now()]() mutable {
+                auto const kind = 'f' == key[0] ? Kind::forward : Kind::reverse;
+                auto result = backend(kind, key.substr(1));
+                boost::asio::post(work.get_executor(), [this, key = std::move(key), result = std::move(result), start]() mutable {
+                    finish(key, std::move(result), clock::now() - start);
+                });
+            }
+        );
+    }
+}
+
+auto DnsResolver::finish(std::string const& key, Result result, clock::duration const elapsed) -> void
+{
+    static auto& latency = metrics::histogram("snowcone_dns_lookup_seconds", "Time to complete DNS lookups");
+    static auto& failures = metrics::counter("snowcone_dns_lookup_errors_total", "DNS lookups that failed");
+    latency.observe(elapsed);
+    if (result.error)
+    {
+        failures.add();
+    }
+
+    running_--;
+
+    if (not result.error)
+    {
+        cache_.insert(key, {result, clock::now() + options_.ttl});
+    }
+    else if (cacheable_failure(result.error))
+    {
+        cache_.insert(key, {result, clock::now() + options_.negative_ttl});
+    }
+
+    auto ids = std::move(pending_[key]);
+    pending_.erase(key);
+
+    for (auto const id : ids)
+    {
+        deliver(id, result);
+    }
+
+    pump();
+}
+
+auto DnsResolver::deliver(std::uint64_t const id, Result const& result) -> void
+{
+    auto const it = waiters_.find(id);
+    if (it == waiters_.end())
+    {
+        return;
+    }
+    auto handler = std::move(it->second);
+    waiters_.erase(it);
+    handler(result);
+}
+
+auto DnsResolver::set_options(Options const& options) -> void
+{
+    options_ = options;
+    cache_.set_capacity(options.capacity);
+    pump();
+}
+
+auto DnsResolver::stats() const -> Stats
+{
+    return {
+        .hits = hits_,
+        .misses = misses_,
+        .evictions = cache_.evictions(),
+        .entries = cache_.size(),
+        .queued = queue_.size(),
+        .running = running_,
+    };
+}
+
+auto DnsResolver::shutdown() -> void
+{
+    pool_.stop();
+    pool_.join();
+}
@@ -0,0 +1,146 @@
+#pragma once
+/**
+ * @file dns_resolver.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Caching name resolution service
+ *
+ */
+
+#include "../lru_cache.hpp"
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Forward and reverse name lookups with caching and a concurrency cap
+ *
+ * Lookups run on a private thread pool so a slow resolver never blocks the
+ * event loop, and at most a configured number run at once; the rest wait
+ * in a queue. Concurrent requests for the same name share one lookup.
+ * Answers are cached for a fixed time and failures that mean the name
+ * doesn't exist are cached for a shorter time. The system resolver does
+ * not report record TTLs, so these times are configuration.
+ *
+ * Handlers always run later on the event loop, never inside lookup().
+ */
+class DnsResolver
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum class Kind
+    {
+        forward, // name to addresses
+        reverse, // address to names (PTR)
+    };
+
+    struct Result
+    {
+        boost::system::error_code error;
+        // Addresses for forward lookups, host names for reverse lookups
+        std::vector<std::string> names;
+    };
+
+    using Handler = std::function<void(Result const&)>;
+    using Backend = std::function<Result(Kind, std::string const&)>;
+
+    struct Options
+    {
+        std::size_t concurrency = 4;
+        clock::duration ttl = std::chrono::minutes{5};
+        clock::duration negative_ttl = std::chrono::seconds{30};
+        std::size_t capacity = 1024;
+    };
+
+    struct Stats
+    {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t evictions;
+        std::size_t entries;
+        std::size_t queued;
+        std::size_t running;
+    };
+
+    /// Threads in the lookup pool and so the largest useful concurrency
+    static constexpr std::size_t max_concurrency = 8;
+
+private:
+    struct Entry
+    {
+        Result result;
+        clock::time_point expires;
+    };
+
+    boost::asio::io_context& io_context_;
+    boost::asio::thread_pool pool_;
+    Backend backend_;
+    Options options_;
+
+    LruCache<std::string, Entry> cache_;
+    // Handlers waiting for an answer by request id
+    std::unordered_map<std::uint64_t, Handler> waiters_;
+    // Request ids waiting on each queued or running lookup
+    std::unordered_map<std::string, std::vector<std::uint64_t>> pending_;
+    std::deque<std::string> queue_;
+    std::size_t running_;
+    std::uint64_t next_id_;
+    std::uint64_t hits_;
+    std::uint64_t misses_;
+
+    auto pump() -> void;
+    auto finish(std::string const& key, Result result, clock::duration elapsed) -> void;
+    auto deliver(std::uint64_t id, Result const& result) -> void;
+
+public:
+    /**
+     * @param io_context Event loop that runs the handlers
+     * @param backend Lookup function run on the pool, defaults to the system resolver
+     */
+    explicit DnsResolver(boost::asio::io_context& io_context, Backend backend = system_backend);
+
+    /**
+     * @brief Start a lookup
+     *
+     * @param kind Forward or reverse lookup
+     * @param name Host name, or textual address for a reverse lookup
+     * @param handler Called once with the answer unless cancelled first
+     * @return Request id for cancel
+     */
+    auto lookup(Kind kind, std::string const& name, Handler handler) -> std::uint64_t;
+
+    /**
+     * @brief Forget a request so that its handler never runs
+     *
+     * A lookup still runs to completion and fills the cache when it had
+     * already started.
+     */
+    auto cancel(std::uint64_t id) -> void;
+
+    auto set_options(Options const& options) -> void;
+
+    auto get_options() const -> Options const&
+    {
+        return options_;
+    }
+
+    auto stats() const -> Stats;
+
+    /**
+     * @brief Stop the pool and wait for running lookups
+     *
+     * Lookups still queued are dropped without calling their handlers.
+     */
+    auto shutdown() -> void;
+
+    /// getaddrinfo and getnameinfo
+    static auto system_backend(Kind kind, std::string const& name) -> Result;
+};
@@ -0,0 +1,266 @@
+#include "happy_eyeballs.hpp"
+
+#include <boost/io/ios_state.hpp>
+
+#include <iomanip>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Progress of one connect shared with the completion handlers
+ *
+ * Handlers can run after the connect has returned, so they share
+ * ownership of this state rather than referring into the coroutine.
+ */
+struct HappyEyeballs::State
+{
+    // Expires when the next attempt is due; cancelled to wake the connect early
+    boost::asio::steady_timer wake;
+    std::vector<boost::asio::ip::tcp::socket> sockets;
+    std::vector<clock::time_point> started;
+    std::vector<bool> done;
+    std::vector<Attempt> attempts;
+
+    std::size_t running = 0;
+    std::optional<std::size_t> winner;
+    boost::system::error_code last_error;
+    // Set when an attempt failed or the delay passed
+    bool start_next = false;
+    bool finished = false;
+    bool cancelled = false;
+
+    explicit State(boost::asio::any_io_executor const& executor)
+        : wake{executor}
+    {
+    }
+
+    auto start(endpoint_type const& endpoint, std::shared_ptr<State> self) -> void
+    {
+        auto const i = sockets.size();
+        auto& socket = sockets.emplace_back(wake.get_executor());
+        started.push_back(clock::now());
+        done.push_back(false);
+        attempts.push_back({endpoint, {}, {}});
+        running++;
+
+        socket.async_connect(endpoint, [i, self = std::move(self)](boost::system::error_code const& error) {
+            self->complete(i, error);
+        });
+    }
+
+    auto complete(std::size_t const i, boost::system::error_code const& error) -> void
+    {
+        if (finished)
+        {
+            return;
+        }
+
+        running--;
+        done[i] = true;
+        attempts[i].elapsed = clock::now() - started[i];
+        attempts[i].error = error;
+
+        if (error)
+        {
+            last_error = error;
+            start_next = true;
+        }
+        else if (not winner)
+        {
+            winner = i;
+        }
+        wake.cancel();
+    }
+
+    // Abandon every attempt except the winner
+    auto finish() -> void
+    {
+        finished = true;
+        auto const now = clock::now();
+        for (std::size_t i = 0; i < sockets.size(); i++)
+        {
+            if (i == winner)
+            {
+                continue;
+            }
+            if (not done[i])
+            {
+                attempts[i].elapsed = now - started[i];
+            }
+            if (not attempts[i].error)
+            {
+                attempts[i].error = boost::asio::error::operation_aborted;
+            }
+            boost::system::error_code ignored;
+            sockets[i].close(ignored);
+        }
+    }
+};
+
+HappyEyeballs::HappyEyeballs(boost::asio::any_io_executor executor, clock::duration const delay)
+    : executor_{std::move(executor)}
+    , delay_{delay}
+{
+}
+
+auto HappyEyeballs::interleave(std::vector<endpoint_type> endpoints) -> std::vector<endpoint_type>
+{
+    if (endpoints.empty())
+    {
+        return endpoints;
+    }
+
+    auto const first_v6 = endpoints.front().address().is_v6();
+    std::vector<endpoint_type> preferred, other;
+    for (auto& endpoint : endpoints)
+    {
+        (endpoint.address().is_v6() == first_v6 ? preferred : other).push_back(std::move(endpoint));
+    }
+
+    std::vector<endpoint_type> result;
+    result.reserve(preferred.size() + other.size());
+    for (std::size_t i = 0; i < preferred.size() || i < other.size(); i++)
+    {
+        if (i < preferred.size())
+        {
+            result.push_back(std::move(preferred[i]));
+        }
+        if (i < other.size())
+        {
+            result.push_back(std::move(other[i]));
+        }
+    }
+    return result;
+}
+
+auto HappyEyeballs::connect(std::vector<endpoint_type> endpoints) -> boost::asio::awaitable<boost::asio::ip::tcp::socket>
+{
+    endpoints = interleave(std::move(endpoints));
+    attempts_.clear();
+
+    if (endpoints.empty())
+    {
+        throw boost::system::system_error{boost::asio::error::host_not_found};
+    }
+
+    auto const state = std::make_shared<State>(executor_);
+    // Handlers find their socket by index, so the sockets must not move
+    state->sockets.reserve(endpoints.size());
+    state_ = state;
+
+    std::size_t next = 0;
+    boost::system::error_code failure;
+    for (;;)
+    {
+        if (state->cancelled)
+        {
+            failure = boost::asio::error::operation_aborted;
+            break;
+        }
+
+        if (state->winner)
+        {
+            break;
+        }
+
+        if (next < endpoints.size() && (0 == state->running || state->start_next))
+        {
+            state->start_next = false;
+            state->start(endpoints[next++], state);
+        }
+
+        if (0 == state->running)
+        {
+            failure = state->last_error;
+            break;
+        }
+
+        if (next < endpoints.size())
+        {
+            state->wake.expires_after(delay_);
+        }
+        else
+        {
+            state->wake.expires_at(boost::asio::steady_timer::time_point::max());
+        }
+
+        boost::system::error_code error;
+        co_await state->wake.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, error));
+        if (not error)
+        {
+            state->start_next = true; // delay passed without a connection
+        }
+    }
+
+    state->finish();
+    attempts_ = state->attempts;
+    if (state_ == state)
+    {
+        state_.reset();
+    }
+
+    if (failure)
+    {
+        throw boost::system::system_error{failure};
+    }
+    co_return std::move(state->sockets[*state->winner]);
+}
+
+auto HappyEyeballs::cancel() -> void
+{
+    if (auto const state = std::exchange(state_, nullptr))
+    {
+        state->cancelled = true;
+        state->wake.cancel();
+    }
+}
+
+namespace {
+
+auto outcome(boost::system::error_code const& error) -> char const*
+{
+    if (not error)
+    {
+        return "ok";
+    }
+    if (error == boost::asio::error::operation_aborted)
+    {
+        return "abandoned";
+    }
+    if (error == boost::asio::error::connection_refused)
+    {
+        return "refused";
+    }
+    if (error == boost::asio::error::timed_out)
+    {
+        return "timeout";
+    }
+    if (error == boost::asio::error::network_unreachable || error == boost::asio::error::host_unreachable)
+    {
+        return "unreachable";
+    }
+    return "failed";
+}
+
+} // namespace
+
+auto operator<<(std::ostream& os, std::vector<HappyEyeballs::Attempt> const& attempts) -> std::ostream&
+{
+    boost::io::ios_flags_saver const flags{os};
+    boost::io::ios_precision_saver const precision{os};
+    os << std::fixed << std::setprecision(1);
+
+    auto first = true;
+    for (auto const& attempt : attempts)
+    {
+        if (not first)
+        {
+            os << ',';
+        }
+        first = false;
+
+        auto const ms = std::chrono::duration<double, std::milli>{attempt.elapsed}.count();
+        os << attempt.endpoint << '/' << outcome(attempt.error) << '/' << ms << "ms";
+    }
+    return os;
+}
@@ -0,0 +1,92 @@
+#pragma once
+/**
+ * @file happy_eyeballs.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Racing TCP connections across resolved addresses (RFC 8305)
+ *
+ */
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief TCP connector that races the addresses of a host
+ *
+ * Addresses are tried in resolver order with the address families
+ * interleaved. A new attempt starts whenever the previous one fails or
+ * when the attempt delay passes without a connection, so a blackholed
+ * address family costs one delay rather than a full TCP timeout. The
+ * first connection to succeed wins and the others are abandoned.
+ */
+class HappyEyeballs
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using endpoint_type = boost::asio::ip::tcp::endpoint;
+
+    /// Recommended by RFC 8305 section 8
+    static constexpr clock::duration default_delay = std::chrono::milliseconds{250};
+
+    struct Attempt
+    {
+        endpoint_type endpoint;
+        // Time from starting the attempt until it finished or was abandoned
+        clock::duration elapsed;
+        // Empty for the winner, operation_aborted for abandoned attempts
+        boost::system::error_code error;
+    };
+
+private:
+    struct State;
+
+    boost::asio::any_io_executor executor_;
+    clock::duration delay_;
+    std::shared_ptr<State> state_;
+    std::vector<Attempt> attempts_;
+
+public:
+    explicit HappyEyeballs(boost::asio::any_io_executor executor, clock::duration delay = default_delay);
+
+    /**
+     * @brief Order addresses for connection attempts
+     *
+     * Keeps the resolver's preference but alternates between address
+     * families, starting with the family of the first address.
+     */
+    static auto interleave(std::vector<endpoint_type> endpoints) -> std::vector<endpoint_type>;
+
+    /**
+     * @brief Connect to the first address that accepts
+     *
+     * @param endpoints Resolved addresses in preference order
+     * @return Connected socket
+     * @throws boost::system::system_error with the last failure when no attempt succeeds
+     */
+    auto connect(std::vector<endpoint_type> endpoints) -> boost::asio::awaitable<boost::asio::ip::tcp::socket>;
+
+    /**
+     * @brief Abandon a connect in progress
+     *
+     * The pending connect completes with operation_aborted.
+     */
+    auto cancel() -> void;
+
+    /**
+     * @brief Attempts made by the most recent connect in the order they started
+     */
+    auto attempts() const -> std::vector<Attempt> const&
+    {
+        return attempts_;
+    }
+};
+
+/**
+ * @brief Write attempts as comma-separated endpoint/outcome/latency
+ *
+ * Example: [::1]:6697/refused/0.2ms,127.0.0.1:6697/ok/0.3ms
+ */
+auto operator<<(std::ostream&, std::vector<HappyEyeballs::Attempt> const&) -> std::ostream&;
@@ -0,0 +1,316 @@
+#include "tls_cache.hpp"
+
+#include "../metrics.hpp"
+
+#include <openssl/sha.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Contexts are few: one per distinct client certificate in use
+std::size_t constexpr context_capacity = 8;
+std::size_t constexpr session_capacity = 64;
+
+/**
+ * @brief Association of a connection with the cache it reports sessions to
+ */
+struct Pending
+{
+    TlsCache* cache;
+    std::string key;
+};
+
+auto pending_index() -> int
+{
+    static int const index = SSL_get_ex_new_index(
+        0, nullptr, nullptr, nullptr,
+        [](void*, void* const ptr, CRYPTO_EX_DATA*, int, long, void*) {
+            delete static_cast<Pending*>(ptr);
+        }
+    );
+    return index;
+}
+
+auto expired(SSL_SESSION const* const session) -> bool
+{
+    return SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) <= std::time(nullptr);
+}
+
+auto hex(unsigned char const* const bytes, unsigned int const len) -> std::string
+{
+    static char const digits[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(2 * len);
+    for (unsigned i = 0; i < len; i++)
+    {
+        result += digits[bytes[i] >> 4];
+        result += digits[bytes[i] & 0xf];
+    }
+    return result;
+}
+
+auto cert_identity(X509* const cert) -> std::string
+{
+    if (nullptr == cert)
+    {
+        return {};
+    }
+
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_len = 0;
+    X509_digest(cert, EVP_sha256(), md, &md_len);
+    return hex(md, md_len);
+}
+
+auto public_key_digest(EVP_PKEY* const key) -> std::string
+{
+    if (nullptr == key)
+    {
+        return {};
+    }
+
+    unsigned char* der = nullptr;
+    auto const der_len = i2d_PUBKEY(key, &der);
+    if (der_len <= 0)
+    {
+        throw std::runtime_error{"private key"};
+    }
+
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_len = 0;
+    auto const success = EVP_Digest(der, der_len, md, &md_len, EVP_sha256(), nullptr);
+    OPENSSL_free(der);
+    if (1 != success)
+    {
+        throw std::runtime_error{"private key"};
+    }
+    return hex(md, md_len);
+}
+
+// Session file records: uint32 key length, key, uint32 DER length, DER
+auto put_u32(std::string& out, std::uint32_t const n) -> void
+{
+    char bytes[4];
+    std::memcpy(bytes, &n, 4);
+    out.append(bytes, 4);
+}
+
+auto get_u32(std::string_view& in, std::uint32_t& n) -> bool
+{
+    if (in.size() < 4)
+    {
+        return false;
+    }
+    std::memcpy(&n, in.data(), 4);
+    in.remove_prefix(4);
+    return true;
+}
+
+} // namespace
+
+TlsCache::TlsCache()
+    : contexts_{context_capacity}
+    , sessions_{session_capacity}
+{
+}
+
+auto TlsCache::context(X509* const cert, EVP_PKEY* const key) -> std::shared_ptr<Context>
+{
+    static auto& built = metrics::counter("snowcone_tls_contexts_built_total", "TLS client contexts constructed");
+
+    auto identity = cert_identity(cert);
+    auto lookup = identity;
+    if (nullptr != key)
+    {
+        lookup += '/';
+        lookup += public_key_digest(key);
+    }
+
+    if (auto const found = contexts_.find(lookup))
+    {
+        return *found;
+    }
+
+    auto context = std::make_shared<Context>(Context{
+        boost::asio::ssl::context{boost::asio::ssl::context::method::tls_client},
+        std::move(identity),
+    });
+    auto const ctx = context->ssl_context.native_handle();
+    context->ssl_context.set_default_verify_paths();
+
+    if (nullptr != cert)
+    {
+        if (1 != SSL_CTX_use_certificate(ctx, cert))
+        {
+            throw std::runtime_error{"certificate file"};
+        }
+    }
+    if (nullptr != key)
+    {
+        if (1 != SSL_CTX_use_PrivateKey(ctx, key))
+        {
+            throw std::runtime_error{"private key"};
+        }
+    }
+
+    // Sessions are kept by this cache rather than OpenSSL's internal one
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, on_new_session);
+
+    built.add();
+    return contexts_.insert(std::move(lookup), std::move(context));
+}
+
+auto TlsCache::prepare(SSL* const ssl, Context const& context, std::string_view const peer) -> void
+{
+    auto pending = std::make_unique<Pending>(Pending{this, context.identity});
+    pending->key += '\n';
+    pending->key += peer;
+
+    if (auto const session = sessions_.find(pending->key))
+    {
+        if (expired(session->get()) || not SSL_SESSION_is_resumable(session->get()))
+        {
+            sessions_.erase(pending->key);
+        }
+        else if (SessionPtr const copy{SSL_SESSION_dup(session->get()), SSL_SESSION_free})
+        {
+            // Offer a copy for the same reason on_new_session stores one
+            SSL_set_session(ssl, copy.get());
+        }
+    }
+
+    if (SSL_set_ex_data(ssl, pending_index(), pending.get()))
+    {
+        pending.release();
+    }
+}
+
+auto TlsCache::on_new_session(SSL* const ssl, SSL_SESSION* const session) -> int
+{
+    auto const pending = static_cast<Pending*>(SSL_get_ex_data(ssl, pending_index()));
+    if (nullptr == pending || not SSL_SESSION_is_resumable(session))
+    {
+        return 0;
+    }
+
+    // The connection keeps using this session object and OpenSSL marks it
+    // unresumable when the connection ends without a clean shutdown, so the
+    // cache holds its own copy.
+    if (SessionPtr copy{SSL_SESSION_dup(session), SSL_SESSION_free})
+    {
+        pending->cache->store(pending->key, std::move(copy));
+    }
+    return 0;
+}
+
+auto TlsCache::store(std::string key, SessionPtr session) -> void
+{
+    sessions_.insert(std::move(key), std::move(session));
+    if (not session_file_.empty())
+    {
+        save();
+    }
+}
+
+auto TlsCache::save() const -> void
+{
+    std::string out;
+    for (auto const& [key, session] : sessions_)
+    {
+        auto const len = i2d_SSL_SESSION(session.get(), nullptr);
+        if (len <= 0)
+        {
+            continue;
+        }
+        put_u32(out, key.size());
+        out += key;
+        put_u32(out, len);
+        auto const start = out.size();
+        out.resize(start + len);
+        auto p = reinterpret_cast<unsigned char*>(out.data() + start);
+        i2d_SSL_SESSION(session.get(), &p);
+    }
+
+    // Session tickets are secrets: write privately and replace atomically
+    auto const tmp = session_file_ + ".tmp";
+    auto const fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (-1 == fd)
+    {
+        return;
+    }
+    auto const written = ::write(fd, out.data(), out.size());
+    ::close(fd);
+    if (written == static_cast<ssize_t>(out.size()))
+    {
+        ::rename(tmp.c_str(), session_file_.c_str());
+    }
+    else
+    {
+        ::unlink(tmp.c_str());
+    }
+}
+
+auto TlsCache::set_session_file(std::string path) -> void
+{
+    std::string contents;
+    if (auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC); -1 != fd)
+    {
+        char buffer[4096];
+        ssize_t n;
+        while (0 < (n = ::read(fd, buffer, sizeof buffer)))
+        {
+            contents.append(buffer, n);
+        }
+        auto const error = errno;
+        ::close(fd);
+        if (-1 == n)
+        {
+            throw std::system_error{error, std::generic_category(), "failed to read TLS session file"};
+        }
+    }
+    else if (ENOENT != errno)
+    {
+        throw std::system_error{errno, std::generic_category(), "failed to open TLS session file"};
+    }
+
+    std::string_view in{contents};
+
+    // The file lists sessions from most to least recently used
+    std::vector<std::pair<std::string, SessionPtr>> loaded;
+    std::uint32_t keylen, derlen;
+    while (get_u32(in, keylen) && keylen <= in.size())
+    {
+        std::string key{in.substr(0, keylen)};
+        in.remove_prefix(keylen);
+
+        if (not get_u32(in, derlen) || derlen > in.size())
+        {
+            break;
+        }
+        auto p = reinterpret_cast<unsigned char const*>(in.data());
+        SessionPtr session{d2i_SSL_SESSION(nullptr, &p, derlen), SSL_SESSION_free};
+        in.remove_prefix(derlen);
+
+        if (session && SSL_SESSION_is_resumable(session.get()) && not expired(session.get()))
+        {
+            loaded.emplace_back(std::move(key), std::move(session));
+        }
+    }
+
+    for (auto it = loaded.rbegin(); it != loaded.rend(); ++it)
+    {
+        sessions_.insert(std::move(it->first), std::move(it->second));
+    }
+    session_file_ = std::move(path);
+}
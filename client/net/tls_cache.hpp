@@ -0,0 +1,88 @@
+#pragma once
+/**
+ * @file tls_cache.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Reuse of TLS client contexts and sessions across connections
+ *
+ */
+
+#include "../lru_cache.hpp"
+
+#include <boost/asio/ssl.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief TLS client contexts and resumable sessions shared by connections
+ *
+ * Contexts are built once per distinct client certificate and key. Sessions,
+ * including TLS 1.3 tickets, are remembered by client certificate and
+ * peer and offered again on the next connection to that peer. Sessions
+ * can be saved to a file so that they survive restarts.
+ */
+class TlsCache
+{
+public:
+    struct Context
+    {
+        boost::asio::ssl::context ssl_context;
+        // Hex SHA-256 of the client certificate or empty without one
+        std::string identity;
+    };
+
+private:
+    using SessionPtr = std::unique_ptr<SSL_SESSION, decltype(&SSL_SESSION_free)>;
+
+    // Keyed by certificate and public key digests so that separately
+    // loaded copies of the same credentials share a context
+    LruCache<std::string, std::shared_ptr<Context>> contexts_;
+    LruCache<std::string, SessionPtr> sessions_;
+    std::string session_file_;
+
+    static auto on_new_session(SSL* ssl, SSL_SESSION* session) -> int;
+    auto store(std::string key, SessionPtr session) -> void;
+    auto save() const -> void;
+
+public:
+    TlsCache();
+
+    /**
+     * @brief Find or build the context for a client certificate and key
+     *
+     * @param cert Client certificate or nullptr
+     * @param key Client private key or nullptr
+     * @return Shared context
+     */
+    auto context(X509* cert, EVP_PKEY* key) -> std::shared_ptr<Context>;
+
+    /**
+     * @brief Offer a remembered session and remember the ones issued
+     *
+     * @param ssl Connection that hasn't started its handshake
+     * @param context Context the connection was created from
+     * @param peer Everything identifying the server: address, SNI, and verification name
+     */
+    auto prepare(SSL* ssl, Context const& context, std::string_view peer) -> void;
+
+    /**
+     * @brief Load sessions from a file and save new sessions to it
+     *
+     * A missing file is treated as empty.
+     *
+     * @param path Session file path
+     * @throws std::system_error when the file can't be read
+     */
+    auto set_session_file(std::string path) -> void;
+
+    auto session_count() const -> std::size_t
+    {
+        return sessions_.size();
+    }
+};
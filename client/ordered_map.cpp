@@ -0,0 +1,563 @@
+#include "ordered_map.hpp"
+
+#include "irccase.hpp"
+#include "userdata.hpp"
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Ring buffer bookkeeping and string key index
+ *
+ * Keys and values are stored in Lua arrays held as uservalues so that
+ * the garbage collector sees them. String keys are indexed by an
+ * open-addressing table of slot numbers hashed and compared through
+ * the irccase table when case folding, so lookups never build a
+ * folded copy of the key. Other keys are indexed by a Lua table.
+ */
+struct OrderedMap
+{
+    static std::uint32_t constexpr empty = 0;
+    static std::uint32_t constexpr tombstone = UINT32_MAX;
+
+    // Hash of the string key stored in each slot
+    std::vector<std::uint32_t> hashes;
+    // Slot number plus one, or empty, or tombstone
+    std::vector<std::uint32_t> buckets;
+    // Buckets that are not empty
+    std::size_t used;
+
+    lua_Integer n;
+    lua_Integer max;
+    lua_Integer ticker;
+    // Incremented whenever insertion numbers are reassigned
+    lua_Integer epoch;
+    bool casefold;
+
+    OrderedMap(lua_Integer const max, bool const casefold)
+        : hashes(max)
+        , buckets(bucket_count(max))
+        , used{0}
+        , n{0}
+        , max{max}
+        , ticker{0}
+        , epoch{0}
+        , casefold{casefold}
+    {
+    }
+
+    static auto bucket_count(lua_Integer const max) -> std::size_t
+    {
+        return std::bit_ceil(std::max(std::size_t{8}, 2 * static_cast<std::size_t>(max)));
+    }
+
+    auto hash(std::string_view const key) const -> std::uint32_t
+    {
+        std::uint32_t h = 2166136261; // FNV-1a
+        for (auto const c : key)
+        {
+            h ^= std::uint8_t(casefold ? irccase(c) : c);
+            h *= 16777619;
+        }
+        return h;
+    }
+
+    auto equal(std::string_view const x, std::string_view const y) const -> bool
+    {
+        return casefold ? irccase_equal(x, y) : x == y;
+    }
+
+    // Reinsert the live buckets into a clean table
+    auto rehash() -> void
+    {
+        std::vector<std::uint32_t> old(buckets.size());
+        std::swap(old, buckets);
+        used = 0;
+
+        auto const mask = buckets.size() - 1;
+        for (auto const e : old)
+        {
+            if (e != empty && e != tombstone)
+            {
+                auto b = hashes[e - 1] & mask;
+                while (buckets[b] != empty)
+                {
+                    b = (b + 1) & mask;
+                }
+                buckets[b] = e;
+                used++;
+            }
+        }
+    }
+};
+
+// Largest capacity representable in a bucket
+lua_Integer constexpr max_capacity = lua_Integer{1} << 30;
+
+// Stack indexes of the uservalue tables
+struct Tables
+{
+    int keys, vals, fields, others;
+};
+
+auto push_tables(lua_State* const L, int const ud) -> Tables
+{
+    lua_getiuservalue(L, ud, 1);
+    lua_getiuservalue(L, ud, 2);
+    lua_getiuservalue(L, ud, 3);
+    lua_getiuservalue(L, ud, 4);
+    auto const top = lua_gettop(L);
+    return {top - 3, top - 2, top - 1, top};
+}
+
+auto string_key(lua_State* const L, int const idx) -> std::optional<std::string_view>
+{
+    if (LUA_TSTRING == lua_type(L, idx))
+    {
+        std::size_t len;
+        auto const str = lua_tolstring(L, idx, &len);
+        return std::string_view{str, len};
+    }
+    return std::nullopt;
+}
+
+// The string stays alive as long as it is in the keys table
+auto slot_key(lua_State* const L, Tables const& t, std::uint32_t const slot) -> std::string_view
+{
+    lua_rawgeti(L, t.keys, slot + 1);
+    std::size_t len;
+    auto const str = lua_tolstring(L, -1, &len);
+    lua_pop(L, 1);
+    return {str, len};
+}
+
+/**
+ * @brief Find the bucket holding a string key
+ *
+ * @return bucket position, or the first reusable position as the second result
+ */
+auto probe(lua_State* const L, OrderedMap const& m, Tables const& t, std::string_view const key, std::uint32_t const h)
+    -> std::pair<std::optional<std::size_t>, std::size_t>
+{
+    auto const mask = m.buckets.size() - 1;
+    std::optional<std::size_t> reusable;
+    for (auto b = h & mask;; b = (b + 1) & mask)
+    {
+        auto const e = m.buckets[b];
+        if (e == OrderedMap::empty)
+        {
+            return {std::nullopt, reusable.value_or(b)};
+        }
+        if (e == OrderedMap::tombstone)
+        {
+            if (not reusable)
+            {
+                reusable = b;
+            }
+        }
+        else if (m.hashes[e - 1] == h && m.equal(slot_key(L, t, e - 1), key))
+        {
+            return {b, b};
+        }
+    }
+}
+
+// Slot indexed by the key at idx
+auto get_index(lua_State* const L, OrderedMap const& m, Tables const& t, int const idx) -> std::optional<std::uint32_t>
+{
+    if (auto const key = string_key(L, idx))
+    {
+        auto const [found, _] = probe(L, m, t, *key, m.hash(*key));
+        if (found)
+        {
+            return m.buckets[*found] - 1;
+        }
+    }
+    else if (not lua_isnil(L, idx))
+    {
+        lua_pushvalue(L, idx);
+        if (LUA_TNUMBER == lua_rawget(L, t.others))
+        {
+            auto const slot = lua_tointeger(L, -1) - 1;
+            lua_pop(L, 1);
+            return slot;
+        }
+        lua_pop(L, 1);
+    }
+    return std::nullopt;
+}
+
+// Point the key at idx to slot
+auto set_index(lua_State* const L, OrderedMap& m, Tables const& t, int const idx, std::uint32_t const slot) -> void
+{
+    if (auto const key = string_key(L, idx))
+    {
+        auto const h = m.hash(*key);
+        auto const [found, position] = probe(L, m, t, *key, h);
+        m.hashes[slot] = h;
+        if (not found && m.buckets[position] == OrderedMap::empty)
+        {
+            m.used++;
+        }
+        m.buckets[position] = slot + 1;
+
+        if (4 * m.used > 3 * m.buckets.size())
+        {
+            m.rehash();
+        }
+    }
+    else if (not lua_isnil(L, idx))
+    {
+        lua_pushvalue(L, idx);
+        lua_pushinteger(L, slot + 1);
+        lua_rawset(L, t.others);
+    }
+}
+
+// Forget the key at idx if it still refers to slot
+auto remove_index(lua_State* const L, OrderedMap& m, Tables const& t, int const idx, std::uint32_t const slot) -> void
+{
+    if (auto const key = string_key(L, idx))
+    {
+        auto const [found, _] = probe(L, m, t, *key, m.hash(*key));
+        if (found && m.buckets[*found] == slot + 1)
+        {
+            m.buckets[*found] = OrderedMap::tombstone;
+        }
+    }
+    else if (not lua_isnil(L, idx))
+    {
+        lua_pushvalue(L, idx);
+        auto const ty = lua_rawget(L, t.others);
+        auto const current = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        if (LUA_TNUMBER == ty && current == slot + 1)
+        {
+            lua_pushvalue(L, idx);
+            lua_pushnil(L);
+            lua_rawset(L, t.others);
+        }
+    }
+}
+
+// Replace the keys, values, and index tables with empty ones
+auto new_tables(lua_State* const L, int const ud, lua_Integer const max) -> void
+{
+    lua_createtable(L, max, 0);
+    lua_setiuservalue(L, ud, 1);
+    lua_createtable(L, max, 0);
+    lua_setiuservalue(L, ud, 2);
+    lua_newtable(L);
+    lua_setiuservalue(L, ud, 4);
+}
+
+auto l_insert(lua_State* const L) -> int
+{
+    auto& m = *check_udata<OrderedMap>(L, 1);
+    luaL_checkany(L, 3);
+    lua_settop(L, 3);
+    auto const t = push_tables(L, 1);
+
+    auto const slot = static_cast<std::uint32_t>(m.n % m.max);
+    m.n++;
+
+    // Overwriting old entry, remove from index if needed
+    lua_rawgeti(L, t.keys, slot + 1);
+    remove_index(L, m, t, lua_gettop(L), slot);
+    lua_pop(L, 1);
+
+    // Store the key before indexing it so that probes can compare it
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, t.keys, slot + 1);
+    lua_pushvalue(L, 3);
+    lua_rawseti(L, t.vals, slot + 1);
+    set_index(L, m, t, 2, slot);
+
+    if (LUA_TNIL == lua_getfield(L, t.fields, "predicate"))
+    {
+        m.ticker++;
+    }
+    else
+    {
+        lua_pushvalue(L, 3);
+        lua_call(L, 1, 1);
+        if (lua_toboolean(L, -1))
+        {
+            m.ticker++;
+        }
+    }
+    return 0;
+}
+
+auto l_lookup(lua_State* const L) -> int
+{
+    auto const& m = *check_udata<OrderedMap>(L, 1);
+    lua_settop(L, 2);
+    auto const t = push_tables(L, 1);
+
+    if (auto const slot = get_index(L, m, t, 2))
+    {
+        lua_rawgeti(L, t.vals, *slot + 1);
+    }
+    else
+    {
+        lua_pushnil(L);
+    }
+    return 1;
+}
+
+auto l_rekey(lua_State* const L) -> int
+{
+    auto& m = *check_udata<OrderedMap>(L, 1);
+    lua_settop(L, 3);
+    auto const t = push_tables(L, 1);
+
+    if (auto const slot = get_index(L, m, t, 2))
+    {
+        remove_index(L, m, t, 2, *slot);
+        lua_pushvalue(L, 3);
+        lua_rawseti(L, t.keys, *slot + 1);
+        set_index(L, m, t, 3, *slot);
+    }
+    return 0;
+}
+
+// upvalues: map, position, n, count, max
+auto each_step(lua_State* const L, bool const newest_first) -> int
+{
+    auto const i = lua_tointeger(L, lua_upvalueindex(2));
+    auto const n = lua_tointeger(L, lua_upvalueindex(3));
+    auto const count = lua_tointeger(L, lua_upvalueindex(4));
+    auto const max = lua_tointeger(L, lua_upvalueindex(5));
+
+    if (i >= count)
+    {
+        return 0;
+    }
+
+    lua_pushinteger(L, i + 1);
+    lua_replace(L, lua_upvalueindex(2));
+
+    auto const slot = newest_first ? (n - i - 1) % max : (n + i) % count;
+    auto const t = push_tables(L, lua_upvalueindex(1));
+    lua_rawgeti(L, t.vals, slot + 1);
+    lua_rawgeti(L, t.keys, slot + 1);
+    lua_pushinteger(L, newest_first ? n - i : n - count + i + 1);
+    return 3;
+}
+
+auto push_iterator(lua_State* const L, lua_Integer const offset, lua_CFunction const step) -> int
+{
+    auto const& m = *check_udata<OrderedMap>(L, 1);
+    lua_pushvalue(L, 1);
+    lua_pushinteger(L, offset);
+    lua_pushinteger(L, m.n);
+    lua_pushinteger(L, std::min(m.n, m.max));
+    lua_pushinteger(L, m.max);
+    lua_pushcclosure(L, step, 5);
+    return 1;
+}
+
+auto l_each(lua_State* const L) -> int
+{
+    auto const offset = luaL_optinteger(L, 2, 0);
+    return push_iterator(L, offset, [](lua_State* const L) { return each_step(L, true); });
+}
+
+auto l_reveach(lua_State* const L) -> int
+{
+    return push_iterator(L, 0, [](lua_State* const L) { return each_step(L, false); });
+}
+
+auto l_get_oldest(lua_State* const L) -> int
+{
+    auto const& m = *check_udata<OrderedMap>(L, 1);
+    auto const t = push_tables(L, 1);
+    lua_rawgeti(L, t.vals, m.n <= m.max ? 1 : m.n % m.max + 1);
+    return 1;
+}
+
+auto l_reset(lua_State* const L) -> int
+{
+    auto& m = *check_udata<OrderedMap>(L, 1);
+    new_tables(L, 1, m.max);
+    std::fill(m.buckets.begin(), m.buckets.end(), OrderedMap::empty);
+    m.used = 0;
+    m.n = 0;
+    m.ticker = 0;
+    m.epoch++;
+    return 0;
+}
+
+auto l_resize(lua_State* const L) -> int
+{
+    auto& m = *check_udata<OrderedMap>(L, 1);
+    auto const max = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, 1 <= max && max <= max_capacity, 2, "capacity out of range");
+    lua_settop(L, 2);
+
+    auto const old = push_tables(L, 1);
+    auto const kept = std::min({m.n, m.max, max});
+
+    // Lay the newest entries out oldest first from the start of the new arrays
+    lua_createtable(L, max, 0);
+    auto const keys = lua_gettop(L);
+    lua_createtable(L, max, 0);
+    auto const vals = keys + 1;
+    for (lua_Integer age = 0; age < kept; age++)
+    {
+        auto const from = (m.n - 1 - age) % m.max + 1;
+        auto const to = kept - age;
+        lua_rawgeti(L, old.keys, from);
+        lua_rawseti(L, keys, to);
+        lua_rawgeti(L, old.vals, from);
+        lua_rawseti(L, vals, to);
+    }
+    lua_pushvalue(L, vals);
+    lua_setiuservalue(L, 1, 2);
+    lua_pushvalue(L, keys);
+    lua_setiuservalue(L, 1, 1);
+    lua_newtable(L);
+    lua_setiuservalue(L, 1, 4);
+
+    m.n = kept;
+    m.max = max;
+    m.epoch++;
+    m.hashes.assign(max, 0);
+    m.buckets.assign(OrderedMap::bucket_count(max), OrderedMap::empty);
+    m.used = 0;
+
+    auto const t = push_tables(L, 1);
+    for (lua_Integer slot = 0; slot < kept; slot++)
+    {
+        lua_rawgeti(L, t.keys, slot + 1);
+        set_index(L, m, t, lua_gettop(L), slot);
+        lua_pop(L, 1);
+    }
+    return 0;
+}
+
+auto l_index(lua_State* const L) -> int
+{
+    auto const& m = *check_udata<OrderedMap>(L, 1);
+    lua_settop(L, 2);
+
+    // methods
+    lua_pushvalue(L, 2);
+    if (LUA_TNIL != lua_rawget(L, lua_upvalueindex(1)))
+    {
+        return 1;
+    }
+    lua_pop(L, 1);
+
+    if (auto const key = string_key(L, 2))
+    {
+        if (*key == "n")
+        {
+            lua_pushinteger(L, m.n);
+            return 1;
+        }
+        if (*key == "max")
+        {
+            lua_pushinteger(L, m.max);
+            return 1;
+        }
+        if (*key == "ticker")
+        {
+            lua_pushinteger(L, m.ticker);
+            return 1;
+        }
+        if (*key == "epoch")
+        {
+            lua_pushinteger(L, m.epoch);
+            return 1;
+        }
+    }
+
+    lua_getiuservalue(L, 1, 3);
+    lua_pushvalue(L, 2);
+    lua_rawget(L, -2);
+    return 1;
+}
+
+auto l_newindex(lua_State* const L) -> int
+{
+    check_udata<OrderedMap>(L, 1);
+    lua_settop(L, 3);
+
+    if (auto const key = string_key(L, 2))
+    {
+        if (*key == "n" || *key == "max" || *key == "ticker" || *key == "epoch")
+        {
+            return luaL_error(L, "read-only field: %s", key->data());
+        }
+    }
+
+    lua_getiuservalue(L, 1, 3);
+    lua_insert(L, 2);
+    lua_rawset(L, 2);
+    return 0;
+}
+
+auto l_gc(lua_State* const L) -> int
+{
+    std::destroy_at(check_udata<OrderedMap>(L, 1));
+    return 0;
+}
+
+luaL_Reg const Methods[]{
+    {"insert", l_insert},
+    {"lookup", l_lookup},
+    {"rekey", l_rekey},
+    {"each", l_each},
+    {"reveach", l_reveach},
+    {"get_oldest", l_get_oldest},
+    {"reset", l_reset},
+    {"resize", l_resize},
+    {}
+};
+
+} // namespace
+
+template <>
+char const* udata_name<OrderedMap> = "ordered_map";
+
+auto l_new_ordered_map(lua_State* const L) -> int
+{
+    auto const max = luaL_checkinteger(L, 1);
+    auto const casefold = lua_toboolean(L, 2);
+    luaL_argcheck(L, 1 <= max && max <= max_capacity, 1, "capacity out of range");
+
+    auto const m = new_udata<OrderedMap>(L, 4, [L]() {
+        luaL_Reg const MT[]{
+            {"__gc", l_gc},
+            {"__newindex", l_newindex},
+            {}
+        };
+        luaL_setfuncs(L, MT, 0);
+
+        luaL_newlibtable(L, Methods);
+        luaL_setfuncs(L, Methods, 0);
+        lua_pushcclosure(L, l_index, 1);
+        lua_setfield(L, -2, "__index");
+    });
+    std::construct_at(m, max, casefold);
+
+    auto const ud = lua_gettop(L);
+    new_tables(L, ud, max);
+    lua_newtable(L);
+    lua_setiuservalue(L, ud, 3);
+    return 1;
+}
@@ -0,0 +1,35 @@
+#pragma once
+/**
+ * @file ordered_map.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Fixed-capacity ring buffer of recent entries with a key index
+ *
+ */
+
+struct lua_State;
+
+/**
+ * @brief Construct a new ordered map
+ *
+ * Arguments: capacity, boolean to index string keys ignoring RFC 1459 case
+ *
+ * Lua object methods:
+ * * insert(key, value) - add newest entry, evicting the oldest when full
+ * * lookup(key) - value of the newest entry with key
+ * * rekey(old, new) - change the key of an entry
+ * * each([offset]) - iterate value, key, number from newest to oldest
+ * * reveach() - iterate value, key, number from oldest to newest
+ * * get_oldest() - oldest value
+ * * reset() - remove all entries
+ * * resize(capacity) - change capacity keeping the newest entries
+ *
+ * Entries are numbered by insertion starting from 1. Read-only fields
+ * n (total insertions), max (capacity), ticker (insertions accepted by
+ * the predicate field), and epoch (incremented when reset or resize
+ * renumber the entries). Other fields such as predicate can be
+ * assigned freely.
+ *
+ * @param L Lua state
+ * @return 1
+ */
+auto l_new_ordered_map(lua_State* L) -> int;
@@ -0,0 +1,207 @@
+#include "prefix_trie.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+
+auto bit_at(std::array<std::uint8_t, 16> const& address, unsigned const i) -> unsigned
+{
+    return (address[i / 8] >> (7 - i % 8)) & 1;
+}
+
+// Number of leading bits two addresses share, up to limit
+auto common_bits(std::array<std::uint8_t, 16> const& x, std::array<std::uint8_t, 16> const& y, unsigned const limit) -> unsigned
+{
+    unsigned i = 0;
+    while (i < limit)
+    {
+        auto const diff = x[i / 8] ^ y[i / 8];
+        if (diff != 0)
+        {
+            return std::min(limit, i + std::countl_zero(static_cast<std::uint8_t>(diff)));
+        }
+        i += 8;
+    }
+    return limit;
+}
+
+// Clear the bits after the prefix
+auto masked(std::array<std::uint8_t, 16> address, unsigned const prefix) -> std::array<std::uint8_t, 16>
+{
+    for (unsigned i = prefix; i < 128; i++)
+    {
+        address[i / 8] &= ~(0x80 >> (i % 8));
+    }
+    return address;
+}
+
+auto to_address(std::string_view const bytes, unsigned const prefix) -> std::array<std::uint8_t, 16>
+{
+    std::array<std::uint8_t, 16> address{};
+    std::copy(bytes.begin(), bytes.end(), address.begin());
+    return masked(address, prefix);
+}
+
+} // namespace
+
+PrefixTrie::PrefixTrie()
+    : nodes_{
+        Node{{}, 0, {}, nullptr, 0},
+        Node{{}, 0, {}, nullptr, 0},
+    }
+{
+}
+
+auto PrefixTrie::valid(std::string_view const address, unsigned const prefix) -> bool
+{
+    return (address.size() == 4 || address.size() == 16) && prefix <= 8 * address.size();
+}
+
+auto PrefixTrie::node_for(std::string_view const bytes, unsigned const prefix) -> std::uint32_t
+{
+    auto const address = to_address(bytes, prefix);
+    std::uint32_t cur = bytes.size() == 4 ? 0 : 1;
+
+    // invariant: the prefix of cur is a prefix of address
+    for (;;)
+    {
+        if (nodes_[cur].bits == prefix)
+        {
+            return cur;
+        }
+
+        auto const b = bit_at(address, nodes_[cur].bits);
+        auto const child = nodes_[cur].children[b];
+
+        if (0 == child)
+        {
+            nodes_.push_back(Node{address, prefix, {}, nullptr, 0});
+            nodes_[cur].children[b] = nodes_.size() - 1;
+            return nodes_.size() - 1;
+        }
+
+        auto const common = common_bits(address, nodes_[child].address, std::min(prefix, nodes_[child].bits));
+        if (common == nodes_[child].bits)
+        {
+            cur = child;
+            continue;
+        }
+
+        // Split the edge at the first differing bit
+        std::uint32_t const mid = nodes_.size();
+        nodes_.push_back(Node{masked(address, common), common, {}, nullptr, 0});
+        nodes_[mid].children[bit_at(nodes_[child].address, common)] = child;
+        nodes_[cur].children[b] = mid;
+
+        if (common == prefix)
+        {
+            return mid;
+        }
+
+        nodes_.push_back(Node{address, prefix, {}, nullptr, 0});
+        nodes_[mid].children[bit_at(address, common)] = nodes_.size() - 1;
+        return nodes_.size() - 1;
+    }
+}
+
+auto PrefixTrie::insert(std::string_view const label, std::string_view const address, unsigned const prefix) -> void
+{
+    if (not valid(address, prefix))
+    {
+        throw std::invalid_argument{"bad network"};
+    }
+
+    remove(label);
+
+    auto const node = node_for(address, prefix);
+    if (auto const old = nodes_[node].label)
+    {
+        labels_.erase(labels_.find(*old));
+    }
+
+    auto const [it, _] = labels_.emplace(label, node);
+    nodes_[node].label = &it->first;
+    nodes_[node].count = 0;
+}
+
+auto PrefixTrie::remove(std::string_view const label) -> bool
+{
+    auto const it = labels_.find(label);
+    if (it == labels_.end())
+    {
+        return false;
+    }
+
+    // The node is left in place as an interior node
+    nodes_[it->second].label = nullptr;
+    nodes_[it->second].count = 0;
+    labels_.erase(it);
+    return true;
+}
+
+auto PrefixTrie::set(std::string_view const label, std::int64_t const count) -> bool
+{
+    auto const it = labels_.find(label);
+    if (it == labels_.end())
+    {
+        return false;
+    }
+    nodes_[it->second].count = count;
+    return true;
+}
+
+auto PrefixTrie::get(std::string_view const label) const -> std::optional<std::int64_t>
+{
+    auto const it = labels_.find(label);
+    if (it == labels_.end())
+    {
+        return std::nullopt;
+    }
+    return nodes_[it->second].count;
+}
+
+auto PrefixTrie::delta(std::string_view const bytes, std::int64_t const n) -> std::string const*
+{
+    if (not valid(bytes, 0))
+    {
+        return nullptr;
+    }
+
+    auto const bits = 8 * static_cast<unsigned>(bytes.size());
+    auto const address = to_address(bytes, bits);
+    std::uint32_t cur = bytes.size() == 4 ? 0 : 1;
+    Node* best = nodes_[cur].label ? &nodes_[cur] : nullptr;
+
+    while (nodes_[cur].bits < bits)
+    {
+        auto const child = nodes_[cur].children[bit_at(address, nodes_[cur].bits)];
+        if (0 == child || common_bits(address, nodes_[child].address, nodes_[child].bits) < nodes_[child].bits)
+        {
+            break;
+        }
+        cur = child;
+        if (nodes_[cur].label)
+        {
+            best = &nodes_[cur];
+        }
+    }
+
+    if (nullptr == best)
+    {
+        return nullptr;
+    }
+    best->count += n;
+    return best->label;
+}
+
+auto PrefixTrie::total() const -> std::int64_t
+{
+    std::int64_t n = 0;
+    for (auto const& [_, node] : labels_)
+    {
+        n += nodes_[node].count;
+    }
+    return n;
+}
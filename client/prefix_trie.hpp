@@ -0,0 +1,122 @@
+#pragma once
+/**
+ * @file prefix_trie.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Longest-prefix-match counters for IPv4 and IPv6 networks
+ *
+ */
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct lua_State;
+
+/**
+ * @brief Path-compressed binary trie of labeled network counters
+ *
+ * Each tracked network is identified by a label and owns a counter.
+ * Addresses are raw network-order bytes: 4 for IPv4 and 16 for IPv6,
+ * and the two families never match each other. Nodes are stored
+ * contiguously and refer to each other by position.
+ */
+class PrefixTrie
+{
+    using Address = std::array<std::uint8_t, 16>;
+
+    struct Node
+    {
+        Address address; // bits beyond the prefix length are zero
+        unsigned bits;
+        std::array<std::uint32_t, 2> children; // 0 when absent
+        std::string const* label; // tracked networks only
+        std::int64_t count;
+    };
+
+    // Nodes 0 and 1 are the IPv4 and IPv6 roots
+    std::vector<Node> nodes_;
+    std::map<std::string, std::uint32_t, std::less<>> labels_;
+
+public:
+    PrefixTrie();
+
+    /**
+     * @brief Check that an address and prefix length are usable
+     */
+    static auto valid(std::string_view address, unsigned prefix) -> bool;
+
+    /**
+     * @brief Start tracking a network with a zero count
+     *
+     * A label already in use is moved to the new network. A network
+     * already tracked under another label is taken over by this label.
+     *
+     * @param label Name reported for matches
+     * @param address 4 or 16 network-order bytes
+     * @param prefix Significant leading bits of address
+     * @throw std::invalid_argument when the address or prefix is invalid
+     */
+    auto insert(std::string_view label, std::string_view address, unsigned prefix) -> void;
+
+    /**
+     * @brief Stop tracking a network
+     * @return true when the label was tracked
+     */
+    auto remove(std::string_view label) -> bool;
+
+    /**
+     * @brief Overwrite the counter of a tracked network
+     * @return true when the label was tracked
+     */
+    auto set(std::string_view label, std::int64_t count) -> bool;
+
+    /**
+     * @brief Counter of a tracked network
+     */
+    auto get(std::string_view label) const -> std::optional<std::int64_t>;
+
+    /**
+     * @brief Adjust the counter of the longest network containing address
+     *
+     * @param address 4 or 16 network-order bytes
+     * @param n Amount to add
+     * @return Label of the matched network or nullptr when none match
+     */
+    auto delta(std::string_view address, std::int64_t n) -> std::string const*;
+
+    /**
+     * @brief Sum of all counters
+     */
+    auto total() const -> std::int64_t;
+
+    /**
+     * @brief Number of tracked networks
+     */
+    auto size() const -> std::size_t
+    {
+        return labels_.size();
+    }
+
+private:
+    auto node_for(std::string_view address, unsigned prefix) -> std::uint32_t;
+};
+
+/**
+ * @brief Construct an empty prefix trie
+ *
+ * Lua object methods:
+ * * insert(label, address, prefix)
+ * * remove(label)
+ * * set(label, count) or set({[label]=count, ...})
+ * * get(label) - count or nil
+ * * delta(address, n) - label of the matched network or nil
+ * * total()
+ *
+ * @param L Lua state
+ * @return 1
+ */
+auto l_new_prefix_trie(lua_State* L) -> int;
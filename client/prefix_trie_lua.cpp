@@ -0,0 +1,135 @@
+#include "prefix_trie.hpp"
+
+#include "strings.hpp"
+#include "userdata.hpp"
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+#include <memory>
+
+template <>
+char const* udata_name<PrefixTrie> = "prefix_trie";
+
+namespace {
+
+auto l_insert(lua_State* const L) -> int
+{
+    auto const trie = check_udata<PrefixTrie>(L, 1);
+    auto const label = check_string_view(L, 2);
+    auto const address = check_string_view(L, 3);
+    auto const prefix = luaL_optinteger(L, 4, 8 * address.size());
+    luaL_argcheck(L, address.size() == 4 || address.size() == 16, 3, "address must be 4 or 16 bytes");
+    luaL_argcheck(L, 0 <= prefix && PrefixTrie::valid(address, prefix), 4, "prefix out of range");
+    trie->insert(label, address, prefix);
+    return 0;
+}
+
+auto l_remove(lua_State* const L) -> int
+{
+    auto const trie = check_udata<PrefixTrie>(L, 1);
+    auto const label = check_string_view(L, 2);
+    lua_pushboolean(L, trie->remove(label));
+    return 1;
+}
+
+auto l_set(lua_State* const L) -> int
+{
+    auto const trie = check_udata<PrefixTrie>(L, 1);
+
+    // Bulk form: table of label to count
+    if (lua_istable(L, 2))
+    {
+        lua_settop(L, 2);
+        for (lua_pushnil(L); lua_next(L, 2); lua_pop(L, 1))
+        {
+            if (LUA_TSTRING == lua_type(L, -2))
+            {
+                std::size_t len;
+                auto const label = lua_tolstring(L, -2, &len);
+                trie->set({label, len}, lua_tointeger(L, -1));
+            }
+        }
+        return 0;
+    }
+
+    auto const label = check_string_view(L, 2);
+    auto const count = luaL_checkinteger(L, 3);
+    lua_pushboolean(L, trie->set(label, count));
+    return 1;
+}
+
+auto l_get(lua_State* const L) -> int
+{
+    auto const trie = check_udata<PrefixTrie>(L, 1);
+    auto const label = check_string_view(L, 2);
+    if (auto const count = trie->get(label))
+    {
+        lua_pushinteger(L, *count);
+    }
+    else
+    {
+        lua_pushnil(L);
+    }
+    return 1;
+}
+
+auto l_delta(lua_State* const L) -> int
+{
+    auto const trie = check_udata<PrefixTrie>(L, 1);
+    auto const address = check_string_view(L, 2);
+    auto const n = luaL_optinteger(L, 3, 1);
+    if (auto const label = trie->delta(address, n))
+    {
+        push_string(L, *label);
+    }
+    else
+    {
+        lua_pushnil(L);
+    }
+    return 1;
+}
+
+auto l_total(lua_State* const L) -> int
+{
+    auto const trie = check_udata<PrefixTrie>(L, 1);
+    lua_pushinteger(L, trie->total());
+    return 1;
+}
+
+auto l_gc(lua_State* const L) -> int
+{
+    std::destroy_at(check_udata<PrefixTrie>(L, 1));
+    return 0;
+}
+
+luaL_Reg const MT[]{
+    {"__gc", l_gc},
+    {}
+};
+
+luaL_Reg const Methods[]{
+    {"insert", l_insert},
+    {"remove", l_remove},
+    {"set", l_set},
+    {"get", l_get},
+    {"delta", l_delta},
+    {"total", l_total},
+    {}
+};
+
+} // namespace
+
+auto l_new_prefix_trie(lua_State* const L) -> int
+{
+    auto const trie = new_udata<PrefixTrie>(L, 0, [L]() {
+        luaL_setfuncs(L, MT, 0);
+        luaL_newlibtable(L, Methods);
+        luaL_setfuncs(L, Methods, 0);
+        lua_setfield(L, -2, "__index");
+    });
+    std::construct_at(trie);
+    return 1;
+}
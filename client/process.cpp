@@ -1,6 +1,7 @@
 #include "process.hpp"
 
 #include "app.hpp"
+#include "child_process.hpp"
 #include "safecall.hpp"
 #include "strings.hpp"
 #include "userdata.hpp"
@@ -13,9 +14,16 @@ extern "C" {
 #include <boost/asio.hpp>
 #include <boost/process.hpp>
 
+#include <chrono>
+#include <csignal>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include <signal.h>
+
 namespace {
 
 using ExecSig = void(int, std::string, std::string);
@@ -101,7 +109,8 @@ constexpr auto initiation = []<boost::asio::completion_handler_for<ExecSig> Hand
         boost::process::search_path(file),
         boost::process::args += std::move(args),
         boost::process::std_in<self->stdin_, boost::process::std_out> self->stdout_,
-        boost::process::std_err > self->stderr_
+        boost::process::std_err > self->stderr_,
+        restore_sigpipe()
     );
 };
 
@@ -158,3 +167,180 @@ auto l_execute(lua_State* L) -> int
     });
     return 0;
 }
+
+using namespace std::literals::string_view_literals;
+
+template <>
+char const* udata_name<std::weak_ptr<ChildProcess>> = "process";
+
+namespace {
+
+auto l_process_write(lua_State* const L) -> int
+{
+    auto const data = check_string_view(L, 2);
+    if (auto const process = check_udata<std::weak_ptr<ChildProcess>>(L, 1)->lock(); process && process->can_write())
+    {
+        lua_pushboolean(L, process->write(data));
+        return 1;
+    }
+    luaL_pushfail(L);
+    push_string(L, "stdin closed"sv);
+    return 2;
+}
+
+auto l_process_close(lua_State* const L) -> int
+{
+    if (auto const process = check_udata<std::weak_ptr<ChildProcess>>(L, 1)->lock())
+    {
+        process->close_stdin();
+    }
+    return 0;
+}
+
+auto l_process_kill(lua_State* const L) -> int
+{
+    auto const signal = luaL_optinteger(L, 2, SIGTERM);
+    if (auto const process = check_udata<std::weak_ptr<ChildProcess>>(L, 1)->lock())
+    {
+        lua_pushboolean(L, process->kill(signal));
+    }
+    else
+    {
+        lua_pushboolean(L, 0);
+    }
+    return 1;
+}
+
+auto l_process_pid(lua_State* const L) -> int
+{
+    if (auto const process = check_udata<std::weak_ptr<ChildProcess>>(L, 1)->lock())
+    {
+        lua_pushinteger(L, process->pid());
+        return 1;
+    }
+    return 0;
+}
+
+auto push_process(lua_State* const L, std::weak_ptr<ChildProcess> process) -> void
+{
+    auto const w = new_udata<std::weak_ptr<ChildProcess>>(L, 0, [L]() {
+        auto constexpr l_gc = [](lua_State* const L) -> int {
+            std::destroy_at(check_udata<std::weak_ptr<ChildProcess>>(L, 1));
+            return 0;
+        };
+
+        luaL_Reg const MT[]{
+            {"__gc", l_gc},
+            {},
+        };
+        luaL_setfuncs(L, MT, 0);
+
+        luaL_Reg const Methods[]{
+            {"write", l_process_write},
+            {"close", l_process_close},
+            {"kill", l_process_kill},
+            {"pid", l_process_pid},
+            {}
+        };
+        luaL_newlibtable(L, Methods);
+        luaL_setfuncs(L, Methods, 0);
+        lua_setfield(L, -2, "__index");
+    });
+    std::construct_at(w, std::move(process));
+}
+
+} // namespace
+
+auto l_spawn(lua_State* const L) -> int
+{
+    auto const file = check_string_view(L, 1);
+    auto const n = luaL_len(L, 2);
+    luaL_checkany(L, 3); // callback
+    auto const chunks = opt_boolean_field(L, 4, "chunks");
+    auto const input = opt_boolean_field(L, 4, "stdin");
+    auto const max_line = opt_integer_field(L, 4, "max_line", 65'536);
+    auto const high_water = opt_integer_field(L, 4, "write_high_water", 65'536);
+    auto const timeout = opt_integer_field(L, 4, "timeout", 0);
+    luaL_argcheck(L, 0 < max_line, 4, "max_line out of range");
+    luaL_argcheck(L, 0 < high_water, 4, "write_high_water out of range");
+    luaL_argcheck(L, 0 <= timeout, 4, "timeout out of range");
+
+    auto& args = new_object<std::vector<std::string>>(L);
+    args.reserve(n);
+
+    for (lua_Integer i = 1; i <= n; i++)
+    {
+        lua_geti(L, 2, i);
+        std::size_t len;
+        auto const str = luaL_tolstring(L, -1, &len);
+        args.emplace_back(str, len);
+        lua_pop(L, 2);
+    }
+
+    auto const app = App::from_lua(L);
+    auto const path = boost::process::search_path(std::string{file});
+    if (path.empty())
+    {
+        luaL_pushfail(L);
+        push_string(L, "command not found"sv);
+        return 2;
+    }
+
+    lua_pushvalue(L, 3);
+    auto const cb = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    auto const process = std::make_shared<ChildProcess>(
+        app->get_executor(),
+        ChildProcess::Handlers{
+            .output = [L = app->get_lua(), cb](std::string_view const stream, std::string_view const data, bool const partial) {
+                lua_rawgeti(L, LUA_REGISTRYINDEX, cb);
+                push_string(L, stream);
+                push_string(L, data);
+                lua_pushboolean(L, partial);
+                safecall(L, "process output callback", 3);
+            },
+            .drain = [L = app->get_lua(), cb]() {
+                lua_rawgeti(L, LUA_REGISTRYINDEX, cb);
+                push_string(L, "drain"sv);
+                safecall(L, "process drain callback", 1);
+            },
+            .exit = [L = app->get_lua(), cb](int const exit_code, bool const timed_out) {
+                lua_rawgeti(L, LUA_REGISTRYINDEX, cb);
+                luaL_unref(L, LUA_REGISTRYINDEX, cb);
+                push_string(L, "exit"sv);
+                lua_pushinteger(L, exit_code);
+                if (timed_out)
+                {
+                    push_string(L, "timeout"sv);
+                }
+                else
+                {
+                    lua_pushnil(L);
+                }
+                safecall(L, "process exit callback", 3);
+            },
+        },
+        ChildProcess::Options{
+            .chunks = chunks,
+            .input = input,
+            .max_line = static_cast<std::size_t>(max_line),
+            .write_high_water = static_cast<std::size_t>(high_water),
+            .timeout = std::chrono::milliseconds{timeout},
+        }
+    );
+
+    try
+    {
+        process->start(app->get_executor(), path, std::move(args));
+    }
+    catch (boost::process::process_error const& e)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, cb);
+        luaL_pushfail(L);
+        push_string(L, e.what());
+        return 2;
+    }
+
+    push_process(L, process);
+    return 1;
+}
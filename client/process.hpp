@@ -3,3 +3,22 @@
 struct lua_State;
 
 auto l_execute(lua_State* L) -> int;
+
+/**
+ * @brief Start a process and stream its output to a callback
+ *
+ * Lua arguments: file, argument list, callback, options table. The
+ * options are chunks (deliver output as read instead of by line),
+ * stdin (keep stdin open for writing), max_line, write_high_water,
+ * and timeout in milliseconds after which the process and everything
+ * it started are killed.
+ *
+ * The callback gets ('stdout' or 'stderr', text, partial) for output,
+ * ('drain') when queued input falls back below the high-water mark,
+ * and finally ('exit', code, reason) once the process has exited and
+ * both output streams are closed.
+ *
+ * @param L Lua state
+ * @return 1 - handle with write, close, kill, and pid methods, or fail and an error message
+ */
+auto l_spawn(lua_State* L) -> int;
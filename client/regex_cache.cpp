@@ -0,0 +1,268 @@
+#include "regex_cache.hpp"
+
+#include "lru_cache.hpp"
+#include "strings.hpp"
+#include "userdata.hpp"
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using Code = std::shared_ptr<pcre2_code>;
+
+struct Regex
+{
+    Code code;
+};
+
+struct RegexCache
+{
+    LruCache<std::string, Code> entries{256};
+    std::unique_ptr<pcre2_match_data, decltype(&pcre2_match_data_free)> match_data{
+        pcre2_match_data_create(1, nullptr), pcre2_match_data_free};
+    std::string key; // reused to avoid allocating on each lookup
+};
+
+struct CompileError
+{
+    int code;
+    PCRE2_SIZE offset;
+};
+
+} // namespace
+
+template <>
+char const* udata_name<Regex> = "mypcre2.regex";
+
+template <>
+char const* udata_name<RegexCache> = "mypcre2.cache";
+
+namespace {
+
+auto check_flags(lua_State* const L, int const arg) -> std::uint32_t
+{
+    std::uint32_t options = 0;
+    for (auto const c : std::string_view{luaL_optstring(L, arg, "")})
+    {
+        switch (c)
+        {
+        case 'i': options |= PCRE2_CASELESS; break;
+        case 'm': options |= PCRE2_MULTILINE; break;
+        case 's': options |= PCRE2_DOTALL; break;
+        case 'x': options |= PCRE2_EXTENDED; break;
+        default: luaL_argerror(L, arg, "unknown flag");
+        }
+    }
+    return options;
+}
+
+auto get_cache(lua_State* const L) -> RegexCache*
+{
+    return static_cast<RegexCache*>(lua_touserdata(L, lua_upvalueindex(1)));
+}
+
+/**
+ * @brief Find or compile a pattern
+ *
+ * Failed compilations are not cached.
+ *
+ * @return The compiled pattern, or nullptr with error filled in
+ */
+auto lookup(RegexCache* const cache, std::string_view const pattern, std::uint32_t const options, CompileError& error) -> Code const*
+{
+    cache->key.assign(reinterpret_cast<char const*>(&options), sizeof options);
+    cache->key.append(pattern);
+
+    if (auto const code = cache->entries.find(cache->key))
+    {
+        return code;
+    }
+
+    auto const code = pcre2_compile(
+        reinterpret_cast<PCRE2_SPTR>(pattern.data()), pattern.size(), options,
+        &error.code, &error.offset, nullptr);
+    if (nullptr == code)
+    {
+        return nullptr;
+    }
+
+    // Without JIT support pcre2_match falls back to the interpreter
+    pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+
+    return &cache->entries.insert(cache->key, Code{code, pcre2_code_free});
+}
+
+auto push_error(lua_State* const L, CompileError const& error) -> int
+{
+    PCRE2_UCHAR buffer[256];
+    pcre2_get_error_message(error.code, buffer, sizeof buffer);
+    luaL_pushfail(L);
+    lua_pushstring(L, reinterpret_cast<char const*>(buffer));
+    lua_pushinteger(L, error.offset + 1);
+    return 3;
+}
+
+// Pushes the 1-based inclusive match bounds or returns 0 on no match
+auto exec(lua_State* const L, RegexCache* const cache, pcre2_code const* const code, std::string_view const subject, std::size_t const start) -> int
+{
+    auto const match_data = cache->match_data.get();
+    auto const rc = pcre2_match(
+        code, reinterpret_cast<PCRE2_SPTR>(subject.data()), subject.size(), start,
+        0, match_data, nullptr);
+
+    // 0 means the ovector was too small, but the overall match is still set
+    if (rc < 0)
+    {
+        if (PCRE2_ERROR_NOMATCH != rc)
+        {
+            PCRE2_UCHAR buffer[256];
+            pcre2_get_error_message(rc, buffer, sizeof buffer);
+            luaL_error(L, "pcre2_match: %s", reinterpret_cast<char const*>(buffer));
+        }
+        return 0;
+    }
+
+    auto const ovector = pcre2_get_ovector_pointer(match_data);
+    lua_pushinteger(L, ovector[0] + 1);
+    lua_pushinteger(L, ovector[1]);
+    return 2;
+}
+
+auto l_regex_exec(lua_State* const L) -> int
+{
+    auto const regex = check_udata<Regex>(L, 1);
+    auto const subject = check_string_view(L, 2);
+    auto const init = luaL_optinteger(L, 3, 1);
+    luaL_argcheck(L, 1 <= init && init <= lua_Integer(subject.size()) + 1, 3, "init out of range");
+
+    auto const n = exec(L, get_cache(L), regex->code.get(), subject, init - 1);
+    if (0 == n)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+    return n;
+}
+
+auto l_regex_gc(lua_State* const L) -> int
+{
+    std::destroy_at(check_udata<Regex>(L, 1));
+    return 0;
+}
+
+auto l_compile(lua_State* const L) -> int
+{
+    auto const cache = get_cache(L);
+    auto const pattern = check_string_view(L, 1);
+    auto const options = check_flags(L, 2);
+
+    CompileError error;
+    auto const code = lookup(cache, pattern, options, error);
+    if (nullptr == code)
+    {
+        return push_error(L, error);
+    }
+
+    auto const regex = new_udata<Regex>(L, 0, [L]() {
+        lua_pushcfunction(L, l_regex_gc);
+        lua_setfield(L, -2, "__gc");
+
+        lua_createtable(L, 0, 1);
+        lua_pushvalue(L, lua_upvalueindex(1));
+        lua_pushcclosure(L, l_regex_exec, 1);
+        lua_setfield(L, -2, "exec");
+        lua_setfield(L, -2, "__index");
+    });
+    std::construct_at(regex, *code);
+    return 1;
+}
+
+auto l_match(lua_State* const L) -> int
+{
+    auto const cache = get_cache(L);
+    auto const subject = check_string_view(L, 1);
+    auto const pattern = check_string_view(L, 2);
+    auto const options = check_flags(L, 3);
+
+    CompileError error;
+    auto const code = lookup(cache, pattern, options, error);
+    if (nullptr == code)
+    {
+        return push_error(L, error);
+    }
+
+    auto const n = exec(L, cache, code->get(), subject, 0);
+    if (0 == n)
+    {
+        lua_pushboolean(L, false);
+        return 1;
+    }
+    return n;
+}
+
+auto l_stats(lua_State* const L) -> int
+{
+    auto const& entries = get_cache(L)->entries;
+    lua_createtable(L, 0, 5);
+    lua_pushinteger(L, entries.hits());
+    lua_setfield(L, -2, "hits");
+    lua_pushinteger(L, entries.misses());
+    lua_setfield(L, -2, "misses");
+    lua_pushinteger(L, entries.evictions());
+    lua_setfield(L, -2, "evictions");
+    lua_pushinteger(L, entries.size());
+    lua_setfield(L, -2, "size");
+    lua_pushinteger(L, entries.capacity());
+    lua_setfield(L, -2, "capacity");
+    return 1;
+}
+
+auto l_set_capacity(lua_State* const L) -> int
+{
+    auto const n = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, n > 0, 1, "capacity must be positive");
+    get_cache(L)->entries.set_capacity(n);
+    return 0;
+}
+
+auto l_cache_gc(lua_State* const L) -> int
+{
+    std::destroy_at(check_udata<RegexCache>(L, 1));
+    return 0;
+}
+
+luaL_Reg const M[]{
+    {"compile", l_compile},
+    {"match", l_match},
+    {"stats", l_stats},
+    {"set_capacity", l_set_capacity},
+    {}
+};
+
+} // namespace
+
+auto luaopen_mypcre2(lua_State* const L) -> int
+{
+    luaL_newlibtable(L, M);
+
+    // Shared by every function in the module, including regex methods
+    auto const cache = new_udata<RegexCache>(L, 0, [L]() {
+        lua_pushcfunction(L, l_cache_gc);
+        lua_setfield(L, -2, "__gc");
+    });
+    std::construct_at(cache);
+
+    luaL_setfuncs(L, M, 1);
+    return 1;
+}
@@ -0,0 +1,31 @@
+#pragma once
+/**
+ * @file regex_cache.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Cached PCRE2 regular expressions
+ *
+ */
+
+struct lua_State;
+
+/**
+ * @brief Open the mypcre2 module
+ *
+ * Compiled patterns are kept in an LRU cache keyed by pattern and flags
+ * and are JIT compiled when PCRE2 supports it. Flags are a string of
+ * option letters: i (caseless), m (multiline), s (dotall), x (extended).
+ *
+ * Lua functions:
+ * * compile(pattern [, flags]) - regex object or fail, message, offset
+ * * match(subject, pattern [, flags]) - start, end; false when there is
+ *   no match; fail, message when the pattern is invalid
+ * * stats() - table of hits, misses, evictions, size, capacity
+ * * set_capacity(n)
+ *
+ * Regex object methods:
+ * * exec(subject [, init]) - start, end or nil
+ *
+ * @param L Lua state
+ * @return 1
+ */
+auto luaopen_mypcre2(lua_State* L) -> int;
@@ -1,5 +1,7 @@
 #include "safecall.hpp"
 
+#include "metrics.hpp"
+
 extern "C" {
 #include <lauxlib.h>
 #include <lua.h>
@@ -9,6 +11,30 @@ extern "C" {
 
 #include <cstdio>
 #include <iostream>
+#include <map>
+#include <string>
+
+namespace {
+
+// Histograms are cached by location to keep registry lookups off the hot path
+auto callback_histogram(std::string_view const location) -> metrics::Histogram&
+{
+    static std::map<std::string, metrics::Histogram*, std::less<>> cache;
+
+    auto it = cache.find(location);
+    if (it == cache.end())
+    {
+        auto& histogram = metrics::histogram(
+            "snowcone_lua_callback_seconds",
+            "Time spent in Lua callbacks by location",
+            metrics::label("location", location)
+        );
+        it = cache.emplace(location, &histogram).first;
+    }
+    return *it->second;
+}
+
+} // namespace
 
 int safecall(lua_State* const L, std::string_view const location, int const args)
 {
@@ -22,13 +48,19 @@ int safecall(lua_State* const L, std::string_view const location, int const args
     lua_insert(L, -2 - args);
     // eh f a1 a2..
 
+    auto const start = metrics::clock::now();
     auto const status = lua_pcall(L, args, 0, -2 - args);
+    callback_histogram(location).observe(metrics::clock::now() - start);
+
     if (LUA_OK == status)
     {
         lua_pop(L, 1); /* handler */
     }
     else
     {
+        static auto& errors = metrics::counter("snowcone_lua_callback_errors_total", "Lua callbacks that raised an error");
+        errors.add();
+
         auto const err = lua_tolstring(L, -1, nullptr);
         endwin();
         std::cerr << "error in " << location << ": " << err << std::endl;
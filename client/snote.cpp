@@ -0,0 +1,524 @@
+#include "snote.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Anchored matcher for the subset of Lua patterns used by the rules
+ *
+ * This follows the backtracking algorithm of lstrlib.c so that captures
+ * agree with string.match. Supported: literals, '.', %-classes and
+ * escapes, [sets], the *, +, -, ? quantifiers, captures, and a final $.
+ */
+class Matcher
+{
+public:
+    static constexpr std::size_t max_captures = snote::Event::max_fields;
+
+private:
+    char const* src_end_;
+    char const* pat_end_;
+    std::size_t level_ = 0;
+
+    struct Capture
+    {
+        char const* init;
+        std::ptrdiff_t len;
+    };
+    static constexpr std::ptrdiff_t unfinished = -1;
+    std::array<Capture, max_captures> captures_;
+
+    static auto match_class(unsigned char const c, unsigned char const cl) -> bool
+    {
+        bool res;
+        switch (std::tolower(cl))
+        {
+        case 'a': res = std::isalpha(c); break;
+        case 'c': res = std::iscntrl(c); break;
+        case 'd': res = std::isdigit(c); break;
+        case 'g': res = std::isgraph(c); break;
+        case 'l': res = std::islower(c); break;
+        case 'p': res = std::ispunct(c); break;
+        case 's': res = std::isspace(c); break;
+        case 'u': res = std::isupper(c); break;
+        case 'w': res = std::isalnum(c); break;
+        case 'x': res = std::isxdigit(c); break;
+        default: return cl == c;
+        }
+        return std::isupper(cl) ? !res : res;
+    }
+
+    // p points at '[' and ec at the closing ']'
+    static auto match_bracket_class(unsigned char const c, char const* p, char const* const ec) -> bool
+    {
+        bool sig = true;
+        if (*(p + 1) == '^')
+        {
+            sig = false;
+            p++;
+        }
+        while (++p < ec)
+        {
+            if (*p == '%')
+            {
+                p++;
+                if (match_class(c, *p))
+                {
+                    return sig;
+                }
+            }
+            else if (*(p + 1) == '-' && p + 2 < ec)
+            {
+                p += 2;
+                if (static_cast<unsigned char>(*(p - 2)) <= c && c <= static_cast<unsigned char>(*p))
+                {
+                    return sig;
+                }
+            }
+            else if (static_cast<unsigned char>(*p) == c)
+            {
+                return sig;
+            }
+        }
+        return !sig;
+    }
+
+    auto class_end(char const* p) const -> char const*
+    {
+        switch (*p++)
+        {
+        case '%':
+            return p + 1;
+        case '[':
+            if (*p == '^')
+            {
+                p++;
+            }
+            do
+            {
+                if (*p++ == '%' && p < pat_end_)
+                {
+                    p++;
+                }
+            } while (*p != ']');
+            return p + 1;
+        default:
+            return p;
+        }
+    }
+
+    auto single_match(char const* const s, char const* const p, char const* const ep) const -> bool
+    {
+        if (s >= src_end_)
+        {
+            return false;
+        }
+        auto const c = static_cast<unsigned char>(*s);
+        switch (*p)
+        {
+        case '.': return true;
+        case '%': return match_class(c, *(p + 1));
+        case '[': return match_bracket_class(c, p, ep - 1);
+        default: return static_cast<unsigned char>(*p) == c;
+        }
+    }
+
+    auto max_expand(char const* const s, char const* const p, char const* const ep) -> char const*
+    {
+        std::ptrdiff_t i = 0;
+        while (single_match(s + i, p, ep))
+        {
+            i++;
+        }
+        // try with the maximum repetitions first, then fewer
+        for (; i >= 0; i--)
+        {
+            if (auto const res = match(s + i, ep + 1))
+            {
+                return res;
+            }
+        }
+        return nullptr;
+    }
+
+    auto min_expand(char const* s, char const* const p, char const* const ep) -> char const*
+    {
+        for (;;)
+        {
+            if (auto const res = match(s, ep + 1))
+            {
+                return res;
+            }
+            if (not single_match(s, p, ep))
+            {
+                return nullptr;
+            }
+            s++;
+        }
+    }
+
+    auto start_capture(char const* const s, char const* const p) -> char const*
+    {
+        captures_[level_++] = {s, unfinished};
+        auto const res = match(s, p);
+        if (nullptr == res)
+        {
+            level_--;
+        }
+        return res;
+    }
+
+    auto end_capture(char const* const s, char const* const p) -> char const*
+    {
+        auto l = level_;
+        while (captures_[--l].len != unfinished)
+        {
+        }
+        captures_[l].len = s - captures_[l].init;
+        auto const res = match(s, p);
+        if (nullptr == res)
+        {
+            captures_[l].len = unfinished;
+        }
+        return res;
+    }
+
+    auto match(char const* const s, char const* const p) -> char const*
+    {
+        if (p == pat_end_)
+        {
+            return s;
+        }
+
+        switch (*p)
+        {
+        case '(':
+            return start_capture(s, p + 1);
+        case ')':
+            return end_capture(s, p + 1);
+        case '$':
+            if (p + 1 == pat_end_)
+            {
+                return s == src_end_ ? s : nullptr;
+            }
+            break;
+        }
+
+        auto const ep = class_end(p);
+        if (not single_match(s, p, ep))
+        {
+            // accept empty repetition
+            return *ep == '*' || *ep == '?' || *ep == '-' ? match(s, ep + 1) : nullptr;
+        }
+
+        switch (*ep)
+        {
+        case '?':
+            if (auto const res = match(s + 1, ep + 1))
+            {
+                return res;
+            }
+            return match(s, ep + 1);
+        case '+':
+            return max_expand(s + 1, p, ep);
+        case '*':
+            return max_expand(s, p, ep);
+        case '-':
+            return min_expand(s, p, ep);
+        default:
+            return match(s + 1, ep);
+        }
+    }
+
+public:
+    /**
+     * @brief Match an anchored pattern against the whole subject
+     *
+     * @param pattern Pattern starting with '^'
+     * @param subject Text to match
+     * @return true when the pattern matched and captures are available
+     */
+    auto operator()(std::string_view const pattern, std::string_view const subject) -> bool
+    {
+        src_end_ = subject.data() + subject.size();
+        pat_end_ = pattern.data() + pattern.size();
+        level_ = 0;
+        return nullptr != match(subject.data(), pattern.data() + 1);
+    }
+
+    auto size() const -> std::size_t
+    {
+        return level_;
+    }
+
+    auto operator[](std::size_t const i) const -> std::string_view
+    {
+        return {captures_[i].init, static_cast<std::size_t>(captures_[i].len)};
+    }
+};
+
+enum class Conv
+{
+    str, // capture as-is
+    ip, // omitted when the server reports 0
+    integer, // decimal integer, omitted when out of range
+    lower, // ASCII lowercase
+    line_kind, // selects the event name from the kind of ban
+    literal, // fixed value, consumes no capture
+};
+
+struct FieldSpec
+{
+    std::string_view key;
+    Conv conv = Conv::str;
+    std::string_view literal = {};
+};
+
+struct Rule
+{
+    std::string_view word; // first word of every matching notice, empty when variable
+    std::string_view name;
+    std::string_view pattern;
+    std::array<FieldSpec, snote::Event::max_fields> fields;
+};
+
+constexpr FieldSpec ip{"ip", Conv::ip};
+constexpr FieldSpec kind_lower{"kind", Conv::lower};
+
+// These are in priority order: the first matching rule wins
+Rule const rules[]{
+    {"Client", "connect", "^Client connecting: (%S+) %(([^@ ]+)@([^) ]+)%) %[(.*)%] {(%S*)} <(%S*)> %[(.*)%]$",
+     {{{"nick"}, {"user"}, {"host"}, ip, {"class"}, {"account"}, {"gecos"}}}},
+    {"Client", "disconnect", "^Client exiting: (%S+) %(([^@ ]+)@([^) ]+)%) %[(.*)%] %[(.*)%]$",
+     {{{"nick"}, {"user"}, {"host"}, {"reason"}, ip}}},
+    {"", "", "^([^!]+)!([^@]+)@([^{]+){([^}]*)} added %S+ (%d+) min%. (%S+) for %[(%S*)%] %[(.*)%]$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}, {"duration", Conv::integer}, {"", Conv::line_kind}, {"mask"}, {"reason"}}}},
+    {"Nick", "nick", "^Nick change: From (%S+) to (%S+) %[([^@ ]+)@(%S+)%]$",
+     {{{"old"}, {"new"}, {"user"}, {"host"}}}},
+    {"FILTER:", "filter", "^FILTER: ([^! ]+)!([^@ ]+)@(%S+) %[(.*)%]$",
+     {{{"nick"}, {"user"}, {"host"}, ip}}},
+    {"KLINE", "kline_active", "^KLINE active for (%S+)%[([^@ ]+)@(%S+)%] %((.*)%)$",
+     {{{"nick"}, {"user"}, {"host"}, {"mask"}}}},
+    {"Disconnecting", "kline_active", "^Disconnecting K%-Lined user (%S+)%[([^@ ]+)@(%S+)%] %((.*)%)$",
+     {{{"nick"}, {"user"}, {"host"}, {"mask"}}}},
+    {"Disconnecting", "dline_active", "^Disconnecting D%-Lined user (%S+)%[([^@ ]+)@(%S+)%] %((.*)%)$",
+     {{{"nick"}, {"user"}, {"host"}, {"mask"}}}},
+    {"Temporary", "expired", "^Temporary (%S+) for %[(.*)%] expired$",
+     {{kind_lower, {"mask"}}}},
+    {"Propagated", "expired", "^Propagated ban for %[(.*)%] expired$",
+     {{{"kind", Conv::literal, "k-line"}, {"mask"}}}},
+    {"", "removed", "^([^! ]+)!([^@ ]+)@([^{ ]+){(%S*)} has removed the %S+ (%S+) for: %[(.*)%]$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}, kind_lower, {"mask"}}}},
+    {"Rejecting", "rejected", "^Rejecting (%S+)d user (%S+)%[([^@ ]+)@(%S+)%] %[(.*)%]$",
+     {{kind_lower, {"nick"}, {"user"}, {"host"}, {"mask"}}}},
+    {"Rejecting", "rejected", "^Rejecting (%S+)d user (%S+)%[([^@ ]+)@(%S+)%] %[(%S*)%] %((.*)%)$",
+     {{kind_lower, {"nick"}, {"user"}, {"host"}, ip, {"mask"}}}},
+    {"Netsplit", "netsplit", "^Netsplit (%S+) <%-> (%S+) %((%S+) (%S+)%) %((.*)%)$",
+     {{{"server1"}, {"server2"}, {"sid1"}, {"sid2"}, {"reason"}}}},
+    {"Netjoin", "netjoin", "^Netjoin (%S+) <%-> (%S+) %((%S+) (%S+)%)$",
+     {{{"server1"}, {"server2"}, {"sid1"}, {"sid2"}}}},
+    {"Received", "kill", "^Received KILL message for ([^! ]+)!([^@ ]+)@(%S+)%. From (%S+) Path: %S+ %((.*)%)$",
+     {{{"nick"}, {"user"}, {"host"}, {"from"}, {"reason"}}}},
+    {"Received", "kill", "^Received KILL message for ([^! ]+)!([^@ ]+)@(%S+)%. From (%S+) %((.*)%)$",
+     {{{"nick"}, {"user"}, {"host"}, {"from"}, {"reason"}}}},
+    {"New", "newmaxlocal", "^New Max Local Clients: (%d+)$",
+     {{{"clients", Conv::integer}}}},
+    {"Possible", "flooder", "^Possible Flooder (%S+)%[([^@ ]+)@(%S+)%] on %S+ target: (%S+)$",
+     {{{"nick"}, {"user"}, {"host"}, {"target"}}}},
+    {"User", "spambot", "^User (%S+) %(([^@ ]+)@(%S*)%) trying to join (%S+) is a possible spambot$",
+     {{{"nick"}, {"user"}, {"host"}, {"target"}}}},
+    {"Excessive", "targetchange", "^Excessive target change from (%S+) %(([^@ ]+)@(.*)%)$",
+     {{{"nick"}, {"user"}, {"host"}}}},
+    {"", "create_channel", "^(%S+) is creating new channel (%S+)$",
+     {{{"nick"}, {"channel"}}}},
+    {"OPERSPY", "operspy", "^OPERSPY ([^! ]+)!([^@ ]+)@([^{ ]+){([^} ]*)} (%S+) (.*)$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}, {"token"}, {"arg"}}}},
+    {"", "override", "^([^! ]+)!([^@ ]+)@([^{]+){([^}]*)} is using oper%-override on (%S+) %((.*)%)$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}, {"target"}, {"kind"}}}},
+    {"Too", "toomany", "^Too many (%S+) connections for ([^! ]+)!([^@ ]+)@(%S+)$",
+     {{{"kind"}, {"nick"}, {"user"}, {"host"}}}},
+    {"Too", "toomany", "^Too many (%S+) connections for (%S+)%[([^@ ]+)@(%S+)%] %[(.*)%]$",
+     {{{"kind"}, {"nick"}, {"user"}, {"host"}, ip}}},
+    {"Warning:", "badlogin", "^Warning: \x02([^\x02]+)\x02 failed login attempts to \x02([^\x02]+)\x02%. Last attempt received from \x02<Unknown user on %S+ %(via SASL%):([^\x02]+)>\x02",
+     {{{"count", Conv::integer}, {"account"}, {"host"}}}},
+    {"Warning:", "badlogin", "^Warning: \x02([^\x02]+)\x02 failed login attempts to \x02([^\x02]+)\x02%. Last attempt received from \x02([^!]+)!([^@]+)@([^\x02]+)\x02",
+     {{{"count", Conv::integer}, {"account"}, {"nick"}, {"user"}, {"host"}}}},
+    {"", "oper", "^(%S+) %(([^@ ]*)@(%S*)%) is now an operator$",
+     {{{"nick"}, {"user"}, {"host"}}}},
+    {"", "grant", "^([^! ]+)!([^@ ]+)@([^{]+){([^}]*)} is opering (%S+) with privilege set (%S+)$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}, {"target"}, {"privset"}}}},
+    {"", "grant", "^([^! ]+)!([^@ ]+)@([^{]+){([^}]*)} is changing the privilege set of (%S+) to (%S+)$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}, {"target"}, {"privset"}}}},
+    {"", "ungrant", "^([^! ]+)!([^@ ]+)@([^{]+){([^}]*)} is deopering (%S+)%.$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}, {"target"}}}},
+    // Previous connect format, useful for oftc-hybrid
+    {"Client", "connect", "^Client connecting: (%S+) %(([^@ ]+)@(%S+)%) %[(%S*)%] {(%S*)} %[(.*)%]$",
+     {{{"nick"}, {"user"}, {"host"}, ip, {"class"}, {"gecos"}}}},
+    {"Module", "modload", "^Module ([^ ]+) %[.*%] loaded at [^ ]+$",
+     {{{"module"}}}},
+    {"Module", "modunload", "^Module ([^ ]+) unloaded$",
+     {{{"module"}}}},
+    {"", "shedding_on", "^([^!]+)!([^@]+)@([^{]+){([^}]*)} enabled user shedding %(interval: ([0-9]+) seconds, reason: (.*)%)$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}, {"interval", Conv::integer}, {"reason"}}}},
+    {"", "shedding_off", "^([^!]+)!([^@]+)@([^{]+){([^}]*)} disabled user shedding$",
+     {{{"nick"}, {"user"}, {"host"}, {"oper"}}}},
+};
+
+// Notices matched exactly, after every rule
+std::unordered_map<std::string_view, std::string_view> const simple{
+    {"Filtering enabled.", "filtering_enabled"},
+    {"Filtering disabled.", "filtering_disabled"},
+    {"New filters loaded.", "filtering_loaded"},
+    {"Got signal SIGUSR1, reloading ircd motd file", "rehash_motd"},
+    {"Got signal SIGHUP, reloading ircd conf. file", "rehash_config"},
+};
+
+std::unordered_map<std::string_view, std::string_view> const line_kinds{
+    {"K-Line", "kline"},
+    {"X-Line", "xline"},
+    {"D-Line", "dline"},
+    {"RESV", "resv"},
+};
+
+/**
+ * @brief Candidate rules for each first word, in priority order
+ *
+ * Rules with a variable first word are included in every list.
+ */
+struct Dispatch
+{
+    std::unordered_map<std::string_view, std::vector<Rule const*>> by_word;
+    std::vector<Rule const*> variable;
+
+    Dispatch()
+    {
+        for (auto const& rule : rules)
+        {
+            if (rule.word.empty())
+            {
+                variable.push_back(&rule);
+            }
+            else if (not by_word.contains(rule.word))
+            {
+                auto& candidates = by_word[rule.word];
+                for (auto const& other : rules)
+                {
+                    if (other.word.empty() || other.word == rule.word)
+                    {
+                        candidates.push_back(&other);
+                    }
+                }
+            }
+        }
+    }
+
+    auto candidates(std::string_view const str) const -> std::vector<Rule const*> const&
+    {
+        auto const it = by_word.find(str.substr(0, str.find(' ')));
+        return it == by_word.end() ? variable : it->second;
+    }
+};
+
+auto to_integer(std::string_view const str) -> std::optional<std::int64_t>
+{
+    std::int64_t n;
+    auto const end = str.data() + str.size();
+    auto const [ptr, ec] = std::from_chars(str.data(), end, n);
+    if (ec != std::errc{} || ptr != end)
+    {
+        return std::nullopt;
+    }
+    return n;
+}
+
+auto apply(Rule const& rule, Matcher const& captures, snote::Event& event) -> bool
+{
+    event.name = rule.name;
+    event.size = 0;
+
+    std::size_t next = 0;
+    for (auto const& spec : rule.fields)
+    {
+        if (spec.key.empty() && spec.conv != Conv::line_kind)
+        {
+            break;
+        }
+
+        if (spec.conv == Conv::literal)
+        {
+            event.fields[event.size++] = {spec.key, spec.literal};
+            continue;
+        }
+
+        auto const capture = captures[next++];
+        switch (spec.conv)
+        {
+        case Conv::literal:
+        case Conv::str:
+            event.fields[event.size++] = {spec.key, capture};
+            break;
+        case Conv::ip:
+            if (capture != "0")
+            {
+                event.fields[event.size++] = {spec.key, capture};
+            }
+            break;
+        case Conv::integer:
+            if (auto const n = to_integer(capture))
+            {
+                event.fields[event.size++] = {spec.key, *n};
+            }
+            break;
+        case Conv::lower: {
+            std::string lower{capture};
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char const c) { return std::tolower(c); });
+            event.fields[event.size++] = {spec.key, std::move(lower)};
+            break;
+        }
+        case Conv::line_kind: {
+            auto const it = line_kinds.find(capture);
+            if (it == line_kinds.end())
+            {
+                return false;
+            }
+            event.name = it->second;
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+namespace snote {
+
+auto parse(std::string_view const str) -> std::optional<Event>
+{
+    static Dispatch const dispatch;
+
+    Matcher matcher;
+    Event event;
+    for (auto const rule : dispatch.candidates(str))
+    {
+        if (matcher(rule->pattern, str) && apply(*rule, matcher, event))
+        {
+            return event;
+        }
+    }
+
+    if (auto const it = simple.find(str); it != simple.end())
+    {
+        event.name = it->second;
+        return event;
+    }
+
+    return std::nullopt;
+}
+
+} // namespace snote
@@ -0,0 +1,80 @@
+#pragma once
+/**
+ * @file snote.hpp
+ * @author Eric Mertens (emertens@gmail.com)
+ * @brief Classification of server notices into events
+ *
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+struct lua_State;
+
+namespace snote {
+
+/**
+ * @brief Field value: a slice of the notice, an integer, or a rewritten string
+ */
+using Value = std::variant<std::string_view, std::int64_t, std::string>;
+
+struct Field
+{
+    std::string_view key;
+    Value value;
+};
+
+/**
+ * @brief Classified server notice
+ *
+ * String fields refer into the notice text that was parsed.
+ */
+struct Event
+{
+    static constexpr std::size_t max_fields = 8;
+
+    std::string_view name;
+    std::array<Field, max_fields> fields;
+    std::size_t size = 0;
+
+    auto begin() const -> Field const*
+    {
+        return fields.data();
+    }
+
+    auto end() const -> Field const*
+    {
+        return fields.data() + size;
+    }
+};
+
+/**
+ * @brief Classify a server notice
+ *
+ * Notices are dispatched on their first word to the few rules that can
+ * match it. Each rule is a Lua-compatible pattern so the result is the
+ * same as trying every rule in order with string.match.
+ *
+ * @param str Server notice text without the server prefix
+ * @return Classified event or nullopt when no rule matches
+ */
+auto parse(std::string_view str) -> std::optional<Event>;
+
+} // namespace snote
+
+/**
+ * @brief Classify a server notice
+ *
+ * Lua arguments: time, server, str
+ * Returns a table with name, server, time, and the fields of the event,
+ * or nil when the notice is not recognized.
+ *
+ * @param L Lua state
+ * @return 1
+ */
+auto l_parse_snote(lua_State* L) -> int;
@@ -0,0 +1,46 @@
+#include "snote.hpp"
+
+#include "strings.hpp"
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+#include <type_traits>
+
+auto l_parse_snote(lua_State* const L) -> int
+{
+    auto const str = check_string_view(L, 3);
+    auto const event = snote::parse(str);
+    if (not event)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_createtable(L, 0, 3 + static_cast<int>(event->size));
+    push_string(L, event->name);
+    lua_setfield(L, -2, "name");
+    lua_pushvalue(L, 2);
+    lua_setfield(L, -2, "server");
+    lua_pushvalue(L, 1);
+    lua_setfield(L, -2, "time");
+
+    for (auto const& field : *event)
+    {
+        push_string(L, field.key);
+        std::visit([L](auto const& value) {
+            if constexpr (std::is_same_v<std::int64_t const&, decltype(value)>)
+            {
+                lua_pushinteger(L, value);
+            }
+            else
+            {
+                push_string(L, value);
+            }
+        }, field.value);
+        lua_rawset(L, -3);
+    }
+    return 1;
+}
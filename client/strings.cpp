@@ -21,3 +21,37 @@ auto check_string_view(lua_State* L, int arg) -> std::string_view
     auto const str = luaL_checklstring(L, arg, &len);
     return {str, len};
 }
+
+auto opt_integer_field(lua_State* const L, int const arg, char const* const key, lua_Integer const def) -> lua_Integer
+{
+    if (lua_isnoneornil(L, arg))
+    {
+        return def;
+    }
+    luaL_checktype(L, arg, LUA_TTABLE);
+    lua_Integer result = def;
+    int isnum = 1;
+    if (LUA_TNIL != lua_getfield(L, arg, key))
+    {
+        result = lua_tointegerx(L, -1, &isnum);
+    }
+    lua_pop(L, 1);
+    if (not isnum)
+    {
+        luaL_error(L, "option %s: integer expected", key);
+    }
+    return result;
+}
+
+auto opt_boolean_field(lua_State* const L, int const arg, char const* const key) -> bool
+{
+    if (lua_isnoneornil(L, arg))
+    {
+        return false;
+    }
+    luaL_checktype(L, arg, LUA_TTABLE);
+    lua_getfield(L, arg, key);
+    auto const result = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    return result;
+}
@@ -29,3 +29,24 @@ inline auto push_string(lua_State* const L, std::string_view const str) -> char
 auto mutable_string_arg(lua_State* L, int i) -> char*;
 
 auto check_string_view(lua_State* L, int arg) -> std::string_view;
+
+/**
+ * @brief Look up an optional integer field of an optional options table
+ *
+ * @param L Lua state
+ * @param arg Argument index of the options table
+ * @param key Field name
+ * @param def Default when the table or the field is absent
+ * @return field value
+ */
+auto opt_integer_field(lua_State* L, int arg, char const* key, lua_Integer def) -> lua_Integer;
+
+/**
+ * @brief Look up an optional boolean field of an optional options table
+ *
+ * @param L Lua state
+ * @param arg Argument index of the options table
+ * @param key Field name
+ * @return field value, false when the table or the field is absent
+ */
+auto opt_boolean_field(lua_State* L, int arg, char const* key) -> bool;
@@ -1,6 +1,7 @@
 #include "timer.hpp"
 
 #include "app.hpp"
+#include "metrics.hpp"
 #include "safecall.hpp"
 #include "userdata.hpp"
 
@@ -53,6 +54,9 @@ luaL_Reg const Methods[]{
          timer->expires_after(std::chrono::milliseconds{start});
          timer->async_wait([L = app->get_lua(), timer](auto const error) {
             if (not error) {
+                static auto& fired = metrics::counter("snowcone_timer_fired_total", "Timers that expired and ran their callback");
+                fired.add();
+
                 // get the callback
                 lua_rawgetp(L, LUA_REGISTRYINDEX, timer);
                 // forget the callback
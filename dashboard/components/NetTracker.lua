@@ -3,38 +3,45 @@ local class = require 'pl.class'
 local M = class()
 M._name = 'NetTracker'
 
-local MaskTracker = require_ 'components.MaskTracker'
-
+-- Counting is done by a native longest-prefix-match trie. masks keeps
+-- the network of each label for display and ordering.
 function M:_init()
     self.masks = {}
+    self.trie = snowcone.new_prefix_trie()
 end
 
 function M:track(label, address, prefix)
-    self.masks[label] = MaskTracker(address, prefix)
+    self.trie:insert(label, address, prefix)
+    self.masks[label] = {address = address, prefix = prefix}
+
+    -- a network tracked under an old label now belongs to this one
+    for other in pairs(self.masks) do
+        if not self.trie:get(other) then
+            self.masks[other] = nil
+        end
+    end
+end
+
+function M:untrack(label)
+    self.trie:remove(label)
+    self.masks[label] = nil
 end
 
+-- Accepts a label and count or a table mapping labels to counts
 function M:set(label, count)
-    local mask = self.masks[label]
-    if mask then
-        mask.count = count
-    end
+    self.trie:set(label, count)
+end
+
+function M:get(label)
+    return self.trie:get(label)
 end
 
 function M:delta(address, i)
-    for _, mask in pairs(self.masks) do
-        if mask:match(address) then
-            mask:delta(i)
-            return
-        end
-    end
+    return self.trie:delta(address, i)
 end
 
 function M:count()
-    local n = 0
-    for _, mask in pairs(self.masks) do
-        n = n + mask.count
-    end
-    return n
+    return self.trie:total()
 end
 
 return M
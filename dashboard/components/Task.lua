@@ -39,4 +39,34 @@ function M:execute(command, args, input)
     return coroutine.yield()
 end
 
+-- Worker pool callbacks don't resume tasks that were cancelled meanwhile
+local function resumer(self)
+    return function(...)
+        if not self:complete() then
+            self:resume(...)
+        end
+    end
+end
+
+--- Derive a key with PBKDF2 on the worker pool
+---@return string | nil key, string | nil error
+function M:pbkdf2(digest, password, salt, iterations, keylen)
+    snowcone.pbkdf2(digest, password, salt, iterations, keylen, resumer(self))
+    return coroutine.yield()
+end
+
+--- Sign data with a private key on the worker pool
+---@return string | nil signature, string | nil error
+function M:sign(key, data)
+    snowcone.pkey_sign(key, data, resumer(self))
+    return coroutine.yield()
+end
+
+--- Decrypt data with a private key on the worker pool
+---@return string | nil plaintext, string | nil error
+function M:decrypt(key, data, format)
+    snowcone.pkey_decrypt(key, data, format, resumer(self))
+    return coroutine.yield()
+end
+
 return M
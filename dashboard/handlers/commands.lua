@@ -10,6 +10,7 @@ local Task = require 'components.Task'
 local utils_time = require 'utils.time'
 local N = require 'utils.numerics'
 local matching = require 'utils.matching'
+local watch_scan = require 'utils.watch_scan'
 local configuration_tools = require 'utils.configuration_tools'
 
 local colormap =
@@ -165,6 +166,7 @@ add_command('addwatch', '$r', function(args)
         watch.hits = 0
 
         table.insert(watches, watch)
+        watch_scan.changed()
         status('addwatch', 'Added watch #%d', #watches)
 
     -- Updating an old watch
@@ -172,6 +174,7 @@ add_command('addwatch', '$r', function(args)
         local previous = watches[id]
         if previous then
             tablex.update(previous, watch)
+            watch_scan.changed()
             status('addwatch', 'Updated watch #%d', id)
         else
             status('addwatch', 'So such watch')
@@ -182,6 +185,7 @@ end)
 add_command('delwatch', '$i', function(i)
     if watches[i] then
         table.remove(watches, i)
+        watch_scan.changed()
     elseif i == nil then
         status('delwatch', 'delwatch requires integer argument')
     else
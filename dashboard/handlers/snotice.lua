@@ -5,7 +5,7 @@ local send = require 'utils.send'
 local Set = require 'pl.Set'
 local N = require 'utils.numerics'
 local Task = require 'components.Task'
-local matching = require 'utils.matching'
+local watch_scan = require 'utils.watch_scan'
 
 local function count_ip(address, delta)
     if next(net_trackers) then
@@ -56,20 +56,22 @@ function M.connect(ev)
         population[ev.server] = pop + 1
     end
 
-    local safematch = matching.safematch
-    for _, watch in ipairs(watches) do
-        if watch.active then
-            if
-                safematch(entry.mask, watch.regexp) or
-                entry.org and safematch(entry.org, watch.regexp) or
-                entry.asn and safematch('AS'..entry.asn, watch.regexp) or
-                entry.account and safematch(entry.account, watch.regexp) or
-                entry.ip  and safematch(ev.nick .. '!' .. ev.user .. '@' .. ev.ip .. '#' .. ev.gecos, watch.regexp)
-            then
-                watch.hits = watch.hits + 1
-                entry.mark = watch.color or ncurses.COLOR_RED
-                if watch.beep  then ncurses.beep () end
-                if watch.flash then ncurses.flash() end
+    if next(watches) then
+        local strs = {entry.mask}
+        if entry.org then table.insert(strs, entry.org) end
+        if entry.asn then table.insert(strs, 'AS' .. entry.asn) end
+        if entry.account then table.insert(strs, entry.account) end
+        if entry.ip then table.insert(strs, ev.nick .. '!' .. ev.user .. '@' .. ev.ip .. '#' .. ev.gecos) end
+
+        local hits = watch_scan.match(strs)
+        if next(hits) then
+            for i, watch in ipairs(watches) do
+                if hits[i] then
+                    watch.hits = watch.hits + 1
+                    entry.mark = watch.color or ncurses.COLOR_RED
+                    if watch.beep  then ncurses.beep () end
+                    if watch.flash then ncurses.flash() end
+                end
             end
         end
     end
@@ -5,7 +5,6 @@ local pretty = require 'pl.pretty'
 local path   = require 'pl.path'
 local file   = require 'pl.file'
 local app    = require 'pl.app'
-local rex    = require 'rex_pcre2'
 
 if not uptime then
     require 'pl.stringx'.import()
@@ -48,6 +47,7 @@ local Editor             = require_ 'components.Editor'
 local LoadTracker        = require_ 'components.LoadTracker'
 local OrderedMap         = require_ 'components.OrderedMap'
 local libera_masks       = require_ 'utils.libera_masks'
+local matching           = require 'utils.matching'
 local addircstr          = require_ 'utils.irc_formatting'
 local drawing            = require_ 'utils.drawing'
 local utils_time         = require_ 'utils.time'
@@ -135,10 +135,12 @@ function reset_filter()
     staged_action = nil
 end
 
+local recent_connections = configuration.recent_connections or 1000
+
 local defaults = {
     -- state
-    users = OrderedMap(1000, snowcone.irccase),
-    exits = OrderedMap(1000, snowcone.irccase),
+    users = OrderedMap(recent_connections, snowcone.irccase),
+    exits = OrderedMap(recent_connections, snowcone.irccase),
     messages = OrderedMap(1000),
     status_messages = OrderedMap(100),
     klines = OrderedMap(1000),
@@ -186,6 +188,13 @@ for k,v in pairs(defaults) do
     end
 end
 
+-- Apply a changed history size on reload without losing entries
+for _, map in ipairs {users, exits} do
+    if map.max ~= recent_connections then
+        map:resize(recent_connections)
+    end
+end
+
 -- Prepopulate the server list
 for server, _ in pairs(servers.servers or {}) do
     conn_tracker:track(server, 0)
@@ -331,7 +340,7 @@ function draw_global_load(title, tracker)
             addstr(' ')
         end
 
-        if input_mode == 'filter' and not pcall(rex.new, editor:content()) then
+        if input_mode == 'filter' and not matching.compile(editor:content()) then
             red()
         end
 
@@ -559,11 +568,7 @@ function prev_view()
     end
 end
 
-function draw()
-    if draw_suspend ~= 'no' then
-        draw_suspend = 'suspended'
-        return
-    end
+local function draw_now()
     clicks = {}
     ncurses.erase()
     normal()
@@ -571,6 +576,11 @@ function draw()
     ncurses.refresh()
 end
 
+-- The client coalesces requests and renders through M.on_redraw
+function draw()
+    snowcone.request_redraw()
+end
+
 -- Network Tracker Logic ==============================================
 
 function add_network_tracker(name, mask)
@@ -618,17 +628,25 @@ end
 -- Timers =============================================================
 
 local function refresh_rotations()
-    for label, entry in pairs(servers.regions or {}) do
-        -- luacheck: ignore 231
-        local query
-        query = snowcone.dnslookup(entry.hostname, function(addrs, reason)
-            query = nil
-            mrs[label] = Set(addrs)
+    local regions = servers.regions or {}
+    local hostnames = {}
+    for _, entry in pairs(regions) do
+        table.insert(hostnames, entry.hostname)
+    end
+    if not next(hostnames) then return end
+
+    -- luacheck: ignore 231
+    local query
+    query = snowcone.dnsbatch(hostnames, function(addrs, reasons)
+        query = nil
+        for label, entry in pairs(regions) do
+            mrs[label] = Set(addrs[entry.hostname])
+            local reason = reasons[entry.hostname]
             if reason then
                 status('dns', '%s: %s', entry.hostname, reason)
             end
-        end)
-    end
+        end
+    end)
 end
 
 if not rotations_timer then
@@ -663,6 +681,25 @@ if not tick_timer then
     tick_timer:start(1000, cb)
 end
 
+if configuration.frame_interval then
+    snowcone.set_frame_interval(configuration.frame_interval)
+end
+
+if configuration.dns then
+    snowcone.set_dns_options(configuration.dns)
+end
+
+if configuration.tls_session_cache then
+    local ok, err = snowcone.set_tls_session_file(path.join(config_dir, 'tls_sessions'))
+    if not ok then
+        status('tls', 'TLS session cache unavailable: %s', err)
+    end
+end
+
+if configuration.metrics_socket and not metrics_server then
+    metrics_server = assert(snowcone.serve_metrics(configuration.metrics_socket))
+end
+
 function quit(msg)
     if rotations_timer then
         rotations_timer:cancel()
@@ -676,6 +713,10 @@ function quit(msg)
         reconnect_timer:cancel()
         reconnect_timer = nil
     end
+    if metrics_server then
+        metrics_server:close()
+        metrics_server = nil
+    end
     if conn then
         exiting = true
         disconnect(msg)
@@ -768,6 +809,22 @@ function irc_event.MSG(irc)
     end
 end
 
+-- All messages from a single socket read; an error in one message
+-- doesn't stop the rest
+function irc_event.MSGS(msgs)
+    for _, irc in ipairs(msgs) do
+        local success, message = pcall(irc_event.MSG, irc)
+        if not success then
+            status('irc', 'irc message error: %s', message)
+        end
+    end
+end
+
+-- The outgoing queue fell back to its low-water mark after a send
+-- reported backpressure; nothing here needs to resume
+function irc_event.DRAIN()
+end
+
 local function on_irc(event, irc)
     irc_event[event](irc)
 end
@@ -839,6 +896,14 @@ function M.on_resize()
     draw()
 end
 
+function M.on_redraw()
+    if draw_suspend ~= 'no' then
+        draw_suspend = 'suspended'
+        return
+    end
+    snowcone.measure('draw', draw_now)
+end
+
 snowcone.setmodule(function(ev, ...)
     M[ev](...)
 end)
@@ -912,7 +977,13 @@ function connect()
         configuration.socks_port,
         configuration.socks_username,
         socks_password,
-        on_irc)
+        on_irc,
+        {
+            buffer_limit = configuration.irc_buffer_limit,
+            batch = true,
+            flood_burst = configuration.flood_burst,
+            flood_interval = configuration.flood_interval,
+        })
     if conn_ then
         status('irc', 'connecting')
         conn = conn_
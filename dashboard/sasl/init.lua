@@ -125,6 +125,10 @@ return function(task, credentials)
                 local payload = table.concat(chunks)
                 chunks = {} -- prepare for next message
                 local success, message, secret = coroutine.resume(impl, payload)
+                -- Mechanisms yield a function to run slow work on this task
+                while success and type(message) == 'function' do
+                    success, message, secret = coroutine.resume(impl, message(task))
+                end
                 if success then
                     if message then
                         send_authenticate(message, secret)
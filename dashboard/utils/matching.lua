@@ -5,10 +5,20 @@ local M = {}
 local cached_pat
 local cached_obj
 
+-- Patterns without uppercase letters match caselessly
+local function case_flag(pat)
+    if not pat:find '%u' then
+        return 'i'
+    end
+end
+
 function M.compile(pat)
-    local insensitive = not pat:find '%u'
-    local flag
-    if insensitive then flag = 'i' end
+    local flag = case_flag(pat)
+
+    -- mypcre2 caches compiled patterns natively when it is available
+    if mypcre2 then
+        return (mypcre2.compile(pat, flag))
+    end
 
     local success, output = pcall(rex.new, pat, flag)
     if success then
@@ -18,6 +28,12 @@ end
 
 function M.safematch(str, pat)
 
+    if type(pat) == 'string' and mypcre2 then
+        -- match returns false on no match and nil for invalid patterns,
+        -- which match everything just like below
+        return mypcre2.match(str, pat, case_flag(pat)) ~= false
+    end
+
     if type(pat) == 'string' then
         if pat ~= cached_pat then
             local output = M.compile(pat)
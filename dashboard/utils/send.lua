@@ -1,3 +1,10 @@
+-- Flood control scheduling class by command, defaulting to normal
+local priorities <const> = {
+    PONG = 'high',
+    SETFILTER = 'bulk',
+    TESTMASK = 'bulk',
+}
+
 return function(cmd, ...)
 
     if not conn then
@@ -51,7 +58,7 @@ return function(cmd, ...)
         error('message too long: ' .. #raw, 2)
     end
 
-    conn:send(raw)
+    conn:send(raw, priorities[cmd])
 
     messages:insert(true, msg)
 end
@@ -0,0 +1,89 @@
+-- Match strings against every active watch at once
+--
+-- Active watches are compiled into a single Hyperscan database when the
+-- hsfilter module is available. Watches Hyperscan cannot compile, or all
+-- watches when hsfilter is missing, are matched one at a time with PCRE.
+local matching = require 'utils.matching'
+
+local M = {}
+
+local scanner
+local fallback = {}
+
+-- Bumped by every edit to the watch list; the scanner is rebuilt when it
+-- was compiled for an older generation or a different watches table.
+local generation = 0
+local built_generation
+local built_watches
+
+function M.changed()
+    generation = generation + 1
+end
+
+local function rebuild()
+    if scanner then scanner:close() end
+    scanner = nil
+    fallback = {}
+    built_generation = generation
+    built_watches = watches
+
+    local exprs, flags, ids = {}, {}, {}
+    for i, watch in ipairs(watches) do
+        if watch.active then
+            if hsfilter then
+                table.insert(exprs, watch.mask)
+                -- same case rule as matching.compile
+                table.insert(flags, watch.mask:find '%u' and 0 or hsfilter.flags.HS_FLAG_CASELESS)
+                table.insert(ids, i)
+            else
+                table.insert(fallback, i)
+            end
+        end
+    end
+
+    while exprs[1] do
+        local result, _, index = hsfilter.new_scanner(exprs, flags, ids)
+        if result then
+            scanner = result
+            break
+        elseif index then
+            table.insert(fallback, table.remove(ids, index))
+            table.remove(exprs, index)
+            table.remove(flags, index)
+        else
+            for _, i in ipairs(ids) do
+                table.insert(fallback, i)
+            end
+            break
+        end
+    end
+end
+
+-- Returns the set of watch indexes matching any of the given strings
+function M.match(strs)
+    if built_generation ~= generation or built_watches ~= watches then
+        rebuild()
+    end
+
+    local hits = {}
+    if scanner then
+        for _, str in ipairs(strs) do
+            scanner:scan(str, hits)
+        end
+    end
+
+    local safematch = matching.safematch
+    for _, i in ipairs(fallback) do
+        local regexp = watches[i].regexp
+        for _, str in ipairs(strs) do
+            if safematch(str, regexp) then
+                hits[i] = true
+                break
+            end
+        end
+    end
+
+    return hits
+end
+
+return M
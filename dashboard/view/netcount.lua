@@ -1,5 +1,6 @@
 local tablex = require 'pl.tablex'
 local drawing = require 'utils.drawing'
+local watch_scan = require 'utils.watch_scan'
 
 local M = {
     title = 'netcount',
@@ -37,10 +38,10 @@ local function sortpairs(t, f)
 end
 
 local function ordermask(v1, v2)
-    return v1.addrlen < v2.addrlen
-        or v1.addrlen == v2.addrlen
-       and (v1.network < v2.network
-        or v1.network == v2.network and v1.tailbyte < v2.tailbyte)
+    return #v1.address < #v2.address
+        or #v1.address == #v2.address
+       and (v1.address < v2.address
+        or v1.address == v2.address and v1.prefix < v2.prefix)
 end
 
 local function toggle(watch, field, on, off)
@@ -49,11 +50,13 @@ local function toggle(watch, field, on, off)
         green()
         add_button(on, function()
             watch[field] = nil
+            watch_scan.changed()
         end)
     else
         yellow()
         add_button(off, function()
             watch[field] = true
+            watch_scan.changed()
         end)
     end
 end
@@ -80,15 +83,15 @@ function M:render()
         if tracker.expanded then
             yellow()
             add_button('(-)', function() tracker.expanded = nil end)
-            for label, entry in sortpairs(tracker.masks, ordermask) do
+            for label in sortpairs(tracker.masks, ordermask) do
                 y = y + 1
                 if y+1 >= tty_height then break end
                 blue()
-                render_entry(y, label, entry.count, true)
+                render_entry(y, label, tracker:get(label), true)
 
                 red()
                 add_button('(x)', function()
-                    tracker.masks[label] = nil
+                    tracker:untrack(label)
                 end)
             end
         else
@@ -114,6 +117,7 @@ function M:render()
         red()
         add_button('(x)', function()
             table.remove(watches, i)
+            watch_scan.changed()
         end)
 
         toggle(watch, 'active', '(A)', '(a)')
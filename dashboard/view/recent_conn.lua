@@ -2,6 +2,17 @@ local addircstr = require 'utils.irc_formatting'
 local scrub = require 'utils.scrub'
 local drawing = require 'utils.drawing'
 
+local WA_NORMAL = ncurses.WA_NORMAL
+local WA_BOLD = ncurses.WA_BOLD
+local colorkey = ncurses.colorkey
+local default_color = colorkey()
+local black_color = colorkey(ncurses.COLOR_BLACK)
+local red_color = colorkey(ncurses.COLOR_RED)
+local green_color = colorkey(ncurses.COLOR_GREEN)
+local yellow_color = colorkey(ncurses.COLOR_YELLOW)
+local blue_color = colorkey(ncurses.COLOR_BLUE)
+local magenta_color = colorkey(ncurses.COLOR_MAGENTA)
+
 return function(data, label, tracker)
 
 local M = {
@@ -59,98 +70,102 @@ end
 
 function M:render()
     local rows = math.max(1, tty_height-2)
+
+    -- Runs of y, x, attributes, color, text drawn in a single call. The
+    -- account and gecos follow the server column and are drawn at the
+    -- cursor afterward because gecos carry mIRC formatting.
+    local runs, n = {}, 0
+    local function run(y, x, attr, color, str)
+        runs[n+1], runs[n+2], runs[n+3], runs[n+4], runs[n+5] = y, x, attr, color, str
+        n = n + 5
+    end
+    local tails, m = {}, 0
+
     drawing.draw_rotation(0, rows, data, show_entry, function(entry)
-        local y = ncurses.getyx()
-        local mask_color = entry.reason and ncurses.COLOR_RED or ncurses.COLOR_GREEN
+        local y, x = ncurses.getyx()
+        local mask_color = entry.reason and red_color or green_color
+        local color = default_color
 
         -- FILTERS and RECONNECT counter
+        local counter
         if entry.filters then
-            ncurses.colorset(mask_color)
-            addstr(string.format(' %3d!', entry.filters))
+            color = mask_color
+            counter = string.format(' %3d!', entry.filters)
         elseif entry.count then
-            if entry.count < 2 then
-                black()
-            else
-                normal()
-            end
-            addstr(string.format(" %4d", entry.count))
+            color = entry.count < 2 and black_color or default_color
+            counter = string.format(" %4d", entry.count)
+        end
+        if counter then
+            run(y, x, WA_NORMAL, color, counter)
+            x = x + #counter
         end
 
         if entry.mark then
-            if type(entry.mark) == 'number' then ncurses.colorset(entry.mark) end
-            add_button('◆', function() mark_filter = entry.mark end, true)
+            if type(entry.mark) == 'number' then color = colorkey(entry.mark) end
+            run(y, x, WA_NORMAL, color, '◆')
+            add_click(y, x, x + 1, function() mark_filter = entry.mark end)
         else
-            addstr(' ')
+            run(y, x, WA_NORMAL, color, ' ')
         end
 
         -- MASK
+        local mask_attr = WA_NORMAL
         if highlight and (
             highlight_plain     and highlight == entry.mask or
             not highlight_plain and string.match(entry.mask, highlight)) then
-                bold()
+                mask_attr = WA_BOLD
         end
 
-        ncurses.colorset(mask_color)
-        mvaddstr(y, 14, entry.nick)
-        black()
-        addstr('!')
-        ncurses.colorset(mask_color)
-        addstr(entry.user)
-        black()
-        addstr('@')
-        ncurses.colorset(mask_color)
+        run(y, 14, mask_attr, mask_color, entry.nick)
+        run(-1, -1, mask_attr, black_color, '!')
+        run(-1, -1, mask_attr, mask_color, entry.user)
+        run(-1, -1, mask_attr, black_color, '@')
         local maxwidth = 63 - #entry.nick - #entry.user
         if #entry.host <= maxwidth then
-            addstr(entry.host)
-            normal()
+            run(-1, -1, mask_attr, mask_color, entry.host)
         else
-            addstr(string.sub(entry.host, 1, maxwidth-1))
-            normal()
-            addstr('…')
+            run(-1, -1, mask_attr, mask_color, string.sub(entry.host, 1, maxwidth-1))
+            run(-1, -1, WA_NORMAL, default_color, '…')
         end
 
         -- IP or REASON
+        local reason_color
         if not entry.reason then
-            yellow()
+            reason_color = yellow_color
         elseif entry.reason == 'K-Lined' then
-            red()
+            reason_color = red_color
         else
-            magenta()
+            reason_color = magenta_color
         end
 
+        local detail
         if show_reasons == 'reason' and entry.reason then
-            mvaddstr(y, 80, string.sub(scrub(entry.reason), 1, 39))
+            detail = string.sub(scrub(entry.reason), 1, 39)
         elseif show_reasons == 'asn' and entry.asn then
-            mvaddstr(y, 80, string.format("AS%-6d %-30.30s", entry.asn, entry.org or ''))
+            detail = string.format("AS%-6d %-30.30s", entry.asn, entry.org or '')
         elseif show_reasons ~= 'ip' and entry.org then
-            mvaddstr(y, 80, string.sub(entry.org, 1, 39))
+            detail = string.sub(entry.org, 1, 39)
         elseif entry.ip then
-            mvaddstr(y, 80, entry.ip)
+            detail = entry.ip
         else
-            mvaddstr(y, 80, '·')
+            detail = '·'
         end
+        run(y, 80, WA_NORMAL, reason_color, detail)
 
         -- SERVER
-        blue()
         local alias = (servers.servers[entry.server] or {}).alias
+        local server
         if alias then
-            mvaddstr(y, 120, string.format('%-2.2s ', alias))
+            server = string.format('%-2.2s ', alias)
         else
-            mvaddstr(y, 120, string.format('%-3.3s ', entry.server))
+            server = string.format('%-3.3s ', entry.server)
         end
+        run(y, 120, WA_NORMAL, blue_color, server)
 
         -- GECOS or ACCOUNT
-        normal()
-        if entry.account == '*' then
-            cyan()
-            addstr('· ')
-        elseif entry.account then
-            cyan()
-            addstr(entry.account .. ' ')
-        end
-
-        if entry.gecos then
-            addircstr(entry.gecos)
+        if entry.account or entry.gecos then
+            tails[m+1], tails[m+2], tails[m+3] = y, 120 + #server, entry
+            m = m + 3
         end
 
         -- Click handlers
@@ -173,6 +188,28 @@ function M:render()
         end)
     end)
 
+    ncurses.drawlist(runs)
+
+    for i = 1, m, 3 do
+        local x, entry = tails[i+1], tails[i+2]
+        if x < tty_width then
+            ncurses.move(tails[i], x)
+            normal()
+            if entry.account == '*' then
+                cyan()
+                addstr('· ')
+            elseif entry.account then
+                cyan()
+                addstr(entry.account .. ' ')
+            end
+
+            if entry.gecos then
+                addircstr(entry.gecos)
+            end
+        end
+    end
+    normal()
+
     draw_buttons()
 
     draw_global_load(label, tracker)
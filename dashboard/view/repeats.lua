@@ -1,3 +1,8 @@
+local WA_NORMAL = ncurses.WA_NORMAL
+local default_color = ncurses.colorkey()
+local blue_color = ncurses.colorkey(ncurses.COLOR_BLUE)
+local yellow_color = ncurses.colorkey(ncurses.COLOR_YELLOW)
+
 local M = {
     title = 'repeats',
     keypress = function() end,
@@ -28,24 +33,29 @@ function M:render()
     local nicks = top_keys(nick_counts)
     local masks = top_keys(mask_counts)
 
+    -- Runs of y, x, attributes, color, text drawn in a single call
+    local runs, n = {}, 0
+    local function run(y, x, color, str)
+        runs[n+1], runs[n+2], runs[n+3], runs[n+4], runs[n+5] = y, x, WA_NORMAL, color, str
+        n = n + 5
+    end
+
     for i = 1, tty_height - 1 do
         local nick = nicks[i]
         if nick and nick[2] > 1 then
-            mvaddstr(i-1, 0,
-                string.format('%4d ', nick[2]))
-            blue()
-            addstr(string.format('%-16s', nick[1]))
-            normal()
+            run(i-1, 0, default_color, string.format('%4d ', nick[2]))
+            run(-1, -1, blue_color, string.format('%-16s', nick[1]))
         end
 
         local mask = masks[i]
         if mask then
-            mvaddstr(i-1, 22, string.format('%4d ', mask[2]))
-            yellow()
-            addstr(mask[1])
-            normal()
+            run(i-1, 22, default_color, string.format('%4d ', mask[2]))
+            run(-1, -1, yellow_color, mask[1])
         end
     end
+    ncurses.drawlist(runs)
+    normal()
+
     draw_global_load('cliconn', conn_tracker)
 end
 
@@ -9,7 +9,9 @@ extern "C"
 #include <hs.h>
 
 #include <exception>
+#include <new>
 #include <optional>
+#include <vector>
 
 namespace
 {
@@ -85,13 +87,21 @@ namespace
     return static_cast<T *>(lua_newuserdatauv(L, sizeof(T) * N, 0));
   }
 
-  auto l_serialize_regexp_db(lua_State *const L) -> int
+  struct Patterns
+  {
+    char const **exprs;
+    unsigned *flags;
+    unsigned *ids;
+    unsigned N;
+  };
+
+  // Reads the exprs, flags, and ids tables in arguments 1 to 3.
+  // The arrays are owned by userdata pushed onto the stack.
+  auto check_patterns(lua_State *const L) -> Patterns
   {
     luaL_checktype(L, 1, LUA_TTABLE);
     luaL_checktype(L, 2, LUA_TTABLE);
     luaL_checktype(L, 3, LUA_TTABLE);
-    auto const platform = lua_isnoneornil(L, 4) ? std::optional<hs_platform_info>{} : std::optional{get_platform(L, 4)};
-    lua_settop(L, 3);
 
     auto const N = luaL_len(L, 1);
 
@@ -124,7 +134,170 @@ namespace
       lua_pop(L, 3); // drops the expr, flag, id
     }
 
-    compile(L, exprs, flags, ids, N, platform ? &*platform : nullptr);
+    return {exprs, flags, ids, static_cast<unsigned>(N)};
+  }
+
+  auto l_serialize_regexp_db(lua_State *const L) -> int
+  {
+    auto const platform = lua_isnoneornil(L, 4) ? std::optional<hs_platform_info>{} : std::optional{get_platform(L, 4)};
+    lua_settop(L, 3);
+
+    auto const patterns = check_patterns(L);
+    compile(L, patterns.exprs, patterns.flags, patterns.ids, patterns.N, platform ? &*platform : nullptr);
+    return 1;
+  }
+
+  char const *const scanner_name = "hsfilter.scanner";
+
+  // A block-mode database compiled for this host along with the scratch
+  // space needed to scan it.
+  struct Scanner
+  {
+    hs_database_t *db;
+    hs_scratch_t *scratch;
+    std::vector<unsigned> hits; // reserved for one match per expression
+
+    auto close() -> void
+    {
+      if (scratch)
+      {
+        hs_free_scratch(scratch);
+        scratch = nullptr;
+      }
+      if (db)
+      {
+        hs_free_database(db);
+        db = nullptr;
+      }
+    }
+  };
+
+  auto on_scanner_match(unsigned int const id, unsigned long long, unsigned long long, unsigned int, void *const context) -> int
+  {
+    auto &hits = *static_cast<std::vector<unsigned> *>(context);
+    // never reallocate from inside hs_scan
+    if (hits.size() == hits.capacity())
+    {
+      return 1; // stop scanning
+    }
+    hits.push_back(id);
+    return 0;
+  }
+
+  auto l_scanner_scan(lua_State *const L) -> int
+  {
+    auto const scanner = static_cast<Scanner *>(luaL_checkudata(L, 1, scanner_name));
+    size_t len;
+    auto const str = luaL_checklstring(L, 2, &len);
+    if (lua_isnoneornil(L, 3))
+    {
+      lua_settop(L, 2);
+      lua_newtable(L);
+    }
+    else
+    {
+      luaL_checktype(L, 3, LUA_TTABLE);
+      lua_settop(L, 3);
+    }
+
+    if (nullptr == scanner->db)
+    {
+      luaL_error(L, "scanner closed");
+    }
+
+    scanner->hits.clear();
+    auto const result = hs_scan(scanner->db, str, len, 0, scanner->scratch, on_scanner_match, &scanner->hits);
+    if (HS_SUCCESS != result && HS_SCAN_TERMINATED != result)
+    {
+      luaL_error(L, "hs_scan(%d)", int{result});
+    }
+
+    for (auto const id : scanner->hits)
+    {
+      lua_pushboolean(L, 1);
+      lua_rawseti(L, 3, id);
+    }
+    return 1;
+  }
+
+  auto l_scanner_close(lua_State *const L) -> int
+  {
+    static_cast<Scanner *>(luaL_checkudata(L, 1, scanner_name))->close();
+    return 0;
+  }
+
+  auto l_scanner_gc(lua_State *const L) -> int
+  {
+    auto const scanner = static_cast<Scanner *>(luaL_checkudata(L, 1, scanner_name));
+    scanner->close();
+    scanner->~Scanner();
+    return 0;
+  }
+
+  luaL_Reg const ScannerMethods[]{
+      {"scan", l_scanner_scan},
+      {"close", l_scanner_close},
+      {},
+  };
+
+  auto l_new_scanner(lua_State *const L) -> int
+  {
+    lua_settop(L, 3);
+    auto const patterns = check_patterns(L);
+
+    auto const scanner = static_cast<Scanner *>(lua_newuserdatauv(L, sizeof(Scanner), 0));
+    new (scanner) Scanner{nullptr, nullptr, {}};
+    if (luaL_newmetatable(L, scanner_name))
+    {
+      lua_pushcfunction(L, l_scanner_gc);
+      lua_setfield(L, -2, "__gc");
+      luaL_newlib(L, ScannerMethods);
+      lua_setfield(L, -2, "__index");
+    }
+    lua_setmetatable(L, -2);
+    scanner->hits.reserve(patterns.N);
+
+    // Each id only needs to be reported once per scan
+    for (unsigned i = 0; i < patterns.N; i++)
+    {
+      patterns.flags[i] |= HS_FLAG_SINGLEMATCH;
+    }
+
+    hs_compile_error_t *error;
+    auto const compile_result = hs_compile_multi(
+        patterns.exprs, patterns.flags, patterns.ids, patterns.N,
+        HS_MODE_BLOCK, nullptr, &scanner->db, &error);
+    switch (compile_result)
+    {
+    case HS_SUCCESS:
+      break;
+    case HS_COMPILER_ERROR:
+      // Report the failing expression so the caller can drop it and retry
+      luaL_pushfail(L);
+      lua_pushstring(L, error->message);
+      if (error->expression < 0)
+      {
+        lua_pushnil(L);
+      }
+      else
+      {
+        lua_pushinteger(L, lua_Integer{error->expression} + 1);
+      }
+      if (HS_SUCCESS != hs_free_compile_error(error))
+      {
+        std::terminate();
+      }
+      return 3;
+    default:
+      luaL_error(L, "hs_compile_multi(%d)", int{compile_result});
+    }
+
+    auto const scratch_result = hs_alloc_scratch(scanner->db, &scanner->scratch);
+    if (HS_SUCCESS != scratch_result)
+    {
+      luaL_error(L, "hs_alloc_scratch(%d)", int{scratch_result});
+    }
+
     return 1;
   }
 
@@ -145,6 +318,7 @@ namespace
   luaL_Reg const M[]{
       {"serialize_regexp_db", l_serialize_regexp_db},
       {"get_current_platform", l_get_current_platform},
+      {"new_scanner", l_new_scanner},
       {},
   };
 
@@ -88,8 +88,8 @@ function M:_init(conn)
     end
 end
 
-function M:rawsend(str)
-    self.conn:send(str)
+function M:rawsend(str, priority)
+    self.conn:send(str, priority)
 end
 
 function M:close()
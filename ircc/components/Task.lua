@@ -36,7 +36,7 @@ function M:cancel_dnslookup()
     local h = self.dnslookup_handle
     if h then
         h:cancel()
-        self.h = nil
+        self.dnslookup_handle = nil
     end
 end
 
@@ -84,6 +84,14 @@ function M:dnslookup(name)
     return coroutine.yield()
 end
 
+function M:dnsreverse(address)
+    self.dnslookup_handle = snowcone.dnsreverse(address, function(...)
+        self.dnslookup_handle = nil
+        self:resume(...)
+    end)
+    return coroutine.yield()
+end
+
 --- Resume the Task with an IRC object or nil on timeout
 ---@param irc nil | table
 function M:resume_irc(irc)
@@ -111,4 +119,34 @@ function M:execute(command, args, input)
     return coroutine.yield()
 end
 
+-- Worker pool callbacks don't resume tasks that were cancelled meanwhile
+local function resumer(self)
+    return function(...)
+        if not self:is_complete() then
+            self:resume(...)
+        end
+    end
+end
+
+--- Derive a key with PBKDF2 on the worker pool
+---@return string | nil key, string | nil error
+function M:pbkdf2(digest, password, salt, iterations, keylen)
+    snowcone.pbkdf2(digest, password, salt, iterations, keylen, resumer(self))
+    return coroutine.yield()
+end
+
+--- Sign data with a private key on the worker pool
+---@return string | nil signature, string | nil error
+function M:sign(key, data)
+    snowcone.pkey_sign(key, data, resumer(self))
+    return coroutine.yield()
+end
+
+--- Decrypt data with a private key on the worker pool
+---@return string | nil plaintext, string | nil error
+function M:decrypt(key, data, format)
+    snowcone.pkey_decrypt(key, data, format, resumer(self))
+    return coroutine.yield()
+end
+
 return M
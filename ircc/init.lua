@@ -85,6 +85,9 @@ end
 -- Make windows ==================================================
 
 local function make_layout()
+    -- cached renderings are discarded whenever the layout changes
+    render_generation = (render_generation or 0) + 1
+
     if main_pad then
         main_pad:delwin()
     end
@@ -182,7 +185,7 @@ function prev_view()
     end
 end
 
-local function draw()
+local function draw_now()
     clicks = {}
     ncurses.erase()
     main_pad:werase()
@@ -205,6 +208,11 @@ local function draw()
     ncurses.doupdate()
 end
 
+-- The client coalesces requests and renders through M.on_redraw
+local function draw()
+    snowcone.request_redraw()
+end
+
 -- Callback Logic =====================================================
 
 local M = {}
@@ -275,6 +283,10 @@ function M.on_resize()
     draw()
 end
 
+function M.on_redraw()
+    snowcone.measure('draw', draw_now)
+end
+
 snowcone.setmodule(function(ev, ...)
     M[ev](...)
 end)
@@ -284,6 +296,10 @@ local function teardown()
         tick_timer:cancel()
         tick_timer = nil
     end
+    if metrics_server then
+        metrics_server:close()
+        metrics_server = nil
+    end
     snowcone.shutdown()
 end
 
@@ -375,7 +391,13 @@ function connect()
             socks_password,
             function(event, arg)
                 conn_handlers[event](arg)
-            end)
+            end,
+            {
+                buffer_limit = configuration.irc_buffer_limit,
+                batch = true,
+                flood_burst = configuration.flood_burst,
+                flood_interval = configuration.flood_interval,
+            })
 
         if conn then
             status('irc', 'connecting')
@@ -451,6 +473,23 @@ function conn_handlers.MSG(irc, flush)
     end
 end
 
+-- All messages from a single socket read, drawing after the last one;
+-- an error in one message doesn't stop the rest
+function conn_handlers.MSGS(msgs)
+    for _, irc in ipairs(msgs) do
+        local success, message = pcall(conn_handlers.MSG, irc, false)
+        if not success then
+            status('irc', 'irc message error: %s', message)
+        end
+    end
+    draw()
+end
+
+-- The outgoing queue fell back to its low-water mark after a send
+-- reported backpressure
+function conn_handlers.DRAIN()
+end
+
 function conn_handlers.CON(fingerprint)
     status('irc', 'connected: %s', fingerprint)
 
@@ -598,6 +637,25 @@ local function startup()
         tick_timer:start(1000, cb)
     end
 
+    if configuration.frame_interval then
+        snowcone.set_frame_interval(configuration.frame_interval)
+    end
+
+    if configuration.dns then
+        snowcone.set_dns_options(configuration.dns)
+    end
+
+    if configuration.tls_session_cache then
+        local ok, err = snowcone.set_tls_session_file(path.join(config_dir, 'tls_sessions'))
+        if not ok then
+            status('tls', 'TLS session cache unavailable: %s', err)
+        end
+    end
+
+    if configuration.metrics_socket and not metrics_server then
+        metrics_server = assert(snowcone.serve_metrics(configuration.metrics_socket))
+    end
+
     if mode_target == 'connected' and mode_current == 'idle' then
         connect()
     end
@@ -9,6 +9,9 @@ return function(authzid, authcid, key)
         if authzid then
             first = first .. '\0' .. authzid
         end
-        return key:sign(coroutine.yield(first))
+        local challenge = coroutine.yield(first)
+        return assert(coroutine.yield(function(task)
+            return task:sign(key, challenge)
+        end))
     end)
 end
@@ -61,7 +61,9 @@ return function(digest_name, authzid, authcid, password, nonce)
         iterations = assert(math.tointeger(iterations), 'bad iteration count')
         assert(iterations <= iteration_limit, 'server pbdkf2 iteration count too high')
 
-        local salted_password = digest:pbkdf2(password, salt, iterations, digest:size())
+        local salted_password = assert(coroutine.yield(function(task)
+            return task:pbkdf2(digest, password, salt, iterations, digest:size())
+        end))
         local client_key = digest:hmac('Client Key', salted_password)
         local server_key = digest:hmac('Server Key', salted_password)
         local stored_key = digest:digest(client_key)
@@ -6,8 +6,15 @@ local c2 = 'c=biws,r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,p=v0X8v3Bz2T0CJG
 local s2 = 'v=rmF9pqV8S7suAoZWja4dJRkFsKQ='
 local nonce = 'fyko+d2lbbFgONRv9qkxdawL'
 
+-- Key derivation is requested from the driving task; run it directly here
+local task = {}
+function task:pbkdf2(digest, ...) return digest:pbkdf2(...) end
+
 local function step(expect, co, input)
     local _, c = assert(coroutine.resume(co, input))
+    while type(c) == 'function' do
+        _, c = assert(coroutine.resume(co, c(task)))
+    end
     assert(expect == c)
 end
 
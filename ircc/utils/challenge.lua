@@ -49,7 +49,7 @@ return function(task)
 
     local input    <const> = table.concat(chunks)
     local envelope <const> = assert(snowcone.from_base64(input), 'bad base64')
-    local message  <const> = assert(key:decrypt(envelope, 'oaep'))
+    local message  <const> = assert(task:decrypt(key, envelope, 'oaep'))
     local digest   <const> = myopenssl.get_digest('sha1'):digest(message)
     local response <const> = snowcone.to_base64(digest)
 
@@ -52,9 +52,22 @@ return {
         tls_client_password = password_schema,
         tls_verify_host     = {type = 'string'},
         tls_sni_host        = {type = 'string'},
+        tls_session_cache   = {type = 'boolean'},
 
         fingerprint         = {type = 'string'},
 
+        irc_buffer_limit    = {type = 'number'},
+        flood_burst         = {type = 'number'},
+        flood_interval      = {type = 'number'},
+        metrics_socket      = {type = 'string'},
+        frame_interval      = {type = 'number'},
+        dns                 = {type = 'table', fields = {
+                                concurrency  = {type = 'number'},
+                                ttl          = {type = 'number'},
+                                negative_ttl = {type = 'number'},
+                                capacity     = {type = 'number'},
+                              }},
+
         passuser            = {type = 'string', pattern = '^[^\n\r\x00:]*$'},
         pass                = password_schema,
 
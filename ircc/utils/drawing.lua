@@ -56,25 +56,29 @@ local function rotating_window(source, rows, predicate)
         offset = 0
     end
 
-    if rows <= 0 then return {} end
+    if rows <= 0 then return {}, {} end
 
     local n = 0
     local window = {}
+    local numbers = {}
 
-    for entry in source:each(offset) do
+    for entry, _, number in source:each(offset) do
         if n+1 >= rows then break end -- saves a row for divider
         if not predicate or predicate(entry) then
-            window[(divider-1-n) % rows + 1] = entry
+            local i = (divider-1-n) % rows + 1
+            window[i] = entry
+            numbers[i] = number
             n = n + 1
         end
     end
 
     window[divider % rows + 1] = 'divider'
-    return window
+    return window, numbers
 end
 
+-- draw is called with the window, the entry, and its insertion number
 function M.draw_rotation(win, start, rows, data, show_entry, draw)
-    local window = rotating_window(data, rows, show_entry)
+    local window, numbers = rotating_window(data, rows, show_entry)
     local last_time
     for i = 1, rows do
         local entry = window[i]
@@ -94,7 +98,7 @@ function M.draw_rotation(win, start, rows, data, show_entry, draw)
                 M.fade_time(win, entry.timestamp or 0, entry.time)
             end
             normal(win)
-            draw(win, entry)
+            draw(win, entry, numbers[i])
         end
     end
 end
@@ -1,7 +1,22 @@
 local path = require 'pl.path'
+local mmdb_path = path.join(config_dir, 'GeoLite2-ASN.mmdb')
+
+-- Built-in reader; reopening after a reload picks up a replaced file
+if path.exists(mmdb_path) and snowcone.open_asn_db(mmdb_path) then
+    return function(addr)
+        local baddr = snowcone.pton(addr)
+        if baddr then
+            local org, asn = snowcone.asn_lookup(baddr)
+            if org then
+                return org, asn
+            end
+        end
+    end
+end
+
 local has_mmdb, mmdb = pcall(require, 'mmdb')
 if has_mmdb then
-    local success, geoip = pcall(mmdb.open, path.join(config_dir, 'GeoLite2-ASN.mmdb'))
+    local success, geoip = pcall(mmdb.open, mmdb_path)
     if success then
         return function(addr)
             local result
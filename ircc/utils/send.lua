@@ -1,3 +1,10 @@
+-- Flood control scheduling class by command, defaulting to normal
+local priorities <const> = {
+    PONG = 'high',
+    SETFILTER = 'bulk',
+    TESTMASK = 'bulk',
+}
+
 return function(cmd, ...)
 
     if not irc_state then
@@ -51,7 +58,7 @@ return function(cmd, ...)
         error('message too long: ' .. #raw, 2)
     end
 
-    irc_state:rawsend(raw)
+    irc_state:rawsend(raw, priorities[cmd])
 
     messages:insert(true, msg)
 
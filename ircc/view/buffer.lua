@@ -97,7 +97,8 @@ function command_renderer.CHGHOST(win, irc)
     win:waddstr(scrub(irc[1]), '@', scrub(irc[2]))
 end
 
-local function render_irc(win, irc)
+-- Draws the source column; it is not cached because it registers a click
+local function render_source(win, irc)
     local command = irc.command
     local source = irc.source:match '^(.-)([.!])' or irc.source
 
@@ -119,7 +120,9 @@ local function render_irc(win, irc)
         focus = {irc=irc}
         set_view 'console'
     end, true)
+end
 
+local function render_body(win, irc)
     local statusmsg = irc.statusmsg
     if statusmsg then
         red(win)
@@ -235,6 +238,23 @@ local function draw_messages(win, buffer)
 
     buffer:look()
 
+    -- Message bodies are drawn once and then copied from the line cache
+    local cache = buffer.line_cache
+    if not cache then
+        cache = ncurses.newlinecache()
+        buffer.line_cache = cache
+    end
+    cache:sync(render_generation, buffer.messages.epoch)
+
+    local function render_irc(win, irc, number)
+        render_source(win, irc)
+        if not cache:draw(number, win) then
+            local y, x = ncurses.getyx(win)
+            render_body(win, irc)
+            cache:store(number, win, y, x)
+        end
+    end
+
     drawing.draw_rotation(win, start, rows, buffer.messages, show_irc, render_irc)
 end
 
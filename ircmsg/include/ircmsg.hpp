@@ -74,6 +74,20 @@ struct irc_parse_error final : public std::exception {
  */
 auto parse_irc_message(char* msg) -> ircmsg;
 
+/**
+ * @brief Parse an IRC message in place into an existing message
+ *
+ * This behaves like the single argument version but reuses the
+ * storage already allocated by @p out. Parsing a stream of
+ * messages into the same object stops allocating once its
+ * vectors have grown to fit the largest message seen.
+ *
+ * @param msg null-terminated character buffer with raw IRC message.
+ * @param out message overwritten with the parse result
+ * @throw irc_parse_error on failure leaving @p out unspecified
+ */
+auto parse_irc_message(char* msg, ircmsg& out) -> void;
+
 /**
  * @brief Parse an IRC tags string in place
  *
@@ -86,3 +100,39 @@ auto parse_irc_message(char* msg) -> ircmsg;
  * @throw irc_parse_error on failure
  */
 auto parse_irc_tags(char* msg) -> std::vector<irctag>;
+
+/**
+ * @brief Parse an IRC tags string in place into an existing vector
+ *
+ * @param msg null-terminated character buffer with raw IRC tags.
+ * @param tags vector overwritten with the parsed tags
+ * @throw irc_parse_error on failure leaving @p tags unspecified
+ */
+auto parse_irc_tags(char* msg, std::vector<irctag>& tags) -> void;
+
+/**
+ * @brief Character scanning strategies available to the parser
+ *
+ * The fastest supported strategy is selected at startup. The others
+ * remain available so they can be compared against each other.
+ */
+enum class irc_scanner {
+    scalar,
+    sse2,
+    avx2,
+};
+
+/**
+ * @brief Select the character scanning strategy used by the parser
+ *
+ * @param scanner requested scanning strategy
+ * @return true if selected and false when not supported by this CPU
+ */
+auto set_irc_scanner(irc_scanner scanner) -> bool;
+
+/**
+ * @brief Get the currently selected character scanning strategy
+ *
+ * @return active scanning strategy
+ */
+auto get_irc_scanner() -> irc_scanner;
@@ -1,13 +1,133 @@
+#include <bit>
+#include <cstdint>
 #include <cstring>
 #include <optional>
+#include <string_view>
+#include <utility>
 
 #include "ircmsg.hpp"
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define IRCMSG_X86_SCANNER
+#include <immintrin.h>
+#endif
+
 namespace {
+
+/// @brief Find the first occurrence of either character
+/// @param str Start of the range to search
+/// @param end End of the range to search
+/// @param a First character to match
+/// @param b Second character to match
+/// @return Pointer to the first matched character or end
+using scanner_fn = auto(char* str, char* end, char a, char b) -> char*;
+
+auto scan_scalar(char* str, char* const end, char const a, char const b) -> char*
+{
+    while (str != end && *str != a && *str != b) str++;
+    return str;
+}
+
+#ifdef IRCMSG_X86_SCANNER
+
+// The vectorized scanners only load whole blocks inside the range and
+// finish the last partial block with the scalar loop.
+
+__attribute__((target("sse2")))
+auto scan_sse2(char* str, char* const end, char const a, char const b) -> char*
+{
+    auto const va = _mm_set1_epi8(a);
+    auto const vb = _mm_set1_epi8(b);
+
+    for (; end - str >= 16; str += 16)
+    {
+        auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(str));
+        auto const m = _mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb));
+        auto const mask = static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+        if (mask != 0)
+        {
+            return str + std::countr_zero(mask);
+        }
+    }
+    return scan_scalar(str, end, a, b);
+}
+
+__attribute__((target("avx2")))
+auto scan_avx2(char* str, char* const end, char const a, char const b) -> char*
+{
+    auto const va = _mm256_set1_epi8(a);
+    auto const vb = _mm256_set1_epi8(b);
+
+    for (; end - str >= 32; str += 32)
+    {
+        auto const x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(str));
+        auto const m = _mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb));
+        auto const mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+        if (mask != 0)
+        {
+            return str + std::countr_zero(mask);
+        }
+    }
+    // At most 31 bytes remain; one SSE2 step narrows the scalar tail
+    return scan_sse2(str, end, a, b);
+}
+
+#endif
+
+auto scanner_supported(irc_scanner const scanner) -> bool
+{
+    switch (scanner)
+    {
+    case irc_scanner::scalar:
+        return true;
+#ifdef IRCMSG_X86_SCANNER
+    case irc_scanner::sse2:
+        return __builtin_cpu_supports("sse2");
+    case irc_scanner::avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+auto scanner_impl(irc_scanner const scanner) -> scanner_fn*
+{
+    switch (scanner)
+    {
+#ifdef IRCMSG_X86_SCANNER
+    case irc_scanner::sse2:
+        return scan_sse2;
+    case irc_scanner::avx2:
+        return scan_avx2;
+#endif
+    default:
+        return scan_scalar;
+    }
+}
+
+auto best_scanner() -> irc_scanner
+{
+    for (auto const scanner : {irc_scanner::avx2, irc_scanner::sse2})
+    {
+        if (scanner_supported(scanner))
+        {
+            return scanner;
+        }
+    }
+    return irc_scanner::scalar;
+}
+
+irc_scanner active_scanner = best_scanner();
+scanner_fn* scan = scanner_impl(active_scanner);
+
 class parser {
     /// @brief Remaining unparsed string
     char* msg_;
 
+    /// @brief Terminator at the end of the string
+    char* end_;
+
     /// @brief Sentinel used for parsers constructed with nullptr
     inline static char empty[1];
 
@@ -21,24 +141,32 @@ public:
     parser(char* const msg) : msg_{msg} {
         if (msg_ == nullptr) {
             msg_ = empty;
-        } else {
-            trim();
         }
+        // The only pass over the whole string; scans stop at end_
+        end_ = msg_ + std::strlen(msg_);
+        trim();
     }
 
     parser(parser const&) = delete;
     auto operator=(parser const&) -> parser& = delete;
 
-    /// @brief Consume and return the next space-separated token
-    /// @return Null-terminated string
-    char* word() {
+    /// @brief Consume the next space-separated token
+    /// @return Start and end of the token, null-terminated in the buffer
+    std::pair<char*, char*> word_range() {
         auto const start = msg_;
-        while (*msg_ != '\0' && *msg_ != ' ') msg_++;
-        if (*msg_ != '\0') { // prepare for next token
+        msg_ = scan(msg_, end_, ' ', ' ');
+        auto const stop = msg_;
+        if (msg_ != end_) { // prepare for next token
             *msg_++ = '\0'; // replace space with terminator
             trim();
         }
-        return start;
+        return {start, stop};
+    }
+
+    /// @brief Consume and return the next space-separated token
+    std::string_view word() {
+        auto const [start, stop] = word_range();
+        return {start, stop};
     }
 
     /// @brief Match and consume specified character
@@ -55,29 +183,31 @@ public:
     /// @brief Predicate for empty string parse target
     /// @return true if empty and false otherwise
     bool isempty() const {
-        return *msg_ == '\0';
+        return msg_ == end_;
     }
 
-    /// @brief Return remaining unparsed string
+    /// @brief Consume and return the remaining unparsed string
     /// @return Null-terminated string
-    char const* peek() const {
-        return msg_;
+    std::string_view rest() {
+        std::string_view const result {msg_, end_};
+        msg_ = end_;
+        return result;
     }
 };
 
-std::string_view unescape_tag_value(char* const val)
+std::string_view unescape_tag_value(char* const val, char* const end)
 {
     // only start copying at the first escape character
     // skip everything before that
-    auto cursor = strchr(val, '\\');
-    if (cursor == nullptr) { return {val}; }
+    auto cursor = scan(val, end, '\\', '\\');
+    if (cursor == end) { return {val, end}; }
 
     auto write = cursor;
-    for (; *cursor; cursor++)
+    for (; cursor != end; cursor++)
     {
         if (*cursor == '\\')
         {
-            cursor++;
+            if (++cursor == end) { break; }
             switch (*cursor)
             {
                 default  : *write++ = *cursor; break;
@@ -85,7 +215,6 @@ std::string_view unescape_tag_value(char* const val)
                 case 's' : *write++ = ' '    ; break;
                 case 'r' : *write++ = '\r'   ; break;
                 case 'n' : *write++ = '\n'   ; break;
-                case '\0': return {val, write};
             }
         }
         else
@@ -96,36 +225,67 @@ std::string_view unescape_tag_value(char* const val)
     return {val, write};
 }
 
-} // namespace
-
-auto parse_irc_tags(char* str) -> std::vector<irctag>
+auto parse_tags(char* str, char* const end, std::vector<irctag>& tags) -> void
 {
-    std::vector<irctag> tags;
+    tags.clear();
 
     do {
-        auto val = strsep(&str, ";");
-        auto const key = strsep(&val, "=");
-        if ('\0' == *key) {
+        auto const key = str;
+        auto cursor = scan(str, end, ';', '=');
+        if (key == cursor) {
             throw irc_parse_error(irc_error_code::MISSING_TAG);
         }
+
+        char* val = nullptr;
+        if (cursor != end && '=' == *cursor) {
+            *cursor++ = '\0';
+            val = cursor;
+            cursor = scan(cursor, end, ';', ';');
+        }
+
+        if (cursor == end) {
+            str = nullptr;
+        } else {
+            *cursor = '\0';
+            str = cursor + 1;
+        }
+
         if (nullptr == val) {
-            tags.emplace_back(key, "");
+            tags.emplace_back(std::string_view{key, cursor}, "");
         } else {
-            tags.emplace_back(key, unescape_tag_value(val));
+            tags.emplace_back(std::string_view{key, val - 1}, unescape_tag_value(val, cursor));
         }
     } while(nullptr != str);
+}
+
+} // namespace
+
+auto parse_irc_tags(char* const str, std::vector<irctag>& tags) -> void
+{
+    parse_tags(str, str + std::strlen(str), tags);
+}
 
+auto parse_irc_tags(char* const str) -> std::vector<irctag>
+{
+    std::vector<irctag> tags;
+    parse_irc_tags(str, tags);
     return tags;
 }
 
-auto parse_irc_message(char* const msg) -> ircmsg
+auto parse_irc_message(char* const msg, ircmsg& out) -> void
 {
     parser p {msg};
-    ircmsg out;
+
+    // clear rather than replace to keep the vector capacity for reuse
+    out.tags.clear();
+    out.args.clear();
+    out.source = {};
+    out.command = {};
 
     /* MESSAGE TAGS */
     if (p.match('@')) {
-        out.tags = parse_irc_tags(p.word());
+        auto const [start, stop] = p.word_range();
+        parse_tags(start, stop, out.tags);
     }
 
     /* MESSAGE SOURCE */
@@ -142,12 +302,17 @@ auto parse_irc_message(char* const msg) -> ircmsg
     /* MESSAGE ARGUMENTS */
     while (!p.isempty()) {
         if (p.match(':')) {
-            out.args.emplace_back(p.peek());
+            out.args.emplace_back(p.rest());
             break;
         }
         out.args.emplace_back(p.word());
     }
+}
 
+auto parse_irc_message(char* const msg) -> ircmsg
+{
+    ircmsg out;
+    parse_irc_message(msg, out);
     return out;
 }
 
@@ -159,3 +324,19 @@ auto operator<<(std::ostream& out, irc_error_code const code) -> std::ostream&
         default: return out;
     }
 }
+
+auto set_irc_scanner(irc_scanner const scanner) -> bool
+{
+    if (scanner_supported(scanner))
+    {
+        active_scanner = scanner;
+        scan = scanner_impl(scanner);
+        return true;
+    }
+    return false;
+}
+
+auto get_irc_scanner() -> irc_scanner
+{
+    return active_scanner;
+}
@@ -0,0 +1,202 @@
+#define _XOPEN_SOURCE 600
+
+#include "linecache.h"
+#include "window.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+
+#include <ncurses.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Rendered lines are stored as the cells ncurses drew for them so that a
+ * later frame can copy them back without formatting the text again.
+ * Lines are keyed by integers and stored in slot key % capacity, so any
+ * run of consecutive keys no longer than the capacity never collides.
+ * A pair of stamps identifies everything else the rendering depended on
+ * and changing either of them discards every line.
+ */
+
+struct line
+{
+    lua_Integer key;
+    int len; // -1 when the slot is empty
+    cchar_t* cells;
+};
+
+struct linecache
+{
+    lua_Integer stamps[2];
+    lua_Integer hits, misses;
+    size_t capacity;
+    struct line* lines;
+};
+
+static struct linecache* checklinecache(lua_State* const L, int const arg)
+{
+    return luaL_checkudata(L, arg, "LINECACHE");
+}
+
+static void discard_lines(struct linecache* const cache)
+{
+    for (size_t i = 0; i < cache->capacity; i++)
+    {
+        free(cache->lines[i].cells);
+        cache->lines[i].cells = NULL;
+        cache->lines[i].len = -1;
+    }
+}
+
+static struct line* find_slot(struct linecache* const cache, lua_Integer const key)
+{
+    return &cache->lines[(lua_Unsigned)key % cache->capacity];
+}
+
+static int l_gc(lua_State* const L)
+{
+    struct linecache* const cache = checklinecache(L, 1);
+    if (NULL != cache->lines)
+    {
+        discard_lines(cache);
+        free(cache->lines);
+        cache->lines = NULL;
+        cache->capacity = 0;
+    }
+    return 0;
+}
+
+static int l_sync(lua_State* const L)
+{
+    struct linecache* const cache = checklinecache(L, 1);
+    lua_Integer const a = luaL_checkinteger(L, 2);
+    lua_Integer const b = luaL_optinteger(L, 3, 0);
+
+    if (cache->stamps[0] != a || cache->stamps[1] != b)
+    {
+        discard_lines(cache);
+        cache->stamps[0] = a;
+        cache->stamps[1] = b;
+    }
+    return 0;
+}
+
+static int l_draw(lua_State* const L)
+{
+    struct linecache* const cache = checklinecache(L, 1);
+    lua_Integer const key = luaL_checkinteger(L, 2);
+    WINDOW* const win = checkwindow(L, 3);
+
+    struct line* const line = find_slot(cache, key);
+    if (line->len < 0 || line->key != key)
+    {
+        cache->misses++;
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+    cache->hits++;
+
+    int y, x, maxy, maxx;
+    getyx(win, y, x);
+    getmaxyx(win, maxy, maxx);
+    (void)maxy;
+
+    int const len = line->len < maxx - x ? line->len : maxx - x;
+    wadd_wchnstr(win, line->cells, len);
+    wmove(win, y, x + len < maxx ? x + len : maxx - 1);
+
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+static int l_store(lua_State* const L)
+{
+    struct linecache* const cache = checklinecache(L, 1);
+    lua_Integer const key = luaL_checkinteger(L, 2);
+    WINDOW* const win = checkwindow(L, 3);
+    lua_Integer const y0 = luaL_checkinteger(L, 4);
+    lua_Integer const x0 = luaL_checkinteger(L, 5);
+
+    int y, x, maxy, maxx;
+    getyx(win, y, x);
+    getmaxyx(win, maxy, maxx);
+
+    luaL_argcheck(L, 0 <= y0 && y0 < maxy, 4, "out of range");
+    luaL_argcheck(L, 0 <= x0 && x0 <= maxx, 5, "out of range");
+
+    // Lines that ran past the end of the row are kept up to the edge
+    int const end = y == y0 ? x : maxx;
+    int const len = end > x0 ? end - x0 : 0;
+
+    cchar_t* const cells = malloc((len + 1) * sizeof *cells);
+    if (NULL == cells)
+    {
+        return luaL_error(L, "store: out of memory");
+    }
+    if (0 < len)
+    {
+        mvwin_wchnstr(win, y0, x0, cells, len);
+        wmove(win, y, x);
+    }
+
+    struct line* const line = find_slot(cache, key);
+    free(line->cells);
+    line->key = key;
+    line->len = len;
+    line->cells = cells;
+    return 0;
+}
+
+static int l_stats(lua_State* const L)
+{
+    struct linecache* const cache = checklinecache(L, 1);
+    lua_pushinteger(L, cache->hits);
+    lua_pushinteger(L, cache->misses);
+    return 2;
+}
+
+static luaL_Reg const MT[] = {
+    {"__gc", l_gc},
+    {0}
+};
+
+static luaL_Reg const Methods[] = {
+    {"sync", l_sync},
+    {"draw", l_draw},
+    {"store", l_store},
+    {"stats", l_stats},
+    {0}
+};
+
+int l_newlinecache(lua_State* const L)
+{
+    lua_Integer const capacity = luaL_optinteger(L, 1, 256);
+    luaL_argcheck(L, 1 <= capacity && capacity <= 65536, 1, "out of range");
+
+    struct linecache* const cache = lua_newuserdatauv(L, sizeof *cache, 0);
+    memset(cache, 0, sizeof *cache);
+
+    if (luaL_newmetatable(L, "LINECACHE"))
+    {
+        luaL_setfuncs(L, MT, 0);
+        luaL_newlibtable(L, Methods);
+        luaL_setfuncs(L, Methods, 0);
+        lua_setfield(L, -2, "__index");
+    }
+    lua_setmetatable(L, -2);
+
+    cache->lines = malloc(capacity * sizeof *cache->lines);
+    if (NULL == cache->lines)
+    {
+        return luaL_error(L, "newlinecache: out of memory");
+    }
+    cache->capacity = capacity;
+    for (size_t i = 0; i < cache->capacity; i++)
+    {
+        cache->lines[i].cells = NULL;
+        cache->lines[i].len = -1;
+    }
+    return 1;
+}
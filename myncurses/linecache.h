@@ -0,0 +1,16 @@
+#ifndef MYNCURSES_LINECACHE_H
+#define MYNCURSES_LINECACHE_H
+
+struct lua_State;
+
+/**
+ * @brief Construct a cache of rendered lines
+ *
+ * Lua arguments: [capacity]
+ *
+ * @param L Lua state
+ * @return 1
+ */
+int l_newlinecache(struct lua_State*);
+
+#endif
@@ -1,6 +1,7 @@
 #define _XOPEN_SOURCE 600
 
 #include "myncurses.h"
+#include "linecache.h"
 #include "window.h"
 
 #include <lauxlib.h>
@@ -9,7 +10,10 @@
 #include <ncurses.h>
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
 
 static int l_erase(lua_State* const L)
 {
@@ -182,12 +186,33 @@ static int l_doupdate(lua_State* const L)
     return 0;
 }
 
-static int l_colorset(lua_State* const L)
+/**
+ * @brief Find or allocate the color pair for a foreground and background
+ *
+ * Colors range from -1 (default) to 7. Pairs are allocated on first use
+ * and pair 0 is used when they run out.
+ */
+static short color_pair(int const fore, int const back)
 {
     // map [fore][back] to a pair number - zero for unassigned (except for [-1][-1])
-    static int color_map[9][9]; // colors range from -1 to 7
-    static int assigned = 1;
+    static short color_map[9][9];
+    static short assigned = 1;
 
+    short* pair = &color_map[fore + 1][back + 1];
+    if (0 == *pair && (fore >= 0 || back >= 0))
+    {
+        if (assigned < COLOR_PAIRS)
+        {
+            *pair = assigned++;
+            int result = init_pair(*pair, fore, back);
+            assert(ERR != result);
+        }
+    }
+    return *pair;
+}
+
+static int l_colorset(lua_State* const L)
+{
     lua_Integer fore = luaL_optinteger(L, 1, -1);
     luaL_argcheck(L, -1 <= fore && fore <= 7, 1, "out of range");
 
@@ -196,25 +221,373 @@ static int l_colorset(lua_State* const L)
 
     WINDOW* const win = optwindow(L, 3);
 
-    int* pair = &color_map[fore + 1][back + 1];
-    if (0 == *pair && (fore >= 0 || back >= 0))
+    if (ERR == wcolor_set(win, color_pair(fore, back), NULL))
     {
-        if (assigned < COLOR_PAIRS)
+        return luaL_error(L, "color_set: ncurses error");
+    }
+
+    return 0;
+}
+
+// Draw list colors combine a foreground and background in one small integer
+#define COLOR_KEY(fore, back) (((fore) + 1) + 9 * ((back) + 1))
+#define COLOR_KEYS 81
+
+static int l_colorkey(lua_State* const L)
+{
+    lua_Integer fore = luaL_optinteger(L, 1, -1);
+    luaL_argcheck(L, -1 <= fore && fore <= 7, 1, "out of range");
+
+    lua_Integer back = luaL_optinteger(L, 2, -1);
+    luaL_argcheck(L, -1 <= back && back <= 7, 2, "out of range");
+
+    lua_pushinteger(L, COLOR_KEY(fore, back));
+    return 1;
+}
+
+/**
+ * @brief Draw one run of a draw list
+ *
+ * Runs with a negative y continue at the cursor. Runs that start outside
+ * of the window are skipped, matching mvaddstr.
+ */
+static void draw_run(
+    WINDOW* const win, int const maxy, int const maxx,
+    int const y, int const x, attr_t const attr, int const color,
+    char const* const str, size_t const len)
+{
+    if (0 <= y)
+    {
+        if (x < 0 || maxy <= y || maxx <= x)
         {
-            *pair = assigned++;
-            int result = init_pair(*pair, fore, back);
-            assert(ERR != result);
+            return;
         }
+        wmove(win, y, x);
     }
+    wattr_set(win, attr, color_pair(color % 9 - 1, color / 9 - 1), NULL);
+    waddnstr(win, str, len);
+}
+
+static void drawlist_table(lua_State* const L, WINDOW* const win, int const maxy, int const maxx)
+{
+    lua_Integer const n = luaL_len(L, 1);
+    luaL_argcheck(L, n % 5 == 0, 1, "length must be a multiple of 5");
 
-    if (ERR == wcolor_set(win, *pair, NULL))
+    for (lua_Integer i = 1; i <= n; i += 5)
     {
-        return luaL_error(L, "color_set: ncurses error");
+        lua_Integer fields[4];
+        for (int j = 0; j < 4; j++)
+        {
+            int isnum;
+            lua_rawgeti(L, 1, i + j);
+            fields[j] = lua_tointegerx(L, -1, &isnum);
+            if (!isnum)
+            {
+                luaL_error(L, "drawlist[%d] not an integer", (int)(i + j));
+            }
+            lua_pop(L, 1);
+        }
+
+        if (fields[3] < 0 || COLOR_KEYS <= fields[3])
+        {
+            luaL_error(L, "drawlist[%d] bad color", (int)(i + 3));
+        }
+
+        if (LUA_TSTRING != lua_rawgeti(L, 1, i + 4))
+        {
+            luaL_error(L, "drawlist[%d] not a string", (int)(i + 4));
+        }
+        size_t len;
+        char const* const str = lua_tolstring(L, -1, &len);
+        draw_run(win, maxy, maxx, fields[0], fields[1], fields[2], fields[3], str, len);
+        lua_pop(L, 1);
+    }
+}
+
+// Packed runs use the string.pack format DRAWLIST_FORMAT: i2 i2 I4 B s2
+static void drawlist_packed(lua_State* const L, WINDOW* const win, int const maxy, int const maxx)
+{
+    size_t len;
+    char const* p = lua_tolstring(L, 1, &len);
+    char const* const end = p + len;
+
+    while (p < end)
+    {
+        int16_t y, x;
+        uint32_t attr;
+        uint8_t color;
+        uint16_t n;
+
+        if (end - p < 11)
+        {
+            luaL_error(L, "drawlist truncated");
+        }
+        memcpy(&y, p, 2);
+        memcpy(&x, p + 2, 2);
+        memcpy(&attr, p + 4, 4);
+        memcpy(&color, p + 8, 1);
+        memcpy(&n, p + 9, 2);
+        p += 11;
+
+        if (end - p < n)
+        {
+            luaL_error(L, "drawlist truncated");
+        }
+        if (COLOR_KEYS <= color)
+        {
+            luaL_error(L, "drawlist bad color");
+        }
+
+        draw_run(win, maxy, maxx, y, x, attr, color, p, n);
+        p += n;
     }
+}
+
+static int l_drawlist(lua_State* const L)
+{
+    WINDOW* const win = optwindow(L, 2);
+    int maxy, maxx;
+    getmaxyx(win, maxy, maxx);
 
+    switch (lua_type(L, 1))
+    {
+    case LUA_TTABLE:
+        drawlist_table(L, win, maxy, maxx);
+        break;
+    case LUA_TSTRING:
+        drawlist_packed(L, win, maxy, maxx);
+        break;
+    default:
+        return luaL_typeerror(L, 1, "table or string");
+    }
     return 0;
 }
 
+// mIRC color numbers mapped to the 8 basic curses colors
+static short const irc_colors[16] = {
+    COLOR_WHITE, COLOR_BLACK, COLOR_BLUE, COLOR_GREEN,
+    COLOR_RED, COLOR_CYAN, COLOR_MAGENTA, COLOR_YELLOW,
+    COLOR_WHITE, COLOR_BLACK, COLOR_BLUE, COLOR_GREEN,
+    COLOR_RED, COLOR_CYAN, COLOR_MAGENTA, COLOR_YELLOW,
+};
+
+static int is_irc_control(unsigned char const c)
+{
+    return c < 0x20 || c == 0x7f;
+}
+
+/**
+ * @brief Parse a one or two digit color number
+ *
+ * @return Color number or -1 when there are no digits
+ */
+static int irc_color_number(char const** const p, char const* const end)
+{
+    int n = -1;
+    for (int i = 0; i < 2 && *p < end && '0' <= **p && **p <= '9'; i++)
+    {
+        n = (n < 0 ? 0 : 10 * n) + (**p - '0');
+        (*p)++;
+    }
+    return n;
+}
+
+static int irc_color(int const n)
+{
+    return 0 <= n && n < 16 ? irc_colors[n] : -1;
+}
+
+static int hex_digit(char const c)
+{
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('a' <= c && c <= 'f') return c - 'a' + 10;
+    if ('A' <= c && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * @brief Parse an RRGGBB hex color as the nearest basic color
+ *
+ * @return Curses color or -2 when there is no hex color
+ */
+static int irc_hex_color(char const** const p, char const* const end)
+{
+    if (end - *p < 6)
+    {
+        return -2;
+    }
+
+    int rgb[3];
+    for (int i = 0; i < 3; i++)
+    {
+        int const hi = hex_digit((*p)[2 * i]);
+        int const lo = hex_digit((*p)[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+        {
+            return -2;
+        }
+        rgb[i] = 16 * hi + lo;
+    }
+    *p += 6;
+
+    return (rgb[0] >= 0x80 ? COLOR_RED : 0)
+         | (rgb[1] >= 0x80 ? COLOR_GREEN : 0)
+         | (rgb[2] >= 0x80 ? COLOR_BLUE : 0);
+}
+
+/**
+ * @brief Count the terminal columns used by a span of text
+ *
+ * Invalid bytes are counted as one column each.
+ */
+static int text_width(char const* p, char const* const end)
+{
+    mbstate_t state;
+    memset(&state, 0, sizeof state);
+
+    int width = 0;
+    while (p < end)
+    {
+        wchar_t wc;
+        size_t const r = mbrtowc(&wc, p, end - p, &state);
+        if (r == (size_t)-1 || r == (size_t)-2)
+        {
+            memset(&state, 0, sizeof state);
+            width++;
+            p++;
+        }
+        else
+        {
+            int const w = wcwidth(wc);
+            if (w > 0)
+            {
+                width += w;
+            }
+            p += r == 0 ? 1 : r;
+        }
+    }
+    return width;
+}
+
+/**
+ * @brief Draw a string containing mIRC formatting codes
+ *
+ * Supports ^B bold, ^C color, ^D hex color, ^O reset, ^V reverse,
+ * ^] italic, and ^_ underline. Other control characters are drawn as
+ * their Unicode control pictures. Attributes are reset afterward.
+ *
+ * Lua arguments: str, [window]
+ * Returns the number of columns drawn.
+ */
+static int l_addircstr(lua_State* const L)
+{
+    size_t len;
+    char const* p = luaL_checklstring(L, 1, &len);
+    WINDOW* const win = optwindow(L, 2);
+    char const* const end = p + len;
+
+    attr_t attr = WA_NORMAL;
+    int fore = -1, back = -1;
+    int width = 0;
+
+    wattr_set(win, WA_NORMAL, 0, NULL);
+
+    while (p < end)
+    {
+        char const* const start = p;
+        while (p < end && !is_irc_control(*p))
+        {
+            p++;
+        }
+        if (start < p)
+        {
+            waddnstr(win, start, p - start);
+            width += text_width(start, p);
+        }
+        if (p == end)
+        {
+            break;
+        }
+
+        unsigned char const ctrl = *p++;
+        switch (ctrl)
+        {
+        case 0x02:
+            attr ^= WA_BOLD;
+            break;
+        case 0x1d:
+            attr ^= WA_ITALIC;
+            break;
+        case 0x1f:
+            attr ^= WA_UNDERLINE;
+            break;
+        case 0x16:
+            attr ^= WA_REVERSE;
+            break;
+        case 0x0f:
+            attr = WA_NORMAL;
+            fore = back = -1;
+            break;
+        case 0x03:
+        {
+            int const f = irc_color_number(&p, end);
+            if (f < 0)
+            {
+                fore = back = -1;
+            }
+            else
+            {
+                fore = irc_color(f);
+                if (end - p >= 2 && ',' == p[0] && '0' <= p[1] && p[1] <= '9')
+                {
+                    p++;
+                    back = irc_color(irc_color_number(&p, end));
+                }
+            }
+            break;
+        }
+        case 0x04:
+        {
+            int const f = irc_hex_color(&p, end);
+            if (f < -1)
+            {
+                fore = back = -1;
+            }
+            else
+            {
+                fore = f;
+                if (end - p >= 7 && ',' == p[0])
+                {
+                    char const* q = p + 1;
+                    int const b = irc_hex_color(&q, end);
+                    if (b >= -1)
+                    {
+                        back = b;
+                        p = q;
+                    }
+                }
+            }
+            break;
+        }
+        default:
+        {
+            // Control pictures U+2400 to U+241F, U+2424 for newline, U+2421 for delete
+            unsigned char const c = ctrl == 0x7f ? 0x21 : ctrl == 0x0a ? 0x24 : ctrl;
+            char const picture[3] = {'\xe2', '\x90', (char)(0x80 + c)};
+            waddnstr(win, picture, sizeof picture);
+            width++;
+            continue;
+        }
+        }
+
+        wattr_set(win, attr, color_pair(fore, back), NULL);
+    }
+
+    wattr_set(win, WA_NORMAL, 0, NULL);
+    lua_pushinteger(L, width);
+    return 1;
+}
+
 static int l_move(lua_State* const L)
 {
     lua_Integer y = luaL_checkinteger(L, 1);
@@ -267,6 +640,9 @@ static luaL_Reg lib[] = {
     {"attrset", l_attrset},
     {"attrget", l_attrget},
     {"colorset", l_colorset},
+    {"colorkey", l_colorkey},
+    {"drawlist", l_drawlist},
+    {"addircstr", l_addircstr},
 
     {"cursset", l_cursset},
     {"move", l_move},
@@ -275,6 +651,7 @@ static luaL_Reg lib[] = {
 
     {"newwin", l_newwin},
     {"newpad", l_newpad},
+    {"newlinecache", l_newlinecache},
     {"doupdate", l_doupdate},
     {0},
 };
@@ -320,6 +697,9 @@ int luaopen_myncurses(lua_State* L)
     CC(COLOR_WHITE);
     CCR("COLOR_DEFAULT", -1);
 
+    lua_pushliteral(L, "i2i2I4Bs2");
+    lua_setfield(L, -2, "DRAWLIST_FORMAT");
+
     /* attributes */
     CC(WA_NORMAL);
     CC(WA_STANDOUT);
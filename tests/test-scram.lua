@@ -1,9 +1,22 @@
 local impl = require 'sasl.scram'
+
+-- Key derivation is requested from the driving task; run it directly here
+local task = {}
+function task:pbkdf2(digest, ...) return digest:pbkdf2(...) end
+
+local function resume(thread, input)
+    local success, message = coroutine.resume(thread, input)
+    while success and type(message) == 'function' do
+        success, message = coroutine.resume(thread, message(task))
+    end
+    return success, message
+end
+
 local thread = impl('sha1', nil, 'user', 'pencil', 'fyko+d2lbbFgONRv9qkxdawL')
 local success, message
-success, message = coroutine.resume(thread, '')
+success, message = resume(thread, '')
 assert(success and message == 'n,,n=user,r=fyko+d2lbbFgONRv9qkxdawL')
-success, message = coroutine.resume(thread, 'r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,s=QSXCR+Q6sek8bf92,i=4096')
+success, message = resume(thread, 'r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,s=QSXCR+Q6sek8bf92,i=4096')
 assert(success and message == 'c=biws,r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,p=v0X8v3Bz2T0CJGbJQyF0X+HI4Ts=')
-success, message = coroutine.resume(thread, 'v=rmF9pqV8S7suAoZWja4dJRkFsKQ=')
+success, message = resume(thread, 'v=rmF9pqV8S7suAoZWja4dJRkFsKQ=')
 assert(success and message == '')
@@ -0,0 +1,190 @@
+#include <child_process.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+struct Exit
+{
+    int code;
+    bool timed_out;
+};
+
+// Runs /bin/sh -c script to completion and records every event as text
+struct ChildProcessTest : testing::Test
+{
+    boost::asio::io_context io_context;
+    std::vector<std::string> events;
+    std::optional<Exit> exit;
+    std::shared_ptr<ChildProcess> process;
+
+    ChildProcessTest()
+    {
+        // As App does, so writes to a dead child fail instead of killing us
+        std::signal(SIGPIPE, SIG_IGN);
+    }
+
+    auto spawn(std::string script, ChildProcess::Options const& options, std::function<void(std::string_view, std::string_view, bool)> also = {}) -> void
+    {
+        process = std::make_shared<ChildProcess>(
+            io_context,
+            ChildProcess::Handlers{
+                .output = [this, also](std::string_view const stream, std::string_view const data, bool const partial) {
+                    events.push_back(std::string{stream} + (partial ? "~" : ":") + std::string{data});
+                    if (also)
+                    {
+                        also(stream, data, partial);
+                    }
+                },
+                .drain = [this]() { events.push_back("drain"); },
+                .exit = [this](int const code, bool const timed_out) {
+                    events.push_back("exit");
+                    exit = Exit{code, timed_out};
+                },
+            },
+            options
+        );
+        process->start(io_context, "/bin/sh", {"-c", std::move(script)});
+    }
+
+    auto run() -> void
+    {
+        io_context.run_for(10s);
+    }
+};
+
+ChildProcess::Options constexpr defaults{
+    .chunks = false,
+    .input = false,
+    .max_line = 65'536,
+    .write_high_water = 65'536,
+    .timeout = 0ms,
+};
+
+TEST_F(ChildProcessTest, LinesAndExitCode) {
+  spawn("echo one; echo two >&2; printf three; exit 3", defaults);
+  run();
+
+  ASSERT_TRUE(exit);
+  EXPECT_EQ(exit->code, 3);
+  EXPECT_FALSE(exit->timed_out);
+  ASSERT_EQ(events.size(), 4);
+  EXPECT_EQ(events.back(), "exit");
+  EXPECT_NE(std::find(events.begin(), events.end(), "stdout:one"), events.end());
+  EXPECT_NE(std::find(events.begin(), events.end(), "stdout:three"), events.end());
+  EXPECT_NE(std::find(events.begin(), events.end(), "stderr:two"), events.end());
+}
+
+TEST_F(ChildProcessTest, LongLinesArriveInPieces) {
+  auto options = defaults;
+  options.max_line = 8;
+  spawn("echo 0123456789abcdefghij; echo short", options);
+  run();
+
+  std::vector<std::string> const expected{
+      "stdout~01234567",
+      "stdout~89abcdef",
+      "stdout:ghij",
+      "stdout:short",
+      "exit",
+  };
+  EXPECT_EQ(events, expected);
+}
+
+TEST_F(ChildProcessTest, TimeoutKillsProcess) {
+  auto options = defaults;
+  options.timeout = 100ms;
+  auto const start = std::chrono::steady_clock::now();
+  spawn("echo started; exec sleep 10", options);
+  run();
+
+  ASSERT_TRUE(exit);
+  EXPECT_TRUE(exit->timed_out);
+  EXPECT_EQ(exit->code, SIGKILL);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+  std::vector<std::string> const expected{"stdout:started", "exit"};
+  EXPECT_EQ(events, expected);
+}
+
+TEST_F(ChildProcessTest, TimeoutKillsBackgroundChildren) {
+  auto options = defaults;
+  options.timeout = 100ms;
+  auto const start = std::chrono::steady_clock::now();
+  // The background sleep holds stdout and stderr open after sh is gone
+  spawn("sleep 60 & sleep 60", options);
+  run();
+
+  ASSERT_TRUE(exit);
+  EXPECT_TRUE(exit->timed_out);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+}
+
+TEST_F(ChildProcessTest, ExitWaitsForProcessAfterStreamsClose) {
+  spawn("echo out; echo err >&2; exec >&- 2>&-; sleep 0.2; exit 7", defaults);
+
+  // Both streams finish well before the process does
+  io_context.run_for(100ms);
+  EXPECT_FALSE(exit);
+  EXPECT_EQ(events.size(), 2);
+
+  run();
+  ASSERT_TRUE(exit);
+  EXPECT_EQ(exit->code, 7);
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(events.back(), "exit");
+}
+
+TEST_F(ChildProcessTest, WriteAfterChildExited) {
+  auto options = defaults;
+  options.input = true;
+  spawn("echo bye", options, [this](std::string_view, std::string_view, bool) {
+      // Give the child time to exit so nothing reads this
+      std::this_thread::sleep_for(200ms);
+      EXPECT_TRUE(process->write("too late\n"));
+  });
+  run();
+
+  ASSERT_TRUE(exit);
+  EXPECT_EQ(exit->code, 0);
+  EXPECT_FALSE(process->can_write());
+  EXPECT_EQ(process->pending(), 0);
+}
+
+TEST_F(ChildProcessTest, ChildGetsDefaultSigpipe) {
+  // yes only stops when SIGPIPE kills it after head exits
+  spawn("yes | head -n 1; trap", defaults);
+  run();
+
+  ASSERT_TRUE(exit);
+  EXPECT_EQ(exit->code, 0);
+  std::vector<std::string> const expected{"stdout:y", "exit"};
+  EXPECT_EQ(events, expected);
+}
+
+TEST_F(ChildProcessTest, InputIsPassedThrough) {
+  auto options = defaults;
+  options.input = true;
+  spawn("cat", options);
+  EXPECT_TRUE(process->write("hello\n"));
+  EXPECT_TRUE(process->write("world"));
+  process->close_stdin();
+  run();
+
+  std::vector<std::string> const expected{"stdout:hello", "stdout:world", "exit"};
+  EXPECT_EQ(events, expected);
+}
+
+} // namespace
@@ -0,0 +1,191 @@
+#include <net/dns_resolver.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+using Kind = DnsResolver::Kind;
+using Result = DnsResolver::Result;
+
+// Names starting with "name" resolve, "flaky" fails transiently, and
+// everything else doesn't exist. Reverse lookups always succeed.
+struct FakeBackend
+{
+    std::atomic<int> calls{0};
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    std::chrono::milliseconds delay{0};
+
+    auto operator()(Kind const kind, std::string const& name) -> Result
+    {
+        calls++;
+        auto const now = ++running;
+        for (auto seen = peak.load(); seen < now && not peak.compare_exchange_weak(seen, now);)
+        {
+        }
+        std::this_thread::sleep_for(delay);
+        running--;
+
+        if (Kind::reverse == kind)
+        {
+            return {{}, {"ptr-for-" + name}};
+        }
+        if (name.starts_with("name"))
+        {
+            return {{}, {"192.0.2.1"}};
+        }
+        if (name.starts_with("flaky"))
+        {
+            return {boost::asio::error::host_not_found_try_again, {}};
+        }
+        return {boost::asio::error::host_not_found, {}};
+    }
+};
+
+struct DnsResolverTest : testing::Test
+{
+    boost::asio::io_context io;
+    FakeBackend backend;
+    DnsResolver resolver{io, [this](Kind const kind, std::string const& name) { return backend(kind, name); }};
+
+    auto lookup(Kind const kind, std::string const& name, std::vector<Result>& results) -> std::uint64_t
+    {
+        return resolver.lookup(kind, name, [&results](Result const& result) { results.push_back(result); });
+    }
+
+    auto run() -> void
+    {
+        io.restart();
+        io.run_for(5s);
+    }
+
+    ~DnsResolverTest() override
+    {
+        resolver.shutdown();
+    }
+};
+
+TEST_F(DnsResolverTest, HandlersRunLater) {
+  std::vector<Result> results;
+  lookup(Kind::forward, "name1", results);
+  EXPECT_TRUE(results.empty());
+  run();
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_FALSE(results[0].error);
+  EXPECT_EQ(results[0].names, std::vector<std::string>{"192.0.2.1"});
+
+  // cache hits are delivered later too
+  lookup(Kind::forward, "name1", results);
+  EXPECT_EQ(results.size(), 1);
+  run();
+  EXPECT_EQ(results.size(), 2);
+  EXPECT_EQ(backend.calls, 1);
+}
+
+TEST_F(DnsResolverTest, CachesAnswersAndNegativeAnswers) {
+  std::vector<Result> results;
+  lookup(Kind::forward, "name1", results);
+  lookup(Kind::forward, "missing", results);
+  lookup(Kind::forward, "flaky", results);
+  run();
+  lookup(Kind::forward, "name1", results);
+  lookup(Kind::forward, "missing", results);
+  lookup(Kind::forward, "flaky", results);
+  run();
+
+  ASSERT_EQ(results.size(), 6);
+  EXPECT_EQ(results[4].error, boost::asio::error::host_not_found);
+  EXPECT_EQ(results[5].error, boost::asio::error::host_not_found_try_again);
+
+  // transient failures are not remembered
+  EXPECT_EQ(backend.calls, 4);
+  auto const stats = resolver.stats();
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 4);
+  EXPECT_EQ(stats.entries, 2);
+}
+
+TEST_F(DnsResolverTest, EntriesExpire) {
+  resolver.set_options({.ttl = 0s, .negative_ttl = 0s});
+  std::vector<Result> results;
+  lookup(Kind::forward, "name1", results);
+  run();
+  lookup(Kind::forward, "name1", results);
+  run();
+  EXPECT_EQ(results.size(), 2);
+  EXPECT_EQ(backend.calls, 2);
+}
+
+TEST_F(DnsResolverTest, ForwardAndReverseAreSeparate) {
+  std::vector<Result> results;
+  lookup(Kind::forward, "name1", results);
+  lookup(Kind::reverse, "name1", results);
+  run();
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(backend.calls, 2);
+  auto const& ptr = results[0].names[0] == "192.0.2.1" ? results[1] : results[0];
+  EXPECT_EQ(ptr.names, std::vector<std::string>{"ptr-for-name1"});
+}
+
+TEST_F(DnsResolverTest, ConcurrentRequestsShareOneLookup) {
+  backend.delay = 20ms;
+  std::vector<Result> results;
+  for (int i = 0; i < 5; i++)
+  {
+    lookup(Kind::forward, "name1", results);
+  }
+  run();
+  EXPECT_EQ(results.size(), 5);
+  EXPECT_EQ(backend.calls, 1);
+}
+
+TEST_F(DnsResolverTest, ConcurrencyIsCapped) {
+  resolver.set_options({.concurrency = 2});
+  backend.delay = 20ms;
+  std::vector<Result> results;
+  for (int i = 0; i < 8; i++)
+  {
+    lookup(Kind::forward, "name" + std::to_string(i), results);
+  }
+  auto const stats = resolver.stats();
+  EXPECT_EQ(stats.running, 2);
+  EXPECT_EQ(stats.queued, 6);
+
+  run();
+  EXPECT_EQ(results.size(), 8);
+  EXPECT_EQ(backend.calls, 8);
+  EXPECT_LE(backend.peak, 2);
+  EXPECT_EQ(resolver.stats().running, 0);
+}
+
+TEST_F(DnsResolverTest, CancelledRequestsAreSkipped) {
+  resolver.set_options({.concurrency = 1});
+  backend.delay = 20ms;
+  std::vector<Result> results;
+  lookup(Kind::forward, "name1", results);
+  auto const id = lookup(Kind::forward, "name2", results);
+  resolver.cancel(id);
+  run();
+
+  ASSERT_EQ(results.size(), 1);
+  // the queued lookup never ran
+  EXPECT_EQ(backend.calls, 1);
+}
+
+TEST(DnsResolver, SystemBackendRejectsBadAddress) {
+  auto const result = DnsResolver::system_backend(Kind::reverse, "not an address");
+  EXPECT_EQ(result.error, boost::asio::error::invalid_argument);
+
+  auto const local = DnsResolver::system_backend(Kind::forward, "127.0.0.1");
+  EXPECT_FALSE(local.error);
+  EXPECT_EQ(local.names, std::vector<std::string>{"127.0.0.1"});
+}
+
+} // namespace
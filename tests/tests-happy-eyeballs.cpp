@@ -0,0 +1,176 @@
+#include <net/happy_eyeballs.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+using boost::asio::ip::tcp;
+
+auto ep(char const* const address, unsigned short const port) -> tcp::endpoint
+{
+    return {boost::asio::ip::make_address(address), port};
+}
+
+auto listener(boost::asio::io_context& io, char const* const address, int const backlog = boost::asio::socket_base::max_listen_connections) -> tcp::acceptor
+{
+    tcp::acceptor acceptor{io};
+    auto const endpoint = ep(address, 0);
+    acceptor.open(endpoint.protocol());
+    acceptor.bind(endpoint);
+    acceptor.listen(backlog);
+    return acceptor;
+}
+
+// A port where nothing listens
+auto closed_port(boost::asio::io_context& io, char const* const address) -> tcp::endpoint
+{
+    return listener(io, address).local_endpoint();
+}
+
+// Loopback drops handshakes to a listener whose accept queue is full,
+// so connecting to it hangs like connecting to a blackholed address.
+struct Blackhole
+{
+    tcp::acceptor acceptor;
+    tcp::socket filler;
+
+    Blackhole(boost::asio::io_context& io, char const* const address)
+        : acceptor{listener(io, address, 0)}
+        , filler{io}
+    {
+        filler.connect(acceptor.local_endpoint());
+    }
+};
+
+struct Outcome
+{
+    std::optional<tcp::endpoint> connected;
+    boost::system::error_code error;
+    std::chrono::steady_clock::duration elapsed;
+};
+
+auto attempt(HappyEyeballs& connector, std::vector<tcp::endpoint> endpoints, Outcome& outcome) -> boost::asio::awaitable<void>
+{
+    auto const start = std::chrono::steady_clock::now();
+    try
+    {
+        auto const socket = co_await connector.connect(std::move(endpoints));
+        outcome.connected = socket.remote_endpoint();
+    }
+    catch (boost::system::system_error const& e)
+    {
+        outcome.error = e.code();
+    }
+    outcome.elapsed = std::chrono::steady_clock::now() - start;
+}
+
+auto run(boost::asio::io_context& io, HappyEyeballs& connector, std::vector<tcp::endpoint> endpoints) -> Outcome
+{
+    Outcome outcome;
+    boost::asio::co_spawn(io, attempt(connector, std::move(endpoints), outcome), boost::asio::detached);
+    io.restart();
+    io.run_for(10s);
+    return outcome;
+}
+
+TEST(HappyEyeballs, InterleaveFamilies) {
+  auto const result = HappyEyeballs::interleave({
+      ep("2001:db8::1", 1), ep("2001:db8::2", 1), ep("192.0.2.1", 1), ep("192.0.2.2", 1), ep("2001:db8::3", 1)});
+  std::vector<tcp::endpoint> const expected{
+      ep("2001:db8::1", 1), ep("192.0.2.1", 1), ep("2001:db8::2", 1), ep("192.0.2.2", 1), ep("2001:db8::3", 1)};
+  EXPECT_EQ(result, expected);
+
+  // the first address picks the family that leads
+  auto const v4first = HappyEyeballs::interleave({ep("192.0.2.1", 1), ep("2001:db8::1", 1), ep("2001:db8::2", 1)});
+  EXPECT_EQ(v4first, (std::vector{ep("192.0.2.1", 1), ep("2001:db8::1", 1), ep("2001:db8::2", 1)}));
+}
+
+TEST(HappyEyeballs, ConnectsToListener) {
+  boost::asio::io_context io;
+  auto const acceptor = listener(io, "127.0.0.1");
+  HappyEyeballs connector{io.get_executor()};
+
+  auto const outcome = run(io, connector, {acceptor.local_endpoint()});
+  ASSERT_TRUE(outcome.connected);
+  EXPECT_EQ(*outcome.connected, acceptor.local_endpoint());
+  ASSERT_EQ(connector.attempts().size(), 1);
+  EXPECT_FALSE(connector.attempts()[0].error);
+}
+
+TEST(HappyEyeballs, RefusedStartsNextAttemptImmediately) {
+  boost::asio::io_context io;
+  auto const refused = closed_port(io, "::1");
+  auto const acceptor = listener(io, "127.0.0.1");
+  HappyEyeballs connector{io.get_executor(), 5s};
+
+  auto const outcome = run(io, connector, {refused, acceptor.local_endpoint()});
+  ASSERT_TRUE(outcome.connected);
+  EXPECT_EQ(*outcome.connected, acceptor.local_endpoint());
+  EXPECT_LT(outcome.elapsed, 1s);
+
+  auto const& attempts = connector.attempts();
+  ASSERT_EQ(attempts.size(), 2);
+  EXPECT_EQ(attempts[0].error, boost::asio::error::connection_refused);
+  EXPECT_FALSE(attempts[1].error);
+
+  std::ostringstream os;
+  os << attempts;
+  EXPECT_EQ(os.str().find("[::1]:" + std::to_string(refused.port()) + "/refused/"), 0);
+  EXPECT_NE(os.str().find(",127.0.0.1:" + std::to_string(acceptor.local_endpoint().port()) + "/ok/"), std::string::npos);
+}
+
+TEST(HappyEyeballs, BlackholedFamilyCostsOneDelay) {
+  boost::asio::io_context io;
+  Blackhole const blackhole{io, "::1"};
+  auto const acceptor = listener(io, "127.0.0.1");
+  HappyEyeballs connector{io.get_executor(), 50ms};
+
+  auto const outcome = run(io, connector, {blackhole.acceptor.local_endpoint(), acceptor.local_endpoint()});
+  ASSERT_TRUE(outcome.connected);
+  EXPECT_EQ(*outcome.connected, acceptor.local_endpoint());
+  EXPECT_GE(outcome.elapsed, 50ms);
+  EXPECT_LT(outcome.elapsed, 1s);
+
+  auto const& attempts = connector.attempts();
+  ASSERT_EQ(attempts.size(), 2);
+  EXPECT_EQ(attempts[0].error, boost::asio::error::operation_aborted);
+  EXPECT_GE(attempts[0].elapsed, 50ms);
+  EXPECT_FALSE(attempts[1].error);
+}
+
+TEST(HappyEyeballs, AllAttemptsFail) {
+  boost::asio::io_context io;
+  HappyEyeballs connector{io.get_executor()};
+
+  auto const outcome = run(io, connector, {closed_port(io, "::1"), closed_port(io, "127.0.0.1")});
+  EXPECT_FALSE(outcome.connected);
+  EXPECT_EQ(outcome.error, boost::asio::error::connection_refused);
+  EXPECT_EQ(connector.attempts().size(), 2);
+
+  auto const none = run(io, connector, {});
+  EXPECT_EQ(none.error, boost::asio::error::host_not_found);
+}
+
+TEST(HappyEyeballs, Cancel) {
+  boost::asio::io_context io;
+  Blackhole const blackhole{io, "::1"};
+  HappyEyeballs connector{io.get_executor()};
+
+  boost::asio::steady_timer timer{io, 20ms};
+  timer.async_wait([&](boost::system::error_code) { connector.cancel(); });
+
+  auto const outcome = run(io, connector, {blackhole.acceptor.local_endpoint()});
+  EXPECT_FALSE(outcome.connected);
+  EXPECT_EQ(outcome.error, boost::asio::error::operation_aborted);
+  EXPECT_LT(outcome.elapsed, 1s);
+  ASSERT_EQ(connector.attempts().size(), 1);
+  EXPECT_EQ(connector.attempts()[0].error, boost::asio::error::operation_aborted);
+}
+
+} // namespace
@@ -2,6 +2,11 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <optional>
+#include <random>
+#include <string>
+
 namespace {
 
 TEST(Irc, NoArgs) {
@@ -219,6 +224,52 @@ TEST(Irc, MixedValidAndUnconventionalTags) {
     EXPECT_EQ(parse_irc_message(input), expected);
 }
 
+auto parse_with(irc_scanner const scanner, std::string& input) -> std::optional<ircmsg>
+{
+  auto const previous = get_irc_scanner();
+  set_irc_scanner(scanner);
+  std::optional<ircmsg> result;
+  try {
+    result = parse_irc_message(input.data());
+  } catch (irc_parse_error const&) {
+  }
+  set_irc_scanner(previous);
+  return result;
+}
+
+auto differential_fuzz(char const* const alphabet, std::size_t const max_length) -> void
+{
+  std::mt19937 gen{1459};
+  std::uniform_int_distribution<std::size_t> pick{0, std::strlen(alphabet) - 1};
+  std::uniform_int_distribution<std::size_t> length{0, max_length};
+
+  for (auto const scanner : {irc_scanner::sse2, irc_scanner::avx2}) {
+    if (not set_irc_scanner(scanner)) continue;
+
+    for (int i = 0; i < 20'000; i++) {
+      std::string input;
+      for (auto n = length(gen); n > 0; n--) input.push_back(alphabet[pick(gen)]);
+      if (i % 2 == 0) input.insert(0, "@");
+
+      std::string expected_input = input;
+      std::string actual_input = input;
+      auto const expected = parse_with(irc_scanner::scalar, expected_input);
+      auto const actual = parse_with(scanner, actual_input);
+      ASSERT_EQ(expected, actual) << "input: " << input;
+    }
+  }
+}
+
+TEST(Irc, ScannerDifferentialFuzz) {
+  // Alphabet is weighted toward the characters the parser splits on
+  differential_fuzz("   ::;;==@\\abcsrn", 100);
+}
+
+TEST(Irc, ScannerDifferentialFuzzLongTokens) {
+  // Sparse delimiters so tokens span several whole vector blocks
+  differential_fuzz(" :;=\\abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", 300);
+}
+
 }
 
 int main(int argc, char **argv) {
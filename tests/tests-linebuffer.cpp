@@ -0,0 +1,93 @@
+#include <linebuffer.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+auto feed(LineBuffer& buff, std::string_view const input) -> std::size_t
+{
+    auto const target = buff.get_buffer();
+    auto const n = std::min(target.size(), input.size());
+    std::memcpy(target.data(), input.data(), n);
+    buff.add_bytes(n);
+    return n;
+}
+
+TEST(LineBuffer, SplitsLines) {
+  LineBuffer buff{64};
+  feed(buff, "one\r\ntwo\nthr");
+  EXPECT_STREQ(buff.next_line(), "one");
+  EXPECT_STREQ(buff.next_line(), "two");
+  EXPECT_EQ(buff.next_line(), nullptr);
+  feed(buff, "ee\r\n");
+  EXPECT_STREQ(buff.next_line(), "three");
+  EXPECT_EQ(buff.next_line(), nullptr);
+}
+
+TEST(LineBuffer, LinesStableUntilGetBuffer) {
+  LineBuffer buff{16};
+  feed(buff, "abc\ndefghij");
+  auto const line = buff.next_line();
+  EXPECT_EQ(buff.next_line(), nullptr);
+  EXPECT_STREQ(line, "abc");
+}
+
+TEST(LineBuffer, RelocatesWhenTailShort) {
+  LineBuffer buff{16};
+  feed(buff, "abc\ndefghijklmno");
+  EXPECT_STREQ(buff.next_line(), "abc");
+  EXPECT_EQ(buff.next_line(), nullptr);
+  EXPECT_EQ(feed(buff, "p\n"), 2);
+  EXPECT_STREQ(buff.next_line(), "defghijklmnop");
+}
+
+TEST(LineBuffer, FixedSizeFills) {
+  LineBuffer buff{8};
+  feed(buff, "abcdefgh");
+  EXPECT_EQ(buff.next_line(), nullptr);
+  EXPECT_EQ(buff.get_buffer().size(), 0);
+}
+
+TEST(LineBuffer, GrowsToLimit) {
+  LineBuffer buff{8, 32};
+  std::string_view input = "0123456789abcdefghijklmnopqrstu\n";
+  while (not input.empty()) {
+    input.remove_prefix(feed(buff, input));
+  }
+  EXPECT_STREQ(buff.next_line(), "0123456789abcdefghijklmnopqrstu");
+  EXPECT_EQ(buff.next_line(), nullptr);
+  EXPECT_EQ(buff.get_buffer().size(), 8);
+}
+
+TEST(LineBuffer, StopsAtLimit) {
+  LineBuffer buff{8, 16};
+  std::string_view input = "0123456789abcdefXYZ";
+  while (not input.empty()) {
+    auto const n = feed(buff, input);
+    if (n == 0) break;
+    input.remove_prefix(n);
+  }
+  EXPECT_EQ(buff.next_line(), nullptr);
+  EXPECT_EQ(input, "XYZ");
+
+  EXPECT_EQ(buff.take_partial(), "0123456789abcdef");
+  EXPECT_EQ(buff.take_partial(), "");
+  EXPECT_EQ(feed(buff, "XYZ\n"), 4);
+  EXPECT_STREQ(buff.next_line(), "XYZ");
+}
+
+TEST(LineBuffer, TakePartialAfterLines) {
+  LineBuffer buff{16};
+  feed(buff, "one\ntwo");
+  EXPECT_STREQ(buff.next_line(), "one");
+  EXPECT_EQ(buff.next_line(), nullptr);
+  EXPECT_EQ(buff.take_partial(), "two");
+  EXPECT_EQ(buff.next_line(), nullptr);
+  feed(buff, "three\n");
+  EXPECT_STREQ(buff.next_line(), "three");
+}
+
+}
@@ -0,0 +1,72 @@
+#include <lru_cache.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+TEST(LruCache, EvictsLeastRecentlyUsed) {
+  LruCache<std::string, int> cache{2};
+  cache.insert("a", 1);
+  cache.insert("b", 2);
+
+  // touching a makes b the eviction candidate
+  ASSERT_NE(cache.find("a"), nullptr);
+  cache.insert("c", 3);
+
+  EXPECT_EQ(cache.find("b"), nullptr);
+  ASSERT_NE(cache.find("a"), nullptr);
+  EXPECT_EQ(*cache.find("a"), 1);
+  EXPECT_EQ(*cache.find("c"), 3);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.evictions(), 1);
+}
+
+TEST(LruCache, InsertReplaces) {
+  LruCache<std::string, int> cache{2};
+  cache.insert("a", 1);
+  cache.insert("b", 2);
+  cache.insert("a", 10);
+  cache.insert("c", 3);
+
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(*cache.find("a"), 10);
+  EXPECT_EQ(cache.find("b"), nullptr);
+}
+
+TEST(LruCache, Counters) {
+  LruCache<int, int> cache{4};
+  cache.insert(1, 1);
+  cache.find(1);
+  cache.find(1);
+  cache.find(2);
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(cache.misses(), 1);
+  EXPECT_EQ(cache.evictions(), 0);
+}
+
+TEST(LruCache, ShrinkCapacity) {
+  LruCache<int, int> cache{4};
+  for (int i = 0; i < 4; i++) cache.insert(i, i);
+  cache.set_capacity(2);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.evictions(), 2);
+  EXPECT_NE(cache.find(3), nullptr);
+  EXPECT_NE(cache.find(2), nullptr);
+  EXPECT_EQ(cache.find(1), nullptr);
+
+  cache.set_capacity(0); // clamped to one entry
+  EXPECT_EQ(cache.capacity(), 1);
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(LruCache, Erase) {
+  LruCache<int, int> cache{2};
+  cache.insert(1, 1);
+  EXPECT_TRUE(cache.erase(1));
+  EXPECT_FALSE(cache.erase(1));
+  EXPECT_EQ(cache.size(), 0);
+}
+
+} // namespace
@@ -0,0 +1,58 @@
+#include <metrics.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+TEST(Metrics, RegistrationIsStable) {
+  auto& a = metrics::counter("test_stable_total", "stable");
+  a.add(3);
+  auto& b = metrics::counter("test_stable_total", "ignored");
+  EXPECT_EQ(&a, &b);
+  EXPECT_EQ(b.value(), 3);
+  EXPECT_NE(&a, &metrics::counter("test_stable_total", "stable", "x=\"1\""));
+}
+
+TEST(Metrics, TypeMismatch) {
+  metrics::counter("test_mismatch", "mismatch");
+  EXPECT_THROW(metrics::gauge("test_mismatch", "mismatch"), std::logic_error);
+}
+
+TEST(Metrics, HistogramBuckets) {
+  metrics::Histogram h;
+  h.observe(10us); // bounds are inclusive
+  h.observe(11us);
+  h.observe(2ms);
+  h.observe(5s);
+  EXPECT_EQ(h.count(), 4);
+  EXPECT_EQ(h.bucket(0), 1);
+  EXPECT_EQ(h.bucket(1), 1);
+  EXPECT_EQ(h.bucket(5), 1);
+  EXPECT_EQ(h.bucket(metrics::Histogram::bounds.size()), 1);
+  EXPECT_EQ(h.sum(), 10us + 11us + 2ms + 5s);
+}
+
+TEST(Metrics, LabelEscaping) {
+  EXPECT_EQ(metrics::label("k", "a\"b\\c\nd"), "k=\"a\\\"b\\\\c\\nd\"");
+}
+
+TEST(Metrics, Prometheus) {
+  metrics::gauge("test_prom_gauge", "A gauge").set(-2);
+  metrics::histogram("test_prom_seconds", "A histogram", "site=\"x\"").observe(1ms);
+
+  auto const text = metrics::render_prometheus();
+  EXPECT_NE(text.find("# HELP test_prom_gauge A gauge\n# TYPE test_prom_gauge gauge\ntest_prom_gauge -2\n"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE test_prom_seconds histogram\n"), std::string::npos);
+  EXPECT_NE(text.find("test_prom_seconds_bucket{site=\"x\",le=\"0.0005\"} 0\n"), std::string::npos);
+  EXPECT_NE(text.find("test_prom_seconds_bucket{site=\"x\",le=\"0.001\"} 1\n"), std::string::npos);
+  EXPECT_NE(text.find("test_prom_seconds_bucket{site=\"x\",le=\"+Inf\"} 1\n"), std::string::npos);
+  EXPECT_NE(text.find("test_prom_seconds_count{site=\"x\"} 1\n"), std::string::npos);
+}
+
+} // namespace
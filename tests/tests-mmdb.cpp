@@ -0,0 +1,304 @@
+#include <mmdb.hpp>
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+struct Network
+{
+    char const* address;
+    unsigned length;
+    std::uint32_t asn;
+    char const* organization;
+};
+
+// Writes a minimal ASN database holding the given networks
+class Writer
+{
+    struct Node
+    {
+        // 0 for empty, positive for a node, negative for a network
+        int child[2];
+    };
+
+    unsigned record_size_;
+    std::vector<Node> nodes_{Node{}};
+    std::string data_;
+    std::vector<std::size_t> records_;
+
+    static auto control(std::string& out, int const type, std::size_t const size) -> void
+    {
+        if (size < 29)
+        {
+            out += static_cast<char>(type << 5 | size);
+        }
+        else
+        {
+            out += static_cast<char>(type << 5 | 29);
+            out += static_cast<char>(size - 29);
+        }
+    }
+
+    static auto string(std::string& out, std::string const& str) -> void
+    {
+        control(out, 2, str.size());
+        out += str;
+    }
+
+    static auto unsigned_integer(std::string& out, int const type, std::uint32_t value) -> void
+    {
+        std::string bytes;
+        for (; value; value >>= 8)
+        {
+            bytes.insert(bytes.begin(), static_cast<char>(value));
+        }
+        control(out, type, bytes.size());
+        out += bytes;
+    }
+
+    auto record_value(int const child) const -> std::uint32_t
+    {
+        if (child > 0)
+        {
+            return child;
+        }
+        if (child < 0)
+        {
+            return nodes_.size() + 16 + records_[-child - 1];
+        }
+        return nodes_.size();
+    }
+
+public:
+    explicit Writer(unsigned const record_size)
+        : record_size_{record_size}
+    {
+    }
+
+    auto add(Network const& network) -> void
+    {
+        unsigned char bytes[16]{};
+        unsigned length = network.length;
+        if (inet_pton(AF_INET, network.address, bytes + 12))
+        {
+            length += 96;
+        }
+        else
+        {
+            ASSERT_EQ(inet_pton(AF_INET6, network.address, bytes), 1);
+        }
+
+        // The first record spells out the organization key; later ones point at it
+        static std::size_t key_offset;
+        records_.push_back(data_.size());
+        control(data_, 7, 2);
+        string(data_, "autonomous_system_number");
+        unsigned_integer(data_, 6, network.asn);
+        if (1 == records_.size())
+        {
+            key_offset = data_.size();
+            string(data_, "autonomous_system_organization");
+        }
+        else
+        {
+            data_ += static_cast<char>(1 << 5 | key_offset >> 8);
+            data_ += static_cast<char>(key_offset);
+        }
+        string(data_, network.organization);
+
+        std::size_t node = 0;
+        for (unsigned i = 0; i < length; i++)
+        {
+            auto const bit = bytes[i / 8] >> (7 - i % 8) & 1;
+            if (i + 1 == length)
+            {
+                nodes_[node].child[bit] = -static_cast<int>(records_.size());
+            }
+            else
+            {
+                if (0 == nodes_[node].child[bit])
+                {
+                    nodes_[node].child[bit] = nodes_.size();
+                    nodes_.push_back({});
+                }
+                node = nodes_[node].child[bit];
+            }
+        }
+    }
+
+    auto save(std::filesystem::path const& path) const -> void
+    {
+        std::string out;
+        for (auto const& node : nodes_)
+        {
+            auto const left = record_value(node.child[0]);
+            auto const right = record_value(node.child[1]);
+            auto const be = [&out](std::uint32_t const value, int const n) {
+                for (int i = n - 1; i >= 0; i--)
+                {
+                    out += static_cast<char>(value >> 8 * i);
+                }
+            };
+            switch (record_size_)
+            {
+            case 24:
+                be(left, 3);
+                be(right, 3);
+                break;
+            case 28:
+                be(left, 3);
+                out += static_cast<char>((left >> 24) << 4 | right >> 24);
+                be(right, 3);
+                break;
+            default:
+                be(left, 4);
+                be(right, 4);
+                break;
+            }
+        }
+        out.append(16, '\0');
+        out += data_;
+
+        out += "\xAB\xCD\xEFMaxMind.com";
+        control(out, 7, 4);
+        string(out, "node_count");
+        unsigned_integer(out, 6, nodes_.size());
+        string(out, "record_size");
+        unsigned_integer(out, 5, record_size_);
+        string(out, "ip_version");
+        unsigned_integer(out, 5, 6);
+        string(out, "database_type");
+        string(out, "GeoLite2-ASN");
+
+        std::ofstream{path, std::ios::binary} << out;
+    }
+};
+
+auto pton(char const* const address) -> std::string
+{
+    unsigned char bytes[16];
+    if (inet_pton(AF_INET, address, bytes))
+    {
+        return {reinterpret_cast<char*>(bytes), 4};
+    }
+    inet_pton(AF_INET6, address, bytes);
+    return {reinterpret_cast<char*>(bytes), 16};
+}
+
+Network const networks[]{
+    {"192.0.2.0", 24, 64500, "Example One"},
+    {"198.51.100.0", 25, 64501, "Example Two"},
+    {"2001:db8::", 32, 64502, "Example Three"},
+};
+
+struct MmdbTest : testing::TestWithParam<unsigned>
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("tests-mmdb-" + std::to_string(getpid()) + ".mmdb");
+
+    auto write(std::vector<Network> const& list, std::filesystem::path const& where) const -> void
+    {
+        Writer writer{GetParam()};
+        for (auto const& network : list)
+        {
+            writer.add(network);
+        }
+        writer.save(where);
+    }
+
+    ~MmdbTest() override
+    {
+        std::filesystem::remove(path);
+    }
+};
+
+TEST_P(MmdbTest, FindsNetworks) {
+  write({std::begin(networks), std::end(networks)}, path);
+  Mmdb const db{path.c_str()};
+  EXPECT_EQ(db.ip_version(), 6);
+
+  auto const one = db.lookup(pton("192.0.2.77"));
+  ASSERT_TRUE(one.asn);
+  EXPECT_EQ(one.asn->number, 64500);
+  EXPECT_EQ(one.asn->organization, "Example One");
+  EXPECT_EQ(one.prefix_length, 24);
+
+  auto const two = db.lookup(pton("198.51.100.5"));
+  ASSERT_TRUE(two.asn);
+  EXPECT_EQ(two.asn->organization, "Example Two");
+  EXPECT_EQ(two.prefix_length, 25);
+
+  auto const three = db.lookup(pton("2001:db8:1::1"));
+  ASSERT_TRUE(three.asn);
+  EXPECT_EQ(three.asn->number, 64502);
+  EXPECT_EQ(three.asn->organization, "Example Three");
+
+  EXPECT_FALSE(db.lookup(pton("198.51.100.200")).asn);
+  EXPECT_FALSE(db.lookup(pton("203.0.113.1")).asn);
+  EXPECT_FALSE(db.lookup(pton("2001:db9::1")).asn);
+  EXPECT_FALSE(db.lookup("short").asn);
+}
+
+TEST_P(MmdbTest, CachesWholePrefixesOnly) {
+  write({std::begin(networks), std::end(networks)}, path);
+  AsnDatabase db;
+  EXPECT_FALSE(db.lookup(pton("192.0.2.1")));
+  db.open(path.string());
+
+  EXPECT_EQ(db.lookup(pton("192.0.2.1"))->number, 64500);
+  EXPECT_EQ(db.lookup(pton("192.0.2.200"))->number, 64500);
+  EXPECT_EQ(db.stats().hits, 1);
+
+  // a /25 can't stand for its /24
+  EXPECT_EQ(db.lookup(pton("198.51.100.1"))->number, 64501);
+  EXPECT_FALSE(db.lookup(pton("198.51.100.129")));
+  EXPECT_EQ(db.stats().hits, 1);
+
+  // misses are cached too
+  EXPECT_FALSE(db.lookup(pton("203.0.113.1")));
+  EXPECT_FALSE(db.lookup(pton("203.0.113.2")));
+  EXPECT_EQ(db.stats().hits, 2);
+}
+
+TEST_P(MmdbTest, ReloadsReplacedFile) {
+  write({networks[0]}, path);
+  AsnDatabase db;
+  db.open(path.string());
+  EXPECT_EQ(db.lookup(pton("192.0.2.1"))->organization, "Example One");
+  EXPECT_FALSE(db.reload());
+
+  auto const next = path.string() + ".new";
+  write({{"192.0.2.0", 24, 64510, "Renumbered"}}, next);
+  std::filesystem::rename(next, path);
+  EXPECT_TRUE(db.reload());
+  EXPECT_EQ(db.lookup(pton("192.0.2.1"))->organization, "Renumbered");
+
+  // a broken replacement leaves the loaded database in use
+  std::ofstream{next} << "not a database";
+  std::filesystem::rename(next, path);
+  EXPECT_THROW(db.reload(), std::runtime_error);
+  EXPECT_EQ(db.lookup(pton("192.0.2.1"))->number, 64510);
+}
+
+INSTANTIATE_TEST_SUITE_P(RecordSizes, MmdbTest, testing::Values(24u, 28u, 32u));
+
+TEST(Mmdb, RejectsBadFiles) {
+  EXPECT_THROW(Mmdb{"/nonexistent/GeoLite2-ASN.mmdb"}, std::system_error);
+
+  auto const path = std::filesystem::temp_directory_path() / ("tests-mmdb-bad-" + std::to_string(getpid()));
+  std::ofstream{path} << "MaxMind.com but no marker";
+  EXPECT_THROW(Mmdb{path.c_str()}, std::runtime_error);
+  std::filesystem::remove(path);
+}
+
+} // namespace
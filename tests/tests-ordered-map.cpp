@@ -0,0 +1,208 @@
+#include <ordered_map.hpp>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+}
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace {
+
+// Each test is a Lua chunk with new_ordered_map in scope that asserts
+// what it expects.
+struct OrderedMapTest : testing::Test
+{
+  std::unique_ptr<lua_State, decltype(&lua_close)> owner{luaL_newstate(), lua_close};
+  lua_State* L = owner.get();
+
+  OrderedMapTest()
+  {
+    luaL_openlibs(L);
+    lua_register(L, "new_ordered_map", l_new_ordered_map);
+    luaL_dostring(L, R"(
+      function collect(iter)
+        local result = {}
+        for v, k, i in iter do
+          result[#result + 1] = string.format('%s=%s#%d', k, v, i)
+        end
+        return table.concat(result, ' ')
+      end
+    )");
+  }
+
+  auto run(char const* const code) -> testing::AssertionResult
+  {
+    if (LUA_OK == luaL_dostring(L, code))
+    {
+      return testing::AssertionSuccess();
+    }
+    return testing::AssertionFailure() << lua_tostring(L, -1);
+  }
+};
+
+TEST_F(OrderedMapTest, InsertPastMaxEvictsOldest) {
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(3)
+    for i = 1, 5 do m:insert('k' .. i, i) end
+    assert(m.n == 5 and m.max == 3)
+    assert(m:lookup('k1') == nil)
+    assert(m:lookup('k2') == nil)
+    assert(m:lookup('k3') == 3)
+    assert(m:lookup('k5') == 5)
+    assert(m:get_oldest() == 3)
+  )"));
+}
+
+TEST_F(OrderedMapTest, LookupAfterManyEvictions) {
+  // Every eviction leaves a tombstone; probes must keep finding live
+  // keys and inserts must reuse the dead buckets
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(4)
+    for i = 1, 20000 do
+      m:insert('key' .. i, i)
+      assert(m:lookup('key' .. i) == i)
+      if i > 4 then
+        assert(m:lookup('key' .. (i - 4)) == nil)
+      end
+    end
+    for i = 19997, 20000 do
+      assert(m:lookup('key' .. i) == i)
+    end
+  )"));
+}
+
+TEST_F(OrderedMapTest, DuplicateKeysFindNewest) {
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(3)
+    m:insert('k', 1)
+    m:insert('k', 2)
+    assert(m:lookup('k') == 2)
+    -- evicting the older duplicate keeps the newer one indexed
+    m:insert('x', 3)
+    m:insert('y', 4)
+    assert(m:lookup('k') == 2)
+  )"));
+}
+
+TEST_F(OrderedMapTest, RekeyOntoExistingKey) {
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(4)
+    m:insert('a', 1)
+    m:insert('b', 2)
+    m:rekey('a', 'b')
+    assert(m:lookup('a') == nil)
+    -- the key now refers to the rekeyed entry, as the Lua version did
+    assert(m:lookup('b') == 1)
+    assert(collect(m:each()) == 'b=2#2 b=1#1')
+
+    m:rekey('missing', 'c')
+    assert(m:lookup('c') == nil)
+
+    -- evicting the entry that lost its index leaves the rekeyed one alone
+    m:insert('c', 3)
+    m:insert('d', 4)
+    m:insert('e', 5)
+    assert(m:lookup('b') == nil)
+  )"));
+}
+
+TEST_F(OrderedMapTest, ResizeKeepsNewest) {
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(5)
+    for i = 1, 7 do m:insert('k' .. i, i) end
+
+    m:resize(3)
+    assert(m.max == 3 and m.n == 3)
+    assert(collect(m:each()) == 'k7=7#3 k6=6#2 k5=5#1')
+    assert(m:lookup('k4') == nil)
+    assert(m:lookup('k5') == 5)
+
+    m:resize(6)
+    assert(m.max == 6 and m.n == 3)
+    assert(collect(m:reveach()) == 'k5=5#1 k6=6#2 k7=7#3')
+    for i = 8, 11 do m:insert('k' .. i, i) end
+    assert(collect(m:each()) == 'k11=11#7 k10=10#6 k9=9#5 k8=8#4 k7=7#3 k6=6#2')
+    assert(m:lookup('k5') == nil)
+    assert(m:lookup('k6') == 6)
+    assert(m:get_oldest() == 6)
+  )"));
+}
+
+TEST_F(OrderedMapTest, CasefoldLookups) {
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(8, true)
+    m:insert('Nick[]\\~', 1)
+    m:insert('other{}|^', 2)
+    assert(m:lookup('nick{}|^') == 1)
+    assert(m:lookup('NICK[]\\~') == 1)
+    assert(m:lookup('OTHER[]\\~') == 2)
+    m:rekey('NiCk{]|~', 'renamed')
+    assert(m:lookup('nick[]\\~') == nil)
+    assert(m:lookup('RENAMED') == 1)
+
+    local exact = new_ordered_map(8)
+    exact:insert('Nick[]\\~', 1)
+    assert(exact:lookup('nick{}|^') == nil)
+    assert(exact:lookup('Nick[]\\~') == 1)
+  )"));
+}
+
+TEST_F(OrderedMapTest, IterationOrderAndNumbers) {
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(3)
+    m:insert('a', 1)
+    m:insert('b', 2)
+    assert(collect(m:each()) == 'b=2#2 a=1#1')
+    assert(collect(m:reveach()) == 'a=1#1 b=2#2')
+
+    for i = 3, 5 do m:insert(string.char(96 + i), i) end
+    assert(collect(m:each()) == 'e=5#5 d=4#4 c=3#3')
+    assert(collect(m:each(1)) == 'd=4#4 c=3#3')
+    assert(collect(m:reveach()) == 'c=3#3 d=4#4 e=5#5')
+  )"));
+}
+
+TEST_F(OrderedMapTest, EpochChangesWhenRenumbered) {
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(3)
+    assert(m.epoch == 0)
+    m:insert('a', 1)
+    assert(m.epoch == 0)
+
+    m:reset()
+    assert(m.epoch == 1 and m.n == 0)
+    assert(m:lookup('a') == nil)
+    assert(collect(m:each()) == '')
+
+    m:insert('b', 2)
+    assert(collect(m:each()) == 'b=2#1')
+    m:resize(5)
+    assert(m.epoch == 2)
+
+    assert(not pcall(function() m.epoch = 7 end))
+    m.predicate = function(v) return v > 10 end
+    m:insert('c', 3)
+    m:insert('d', 11)
+    assert(m.ticker == 2)
+  )"));
+}
+
+TEST_F(OrderedMapTest, NonStringKeys) {
+  EXPECT_TRUE(run(R"(
+    local m = new_ordered_map(2, true)
+    local t = {}
+    m:insert(1, 'one')
+    m:insert(t, 'table')
+    assert(m:lookup(1) == 'one')
+    assert(m:lookup(t) == 'table')
+    assert(m:lookup('1') == nil)
+    m:insert('x', 'x')
+    assert(m:lookup(1) == nil)
+  )"));
+}
+
+} // namespace
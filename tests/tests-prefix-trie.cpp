@@ -0,0 +1,130 @@
+#include <prefix_trie.hpp>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace std::literals::string_literals;
+
+auto v4(int a, int b, int c, int d) -> std::string
+{
+    return {char(a), char(b), char(c), char(d)};
+}
+
+TEST(PrefixTrie, LongestMatchWins) {
+  PrefixTrie trie;
+  trie.insert("wide", v4(192, 0, 0, 0), 8);
+  trie.insert("narrow", v4(192, 0, 2, 0), 24);
+  trie.insert("narrower", v4(192, 0, 2, 128), 25);
+
+  EXPECT_EQ(*trie.delta(v4(192, 0, 2, 200), 1), "narrower");
+  EXPECT_EQ(*trie.delta(v4(192, 0, 2, 20), 1), "narrow");
+  EXPECT_EQ(*trie.delta(v4(192, 9, 9, 9), 1), "wide");
+  EXPECT_EQ(trie.delta(v4(10, 0, 0, 1), 1), nullptr);
+
+  EXPECT_EQ(trie.get("wide"), 1);
+  EXPECT_EQ(trie.get("narrow"), 1);
+  EXPECT_EQ(trie.get("narrower"), 1);
+  EXPECT_EQ(trie.total(), 3);
+}
+
+TEST(PrefixTrie, FamiliesAreSeparate) {
+  PrefixTrie trie;
+  trie.insert("any4", v4(0, 0, 0, 0), 0);
+  EXPECT_EQ(trie.delta(std::string(16, '\0'), 1), nullptr);
+  trie.insert("any6", std::string(16, '\0'), 0);
+  EXPECT_EQ(*trie.delta(std::string(16, '\x20'), 1), "any6");
+  EXPECT_EQ(*trie.delta(v4(1, 2, 3, 4), 1), "any4");
+}
+
+TEST(PrefixTrie, HostBitsIgnored) {
+  PrefixTrie trie;
+  trie.insert("net", v4(192, 0, 2, 77), 24);
+  EXPECT_EQ(*trie.delta(v4(192, 0, 2, 1), 1), "net");
+}
+
+TEST(PrefixTrie, SetRemoveRelabel) {
+  PrefixTrie trie;
+  trie.insert("a", v4(198, 51, 100, 0), 24);
+  EXPECT_TRUE(trie.set("a", 10));
+  EXPECT_FALSE(trie.set("b", 10));
+  trie.delta(v4(198, 51, 100, 1), -1);
+  EXPECT_EQ(trie.get("a"), 9);
+
+  // same network under a new label replaces the old label
+  trie.insert("b", v4(198, 51, 100, 0), 24);
+  EXPECT_FALSE(trie.get("a"));
+  EXPECT_EQ(trie.get("b"), 0);
+
+  EXPECT_TRUE(trie.remove("b"));
+  EXPECT_FALSE(trie.remove("b"));
+  EXPECT_EQ(trie.delta(v4(198, 51, 100, 1), 1), nullptr);
+  EXPECT_EQ(trie.size(), 0);
+}
+
+TEST(PrefixTrie, InvalidNetwork) {
+  PrefixTrie trie;
+  EXPECT_THROW(trie.insert("x", "abc", 8), std::invalid_argument);
+  EXPECT_THROW(trie.insert("x", v4(1, 2, 3, 4), 33), std::invalid_argument);
+  EXPECT_EQ(trie.delta("abc", 1), nullptr);
+}
+
+// Compare against a linear scan of every network
+TEST(PrefixTrie, MatchesLinearScan) {
+  std::mt19937 gen{1459};
+  std::uniform_int_distribution<int> byte{0, 3}; // small alphabet forces shared prefixes
+  std::uniform_int_distribution<unsigned> len{0, 32};
+
+  struct Net { std::string label; std::string address; unsigned prefix; };
+  std::vector<Net> nets;
+  PrefixTrie trie;
+
+  auto const contains = [](Net const& net, std::string const& address) {
+    for (unsigned i = 0; i < net.prefix; i++)
+    {
+      auto const bit = [i](std::string const& s) { return (std::uint8_t(s[i / 8]) >> (7 - i % 8)) & 1; };
+      if (bit(net.address) != bit(address)) return false;
+    }
+    return true;
+  };
+
+  for (int i = 0; i < 200; i++)
+  {
+    Net net{std::to_string(i), v4(byte(gen), byte(gen), byte(gen), byte(gen)), len(gen)};
+    // skip networks that duplicate an existing one
+    bool dup = false;
+    for (auto const& other : nets)
+    {
+      dup |= other.prefix == net.prefix && contains(other, net.address);
+    }
+    if (dup) continue;
+    trie.insert(net.label, net.address, net.prefix);
+    nets.push_back(net);
+  }
+
+  for (int i = 0; i < 2000; i++)
+  {
+    auto const address = v4(byte(gen), byte(gen), byte(gen), byte(gen));
+    Net const* best = nullptr;
+    for (auto const& net : nets)
+    {
+      if (contains(net, address) && (!best || net.prefix > best->prefix)) best = &net;
+    }
+    auto const label = trie.delta(address, 1);
+    if (best)
+    {
+      ASSERT_NE(label, nullptr);
+      EXPECT_EQ(*label, best->label);
+    }
+    else
+    {
+      EXPECT_EQ(label, nullptr);
+    }
+  }
+}
+
+} // namespace
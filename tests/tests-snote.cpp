@@ -0,0 +1,156 @@
+#include <snote.hpp>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+}
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace {
+
+using namespace std::literals::string_view_literals;
+
+auto field(snote::Event const& event, std::string_view const key) -> snote::Value const*
+{
+  for (auto const& f : event)
+  {
+    if (f.key == key) return &f.value;
+  }
+  return nullptr;
+}
+
+auto str(snote::Event const& event, std::string_view const key) -> std::string
+{
+  auto const value = field(event, key);
+  if (nullptr == value) return "<missing>";
+  if (auto const sv = std::get_if<std::string_view>(value)) return std::string{*sv};
+  if (auto const s = std::get_if<std::string>(value)) return *s;
+  return "<integer>";
+}
+
+TEST(Snote, Connect) {
+  auto const event = snote::parse("Client connecting: alice (~a@example.com) [192.0.2.1] {users} <acct> [Alice A]");
+  ASSERT_TRUE(event);
+  EXPECT_EQ(event->name, "connect");
+  EXPECT_EQ(str(*event, "nick"), "alice");
+  EXPECT_EQ(str(*event, "user"), "~a");
+  EXPECT_EQ(str(*event, "host"), "example.com");
+  EXPECT_EQ(str(*event, "ip"), "192.0.2.1");
+  EXPECT_EQ(str(*event, "class"), "users");
+  EXPECT_EQ(str(*event, "account"), "acct");
+  EXPECT_EQ(str(*event, "gecos"), "Alice A");
+}
+
+TEST(Snote, ZeroAddressOmitted) {
+  auto const event = snote::parse("Client exiting: bob (~b@gateway/web) [Quit: bye] [0]");
+  ASSERT_TRUE(event);
+  EXPECT_EQ(event->name, "disconnect");
+  EXPECT_EQ(field(*event, "ip"), nullptr);
+}
+
+TEST(Snote, GreedyCapturesBacktrack) {
+  // string.match gives the longest ip that still lets the rest match
+  auto const event = snote::parse("Client connecting: d (~d@h) [192.0.2.7] {users} <*> [x] {y} <z> [w]");
+  ASSERT_TRUE(event);
+  EXPECT_EQ(str(*event, "ip"), "192.0.2.7] {users} <*> [x");
+  EXPECT_EQ(str(*event, "gecos"), "w");
+}
+
+TEST(Snote, LineKinds) {
+  auto const event = snote::parse("o!~o@staff{op} added global 1440 min. D-Line for [192.0.2.0/24] [abuse]");
+  ASSERT_TRUE(event);
+  EXPECT_EQ(event->name, "dline");
+  auto const duration = field(*event, "duration");
+  ASSERT_NE(duration, nullptr);
+  EXPECT_EQ(std::get<std::int64_t>(*duration), 1440);
+
+  EXPECT_FALSE(snote::parse("o!~o@staff{op} added global 5 min. Q-Line for [m] [r]"));
+}
+
+TEST(Snote, KindLowered) {
+  auto const event = snote::parse("Rejecting X-Lined user v[~v@h] [192.0.2.9] (bad*gecos)");
+  ASSERT_TRUE(event);
+  EXPECT_EQ(event->name, "rejected");
+  EXPECT_EQ(str(*event, "kind"), "x-line");
+  EXPECT_EQ(str(*event, "mask"), "bad*gecos");
+}
+
+TEST(Snote, FirstRuleWins) {
+  // Dispatch on the first word must still fall back to variable rules
+  auto const event = snote::parse("OPERSPY is creating new channel #chan");
+  ASSERT_TRUE(event);
+  EXPECT_EQ(event->name, "create_channel");
+  EXPECT_EQ(str(*event, "nick"), "OPERSPY");
+}
+
+TEST(Snote, Simple) {
+  auto const event = snote::parse("New filters loaded.");
+  ASSERT_TRUE(event);
+  EXPECT_EQ(event->name, "filtering_loaded");
+  EXPECT_EQ(event->size, 0);
+
+  EXPECT_FALSE(snote::parse(""));
+  EXPECT_FALSE(snote::parse("Nothing to see here"));
+}
+
+// Compare both sides as Lua tables: same keys, same values, same number subtypes
+auto same_table(lua_State* const L, int const a, int const b) -> bool
+{
+  if (lua_isnil(L, a) || lua_isnil(L, b)) return lua_isnil(L, a) && lua_isnil(L, b);
+
+  auto const subset = [L](int const x, int const y) {
+    for (lua_pushnil(L); lua_next(L, x); lua_pop(L, 1))
+    {
+      lua_pushvalue(L, -2);
+      lua_rawget(L, y);
+      auto const same = lua_rawequal(L, -1, -2) && lua_isinteger(L, -1) == lua_isinteger(L, -2);
+      lua_pop(L, 1);
+      if (not same)
+      {
+        lua_pop(L, 2);
+        return false;
+      }
+    }
+    return true;
+  };
+  return subset(a, b) && subset(b, a);
+}
+
+// Differential test against the original Lua pattern chain
+TEST(Snote, MatchesReferenceImplementation) {
+  std::unique_ptr<lua_State, decltype(&lua_close)> const owner{luaL_newstate(), lua_close};
+  auto const L = owner.get();
+  luaL_openlibs(L);
+  ASSERT_EQ(LUA_OK, luaL_dofile(L, SNOTE_DATA_DIR "/parse_snote.lua")) << lua_tostring(L, -1);
+  ASSERT_EQ(lua_gettop(L), 1);
+
+  std::ifstream corpus{SNOTE_DATA_DIR "/corpus.txt"};
+  ASSERT_TRUE(corpus);
+
+  int lines = 0;
+  std::string line;
+  while (std::getline(corpus, line))
+  {
+    lines++;
+    for (auto const impl : {0, 1})
+    {
+      if (impl == 0) lua_pushvalue(L, 1);
+      else lua_pushcfunction(L, l_parse_snote);
+      lua_pushinteger(L, 1700000000);
+      lua_pushliteral(L, "irc.example.net");
+      lua_pushlstring(L, line.data(), line.size());
+      ASSERT_EQ(LUA_OK, lua_pcall(L, 3, 1, 0)) << lua_tostring(L, -1);
+    }
+    EXPECT_TRUE(same_table(L, 2, 3)) << line;
+    lua_settop(L, 1);
+  }
+  EXPECT_GT(lines, 0);
+}
+
+} // namespace
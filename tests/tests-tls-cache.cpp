@@ -0,0 +1,119 @@
+#include <net/tls_cache.hpp>
+
+#include <gtest/gtest.h>
+
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+
+#include <memory>
+#include <string>
+
+namespace {
+
+using X509Ptr = std::unique_ptr<X509, decltype(&X509_free)>;
+using KeyPtr = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+
+auto generate_key() -> KeyPtr
+{
+    return {EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", "P-256"), EVP_PKEY_free};
+}
+
+auto self_signed(EVP_PKEY* const key) -> X509Ptr
+{
+    X509Ptr cert{X509_new(), X509_free};
+    ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert.get()), 3600);
+    X509_set_pubkey(cert.get(), key);
+    auto const name = X509_get_subject_name(cert.get());
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<unsigned char const*>("snowcone"), -1, -1, 0);
+    X509_set_issuer_name(cert.get(), name);
+    X509_sign(cert.get(), key, EVP_sha256());
+    return cert;
+}
+
+auto pem(X509* const cert) -> std::string
+{
+    std::unique_ptr<BIO, decltype(&BIO_free)> bio{BIO_new(BIO_s_mem()), BIO_free};
+    PEM_write_bio_X509(bio.get(), cert);
+    char* data;
+    auto const len = BIO_get_mem_data(bio.get(), &data);
+    return {data, static_cast<std::size_t>(len)};
+}
+
+auto pem(EVP_PKEY* const key) -> std::string
+{
+    std::unique_ptr<BIO, decltype(&BIO_free)> bio{BIO_new(BIO_s_mem()), BIO_free};
+    PEM_write_bio_PrivateKey(bio.get(), key, nullptr, nullptr, 0, nullptr, nullptr);
+    char* data;
+    auto const len = BIO_get_mem_data(bio.get(), &data);
+    return {data, static_cast<std::size_t>(len)};
+}
+
+// Parses a fresh copy the way each connection loads its credentials
+auto parse_cert(std::string const& text) -> X509Ptr
+{
+    std::unique_ptr<BIO, decltype(&BIO_free)> bio{BIO_new_mem_buf(text.data(), text.size()), BIO_free};
+    return {PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr), X509_free};
+}
+
+auto parse_key(std::string const& text) -> KeyPtr
+{
+    std::unique_ptr<BIO, decltype(&BIO_free)> bio{BIO_new_mem_buf(text.data(), text.size()), BIO_free};
+    return {PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr), EVP_PKEY_free};
+}
+
+TEST(TlsCache, SameCredentialsShareContext) {
+  auto const key = generate_key();
+  ASSERT_TRUE(key);
+  auto const cert_pem = pem(self_signed(key.get()).get());
+  auto const key_pem = pem(key.get());
+
+  auto const cert1 = parse_cert(cert_pem);
+  auto const key1 = parse_key(key_pem);
+  auto const cert2 = parse_cert(cert_pem);
+  auto const key2 = parse_key(key_pem);
+  ASSERT_TRUE(cert1 && key1 && cert2 && key2);
+  ASSERT_NE(cert1.get(), cert2.get());
+  ASSERT_NE(key1.get(), key2.get());
+
+  TlsCache cache;
+  auto const context1 = cache.context(cert1.get(), key1.get());
+  auto const context2 = cache.context(cert2.get(), key2.get());
+  EXPECT_EQ(context1, context2);
+  EXPECT_EQ(context1->identity.size(), 64);
+}
+
+TEST(TlsCache, DifferentCredentialsGetOwnContexts) {
+  auto const key = generate_key();
+  auto const other_key = generate_key();
+  ASSERT_TRUE(key && other_key);
+  auto const cert = self_signed(key.get());
+
+  TlsCache cache;
+  auto const anonymous = cache.context(nullptr, nullptr);
+  EXPECT_EQ(anonymous, cache.context(nullptr, nullptr));
+  EXPECT_TRUE(anonymous->identity.empty());
+
+  auto const with_cert = cache.context(cert.get(), key.get());
+  EXPECT_NE(anonymous, with_cert);
+  EXPECT_NE(with_cert, cache.context(cert.get(), nullptr));
+  EXPECT_NE(cache.context(nullptr, key.get()), cache.context(nullptr, other_key.get()));
+}
+
+TEST(TlsCache, ContextOutlivesCredentials) {
+  auto key = generate_key();
+  ASSERT_TRUE(key);
+  auto cert = self_signed(key.get());
+
+  TlsCache cache;
+  auto const context = cache.context(cert.get(), key.get());
+  auto const identity = context->identity;
+  cert.reset();
+  key.reset();
+
+  EXPECT_EQ(identity, context->identity);
+  EXPECT_NE(nullptr, SSL_CTX_get0_certificate(context->ssl_context.native_handle()));
+}
+
+} // namespace
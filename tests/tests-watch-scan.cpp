@@ -0,0 +1,125 @@
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+}
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace {
+
+// Loads the dashboard's watch_scan module against a stand-in hsfilter that
+// matches Lua patterns and rejects any expression with a backreference, the
+// way Hyperscan does, and a utils.matching whose regexps are Lua patterns.
+struct WatchScanTest : testing::Test
+{
+  std::unique_ptr<lua_State, decltype(&lua_close)> owner{luaL_newstate(), lua_close};
+  lua_State* L = owner.get();
+
+  WatchScanTest()
+  {
+    luaL_openlibs(L);
+    luaL_dostring(L, R"(
+      package.preload['utils.matching'] = function()
+        return { safematch = function(str, regexp) return str:find(regexp) end }
+      end
+
+      compiles, closes = 0, 0
+      hsfilter = { flags = { HS_FLAG_CASELESS = 1 } }
+      function hsfilter.new_scanner(exprs, flags, ids)
+        compiles = compiles + 1
+        for i, expr in ipairs(exprs) do
+          if expr:find '\\%d' then
+            return nil, 'backreferences are not supported', i
+          end
+        end
+        local scanner = {}
+        function scanner:scan(str, hits)
+          for i, expr in ipairs(exprs) do
+            local subject = flags[i] == 1 and str:lower() or str
+            if subject:find(expr) then hits[ids[i]] = true end
+          end
+        end
+        function scanner:close() closes = closes + 1 end
+        return scanner
+      end
+
+      function hitlist(hits)
+        local result = {}
+        for i in pairs(hits) do result[#result + 1] = i end
+        table.sort(result)
+        return table.concat(result, ' ')
+      end
+    )");
+    if (LUA_OK != luaL_dofile(L, WATCH_SCAN_LUA))
+    {
+      ADD_FAILURE() << lua_tostring(L, -1);
+    }
+    lua_setglobal(L, "watch_scan");
+  }
+
+  auto run(char const* const code) -> testing::AssertionResult
+  {
+    if (LUA_OK == luaL_dostring(L, code))
+    {
+      return testing::AssertionSuccess();
+    }
+    return testing::AssertionFailure() << lua_tostring(L, -1);
+  }
+};
+
+TEST_F(WatchScanTest, RejectedPatternMatchesThroughFallback) {
+  EXPECT_TRUE(run(R"(
+    watches = {
+      { mask = 'evil', regexp = 'evil', active = true },
+      { mask = '(b)\\1', regexp = 'bb', active = true },
+      { mask = 'idle', regexp = 'idle', active = false },
+      { mask = 'Good', regexp = 'Good', active = true },
+    }
+    assert(hitlist(watch_scan.match { 'xbbx', 'EVIL Good idle' }) == '1 2 4')
+    assert(hitlist(watch_scan.match { 'xbbx' }) == '2')
+    assert(hitlist(watch_scan.match { 'good idle' }) == '')
+    -- the rejected expression was dropped and the rest compiled once more
+    assert(compiles == 2)
+  )"));
+}
+
+TEST_F(WatchScanTest, RebuildsOnlyAfterChanges) {
+  EXPECT_TRUE(run(R"(
+    watches = { { mask = 'one', regexp = 'one', active = true } }
+    assert(hitlist(watch_scan.match { 'one two' }) == '1')
+    assert(hitlist(watch_scan.match { 'one two' }) == '1')
+    assert(compiles == 1)
+
+    table.insert(watches, { mask = 'two', regexp = 'two', active = true })
+    watch_scan.changed()
+    assert(hitlist(watch_scan.match { 'one two' }) == '1 2')
+    assert(compiles == 2 and closes == 1)
+
+    watches[1].active = nil
+    watch_scan.changed()
+    assert(hitlist(watch_scan.match { 'one two' }) == '2')
+
+    -- a replaced watch list is noticed without being announced
+    watches = { { mask = 'three', regexp = 'three', active = true } }
+    assert(hitlist(watch_scan.match { 'one two three' }) == '1')
+    assert(compiles == 4)
+  )"));
+}
+
+TEST_F(WatchScanTest, MatchesWithoutHyperscan) {
+  EXPECT_TRUE(run(R"(
+    hsfilter = nil
+    watches = {
+      { mask = 'evil', regexp = 'evil', active = true },
+      { mask = 'idle', regexp = 'idle', active = false },
+      { mask = 'bad', regexp = 'bad', active = true },
+    }
+    assert(hitlist(watch_scan.match { 'bad', 'evil idle' }) == '1 3')
+    assert(compiles == 0)
+  )"));
+}
+
+} // namespace